@@ -5,6 +5,46 @@
 #include <optional>
 #include <string>
 #include <string_view>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <cstdio>
+#include <execution>
+#include <limits>
+#include <type_traits>
+#include <atomic>
+#include <unordered_map>
+#include <map>
+#include <unordered_set>
+#include <filesystem>
+#include <new>
+#include <cerrno>
+#include <mutex>
+#include <set>
+#include <chrono>
+#include <thread>
+#include <bit>
+#include <sstream>
+#include <fstream>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 // https://archive.blender.org/wiki/index.php/Dev:Source/Architecture/File_Format/
 // https://github.com/blender/blender/tree/master/source/blender/makesdna
@@ -34,9 +74,11 @@ struct MemorySpan
 	uint8_t* end{ nullptr };
 };
 
+// Unchecked accessors, only for data already covered by the load-time validation (see blendExpl::ValidateBlockExtents).
 template<typename T>
 T* ReadTypePtr(MemorySpan& span, size_t count = 1)
 {
+	assert(sizeof(T) * count <= span.Size());
 	T* val = reinterpret_cast<T*>(span.Data());
 	span.Advance(sizeof(T) * count);
 	return val;
@@ -45,10 +87,229 @@ T* ReadTypePtr(MemorySpan& span, size_t count = 1)
 template<typename T>
 T* PeekTypePtr(MemorySpan span, size_t offset)
 {
+	assert(offset <= span.Size());
 	span.Advance(offset);
 	return reinterpret_cast<T*>(span.Data());
 }
 
+// Checked accessors for untrusted input, nullptr when the span is too short (the span is not advanced then).
+template<typename T>
+T* ReadTypePtrChecked(MemorySpan& span, size_t count = 1)
+{
+	if(span.Empty() || count > span.Size() / sizeof(T))
+		return nullptr;
+
+	return ReadTypePtr<T>(span, count);
+}
+
+template<typename T>
+T* PeekTypePtrChecked(MemorySpan span, size_t offset)
+{
+	if(span.Empty() || offset > span.Size() || sizeof(T) > span.Size() - offset)
+		return nullptr;
+
+	return PeekTypePtr<T>(span, offset);
+}
+
+// Value accessors, memcpy based so any byte offset is fine (no alignment assumption, no aliasing of the file buffer).
+template<typename T>
+T ReadType(MemorySpan& span)
+{
+	static_assert(std::is_trivially_copyable_v<T>);
+	assert(sizeof(T) <= span.Size());
+
+	T val;
+	memcpy(&val, span.Data(), sizeof(T));
+	span.Advance(sizeof(T));
+	return val;
+}
+
+template<typename T>
+T PeekType(MemorySpan span, size_t offset)
+{
+	static_assert(std::is_trivially_copyable_v<T>);
+	assert(offset <= span.Size() && sizeof(T) <= span.Size() - offset);
+
+	T val;
+	memcpy(&val, span.Data() + offset, sizeof(T));
+	return val;
+}
+
+/*
+* Typed view of one field (or whole struct) repeated every 'stride' bytes, eg. all 'co' fields of an MVert array:
+* base = payload + offsetof(co), stride = SDNA length of MVert. Loads are memcpy based (unaligned safe),
+* Gather() copies a range in one go, GatherLanes() transposes 4 byte lanes into separate (SoA) arrays with AVX2 gathers.
+*/
+template<typename T>
+struct StridedView
+{
+	static_assert(std::is_trivially_copyable_v<T>);
+
+	constexpr size_t Size() const { return count; }
+	constexpr bool Empty() const { return count == 0; }
+
+	T operator[](size_t i) const
+	{
+		assert(i < count);
+
+		T val;
+		memcpy(&val, base + i * stride, sizeof(T));
+		return val;
+	}
+
+	void Gather(T* out, size_t first, size_t n) const
+	{
+		assert(first + n <= count);
+
+		if(stride == sizeof(T))
+		{
+			memcpy(out, base + first * stride, n * sizeof(T));
+			return;
+		}
+
+		const uint8_t* src = base + first * stride;
+		for(size_t i=0; i<n; ++i, src += stride)
+			memcpy(out + i, src, sizeof(T));
+	}
+
+	// out[lane][i] = lane 'lane' (4 byte component) of element first + i
+	void GatherLanes(void* const* out, size_t first, size_t n) const
+	{
+		static_assert(sizeof(T) % 4 == 0);
+		constexpr size_t numLanes = sizeof(T) / 4;
+		assert(first + n <= count);
+
+		const uint8_t* src = base + first * stride;
+		size_t i = 0;
+
+#if defined(__AVX2__)
+		if(stride * 7 <= size_t(std::numeric_limits<int32_t>::max()))
+		{
+			const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(int32_t(stride)));
+			for(; i + 8 <= n; i += 8, src += 8 * stride)
+			{
+				for(size_t lane=0; lane<numLanes; ++lane)
+				{
+					const __m256i v = _mm256_i32gather_epi32(reinterpret_cast<const int*>(src + lane * 4), offsets, 1);
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(static_cast<uint32_t*>(out[lane]) + i), v);
+				}
+			}
+		}
+#endif
+
+		for(; i<n; ++i, src += stride)
+		{
+			for(size_t lane=0; lane<numLanes; ++lane)
+				memcpy(static_cast<uint32_t*>(out[lane]) + i, src + lane * 4, 4);
+		}
+	}
+
+	const uint8_t* base{ nullptr };
+	size_t count{ 0 };
+	size_t stride{ sizeof(T) };
+};
+
+// View of 'count' structs of 'structSize' bytes in 'span', at 'fieldOffset' in each, clipped to what the span holds.
+// Empty when the field doesn't fit the struct, a missing field's offset (SIZE_MAX) included.
+template<typename T>
+StridedView<T> MakeStridedView(MemorySpan span, size_t count, size_t structSize, size_t fieldOffset = 0)
+{
+	if(structSize < sizeof(T) || fieldOffset > structSize - sizeof(T) || span.Size() < sizeof(T) || fieldOffset > span.Size() - sizeof(T))
+		return {};
+
+	const size_t available = (span.Size() - fieldOffset - sizeof(T)) / structSize + 1;
+	return StridedView<T>{ span.Data() + fieldOffset, std::min(count, available), structSize };
+}
+
+// stdio file or nullptr: fopen_s where the CRT deprecates fopen, fopen everywhere else.
+inline FILE* OpenFile(const std::filesystem::path& path, const char* mode)
+{
+#if defined(_WIN32)
+	FILE* f = nullptr;
+	return (fopen_s(&f, path.string().c_str(), mode) == 0 ? f : nullptr);
+#else
+	return std::fopen(path.c_str(), mode);
+#endif
+}
+
+// Copy-on-write mapping of a whole file: spans of it can be used like a loaded buffer, without copying anything.
+class fileMapping
+{
+	public:
+		fileMapping() = default;
+		fileMapping(const fileMapping&) = delete;
+		fileMapping& operator=(const fileMapping&) = delete;
+
+		~fileMapping()
+		{
+			Close();
+		}
+
+		bool Open(const std::string& file)
+		{
+			Close();
+
+#if defined(_WIN32)
+			const HANDLE handle = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if(handle == INVALID_HANDLE_VALUE)
+				return false;
+
+			LARGE_INTEGER fileSize{};
+			if(GetFileSizeEx(handle, &fileSize) && fileSize.QuadPart > 0)
+				m_mapping = CreateFileMappingA(handle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+
+			CloseHandle(handle); // the mapping keeps the file open
+			if(m_mapping == nullptr)
+				return false;
+
+			uint8_t* base = static_cast<uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_COPY, 0, 0, 0));
+			if(base == nullptr)
+				return false;
+
+			m_span = MemorySpan{ base, base + fileSize.QuadPart };
+#else
+			const int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+			if(fd < 0)
+				return false;
+
+			struct stat st{};
+			void* base = MAP_FAILED;
+			if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+				base = mmap(nullptr, size_t(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+			close(fd); // the mapping keeps the file open
+			if(base == MAP_FAILED)
+				return false;
+
+			m_span = MemorySpan{ static_cast<uint8_t*>(base), static_cast<uint8_t*>(base) + st.st_size };
+#endif
+			return true;
+		}
+
+		void Close()
+		{
+#if defined(_WIN32)
+			if(!m_span.Empty())
+				UnmapViewOfFile(m_span.begin);
+			if(m_mapping != nullptr)
+				CloseHandle(m_mapping);
+			m_mapping = nullptr;
+#else
+			if(!m_span.Empty())
+				munmap(m_span.begin, m_span.Size());
+#endif
+			m_span = {};
+		}
+
+		MemorySpan Span() const { return m_span; }
+
+	private:
+		MemorySpan m_span;
+#if defined(_WIN32)
+		HANDLE m_mapping{ nullptr };
+#endif
+};
+
 namespace blender
 {
 	using PtrType = uint64_t;
@@ -65,6 +326,7 @@ namespace blender
 		BigEndian
 	};
 
+	// 'BLENDER-v400': written up to 4.x
 	struct FileHeader
 	{
 		uint8_t id[7];		// File identifier (always 'BLENDER')
@@ -73,6 +335,17 @@ namespace blender
 		uint8_t version[3]; // Version of Blender the file was created in; '254' means version 2.54
 	};
 
+	// 'BLENDER17-01v0500': 5.0 and later, always 64bit pointers, blocks use FileBlockDescLarge64
+	struct FileHeaderV1
+	{
+		uint8_t id[7];			// 'BLENDER'
+		uint8_t headerSize[2];	// '17'
+		uint8_t separator;		// '-'
+		uint8_t format[2];		// '01' - file format version
+		uint8_t endianness;		// 'v'
+		uint8_t version[4];		// '0500' means version 5.0
+	};
+
 	struct FileBlockDesc64
 	{
 		uint8_t code[4];	// File-block identifier
@@ -82,12 +355,74 @@ namespace blender
 		uint32_t count;		// Number of structure located in this file-block
 	};
 
+	// Block header of FileHeaderV1 files, 64bit size and count for multi GB arrays
+	struct FileBlockDescLarge64
+	{
+		uint8_t code[4];
+		uint32_t sdnaIndex;
+		PtrType oldMemoryAddress;
+		uint64_t size;
+		uint64_t count;
+	};
+
+	static_assert(sizeof(FileHeader) == 12 && sizeof(FileHeaderV1) == 17, "file header layout");
+	static_assert(sizeof(FileBlockDesc64) == 24 && sizeof(FileBlockDescLarge64) == 32, "block header layout");
+
+	// Leading part of FileGlobal (GLOB block) as written since 2.80, read without the SDNA
+	struct FileGlobalHead
+	{
+		char subvstr[4];
+		int16_t subversion;
+		int16_t minversion;
+		int16_t minsubversion;
+		uint8_t pad[6];
+		PtrType curscreen;
+		PtrType curscene;
+		PtrType curViewLayer;
+		PtrType pad1;
+		int32_t fileflags;
+		int32_t globalf;
+		uint64_t buildCommitTimestamp;
+		char buildHash[16];
+	};
+
+	static_assert(sizeof(FileGlobalHead) == 80, "FileGlobal layout");
+
+	// REND block payload, written before everything else for the current scene and the scenes set to render in the background
+	// REND block: the frame range, then the scene's ID name without the code prefix (IdNameLength - 2 chars)
+	struct RenderInfoHead
+	{
+		int32_t sfra;
+		int32_t efra;
+	};
+
+	static_assert(sizeof(RenderInfoHead) == 8, "RenderInfo layout");
+
+	// What the file header tells about the layout of the rest
+	struct FileFormat
+	{
+		uint32_t version{ 0 };	// eg. 400 for 4.0
+		size_t headerSize{ sizeof(FileHeader) };
+		size_t blockHeaderSize{ sizeof(FileBlockDesc64) };
+	};
+
+	// Block header of either generation as loaded
+	struct BlockDesc
+	{
+		uint8_t code[4];
+		uint64_t size;
+		PtrType oldMemoryAddress;
+		uint32_t sdnaIndex;
+		uint64_t count;
+	};
+
 	struct FileBlock
 	{
-		FileBlockDesc64 desc;
+		BlockDesc desc;
 		MemorySpan data;
 		std::vector<FileBlock> childBlocks;
 		std::ptrdiff_t fileOffset; //debug
+		bool validated{ false }; // payload covers sdna struct size * count, fields of the struct are in bounds
 	};
 
 	inline const char HeaderID[7] = { 'B', 'L', 'E', 'N', 'D', 'E', 'R' };
@@ -95,12 +430,87 @@ namespace blender
 	inline const char BlockOB[4] = { 'O', 'B', 0, 0 }; // object
 	inline const char BlockME[4] = { 'M', 'E', 0, 0 }; // mesh
 	inline const char BlockAR[4] = { 'A', 'R', 0, 0 }; // armature
+	inline const char BlockAC[4] = { 'A', 'C', 0, 0 }; // action
+	inline const char BlockKE[4] = { 'K', 'E', 0, 0 }; // shape keys
 	inline const char BlockSC[4] = { 'S', 'C', 0, 0 }; // scene
 	inline const char BlockDATA[4] = { 'D', 'A', 'T', 'A' };
+	inline const char BlockGLOB[4] = { 'G', 'L', 'O', 'B' }; // FileGlobal
+	inline const char BlockREND[4] = { 'R', 'E', 'N', 'D' }; // RenderInfo
 	inline const char EOFMark[4] = { 'E', 'N', 'D', 'B' };
 	inline const char EOBMark[4] = { 'E', 'N', 'D', 'B' };
 
 	inline constexpr size_t ID_NAME_LENGTH = 66;
+	inline constexpr size_t ID_NAME_LENGTH_V5 = 258;	// MAX_ID_NAME since 5.0
+
+	// For readers without the SDNA, the parser takes it from the ID.name field (see blendExpl::GetBlockNameByID).
+	constexpr size_t IdNameLength(uint32_t version) { return version >= 500 ? ID_NAME_LENGTH_V5 : ID_NAME_LENGTH; }
+
+	// Renamed SDNA structs and fields (see makesdna/intern/dna_rename_defs.h). Files keep the static (old) name, Blender's
+	// code uses the runtime one; lookups here accept either, whichever the file's DNA has.
+	struct DnaStructRename
+	{
+		std::string_view staticName;
+		std::string_view runtimeName;
+	};
+
+	struct DnaFieldRename
+	{
+		std::string_view structName;	// static struct name
+		std::string_view staticName;	// bare names, without '*' and array dimensions
+		std::string_view runtimeName;
+	};
+
+	inline constexpr DnaStructRename DnaStructRenames[] =
+	{
+		{ "Group", "Collection" },
+		{ "GroupObject", "CollectionObject" },
+		{ "Lamp", "Light" },
+		{ "SpaceIpo", "SpaceGraph" },
+		{ "SpaceOops", "SpaceOutliner" },
+	};
+
+	inline constexpr DnaFieldRename DnaFieldRenames[] =
+	{
+		{ "Object", "size", "scale" },
+		{ "Object", "obmat", "object_to_world" },
+		{ "Object", "imat", "world_to_object" },
+		{ "bPoseChannel", "size", "scale" },
+		{ "Object", "dup_group", "instance_collection" },
+		{ "Group", "dupli_ofs", "instance_offset" },				// static name of Collection
+		{ "Mesh", "totvert", "verts_num" },
+		{ "Mesh", "totedge", "edges_num" },
+		{ "Mesh", "totpoly", "faces_num" },
+		{ "Mesh", "totloop", "corners_num" },
+		{ "Mesh", "poly_offset_indices", "face_offset_indices" },
+	};
+
+	inline constexpr uint32_t OB_HIDE_RENDER = 1 << 2;				// Object.visibility_flag (restrictflag before 2.91)
+	inline constexpr uint32_t OB_DUPLICOLLECTION = 1 << 8;			// Object.transflag
+	inline constexpr uint32_t COLLECTION_HIDE_RENDER = 1 << 3;		// Collection.flag
+	inline constexpr uint32_t LAYER_COLLECTION_EXCLUDE = 1 << 4;	// LayerCollection.flag
+	inline constexpr uint32_t VIEW_LAYER_RENDER = 1 << 0;			// ViewLayer.flag
+	inline constexpr uint32_t LIB_FAKEUSER = 1 << 9;				// ID.flag
+	inline constexpr int16_t KEY_RELATIVE = 1;						// Key.type
+	inline constexpr int32_t CD_PROP_INT32 = 11;					// CustomDataLayer.type
+	inline constexpr int32_t CD_PROP_INT32_2D = 46;
+	inline constexpr int32_t CD_PROP_FLOAT3 = 48;
+	inline constexpr int32_t CD_PROP_FLOAT2 = 49;				// 3.5+ UV maps are float2 corner attributes
+	inline constexpr int16_t CONSTRAINT_TYPE_CHILDOF = 1;			// bConstraint.type
+	inline constexpr int16_t CONSTRAINT_TYPE_KINEMATIC = 3;
+	inline constexpr int16_t CONSTRAINT_TYPE_ROTLIKE = 8;
+	inline constexpr int16_t CONSTRAINT_TYPE_DAMPTRACK = 21;
+	inline constexpr uint32_t CONSTRAINT_DISABLE = 1 << 2;			// bConstraint.flag
+	inline constexpr uint32_t CONSTRAINT_OFF = 1 << 9;
+	inline constexpr uint8_t CONSTRAINT_SPACE_WORLD = 0;			// bConstraint.ownspace/tarspace
+	inline constexpr uint8_t CONSTRAINT_SPACE_POSE = 2;
+	inline constexpr uint32_t CONSTRAINT_IK_TIP = 1 << 0;			// bKinematicConstraint.flag
+	inline constexpr int16_t CONSTRAINT_IK_TYPE_COPYPOSE = 0;		// bKinematicConstraint.type
+	inline constexpr uint32_t ROTLIKE_OFFSET = 1 << 7;				// bRotateLikeConstraint.flag, before mix_mode
+	inline constexpr int8_t ROTLIKE_MIX_REPLACE = 0;				// bRotateLikeConstraint.mix_mode
+	inline constexpr int8_t ROTLIKE_MIX_OFFSET = 1;
+	inline constexpr int8_t ROTLIKE_MIX_ADD = 2;
+	inline constexpr int8_t ROTLIKE_MIX_BEFORE = 3;
+	inline constexpr int8_t ROTLIKE_MIX_AFTER = 4;
 
 	enum class OB_TYPE: int16_t
 	{
@@ -221,6 +631,11 @@ namespace blender
 		uint8_t _pad[7];
 	};
 
+	struct Float2
+	{
+		float x, y;
+	};
+
 	struct Float3
 	{
 		float x, y, z;
@@ -231,1021 +646,10010 @@ namespace blender
 		float w, x, y, z;
 	};
 
+	struct Float4x4
+	{
+		float m[4][4]; // [column][row]
+	};
+
 	void NormalShortToFloat(float out[3], const int16_t in[3])
 	{
 		out[0] = in[0] * (1.0f / 32767.0f);
 		out[1] = in[1] * (1.0f / 32767.0f);
 		out[2] = in[2] * (1.0f / 32767.0f);
 	}
+
+	Float3 TransformPoint(const Float4x4& mat, const Float3& p)
+	{
+		return Float3{ mat.m[0][0] * p.x + mat.m[1][0] * p.y + mat.m[2][0] * p.z + mat.m[3][0],
+					   mat.m[0][1] * p.x + mat.m[1][1] * p.y + mat.m[2][1] * p.z + mat.m[3][1],
+					   mat.m[0][2] * p.x + mat.m[1][2] * p.y + mat.m[2][2] * p.z + mat.m[3][2] };
+	}
+
+	Float3 TransformDirection(const Float4x4& mat, const Float3& d)
+	{
+		return Float3{ mat.m[0][0] * d.x + mat.m[1][0] * d.y + mat.m[2][0] * d.z,
+					   mat.m[0][1] * d.x + mat.m[1][1] * d.y + mat.m[2][1] * d.z,
+					   mat.m[0][2] * d.x + mat.m[1][2] * d.y + mat.m[2][2] * d.z };
+	}
+
+	Float4x4 Identity()
+	{
+		Float4x4 m{};
+		m.m[0][0] = m.m[1][1] = m.m[2][2] = m.m[3][3] = 1.0f;
+		return m;
+	}
+
+	// a * b, b is applied first
+	Float4x4 Multiply(const Float4x4& a, const Float4x4& b)
+	{
+		Float4x4 r;
+		for(int col=0; col<4; ++col)
+		{
+			for(int row=0; row<4; ++row)
+				r.m[col][row] = a.m[0][row] * b.m[col][0] + a.m[1][row] * b.m[col][1] + a.m[2][row] * b.m[col][2] + a.m[3][row] * b.m[col][3];
+		}
+
+		return r;
+	}
+
+	// Inverse of a matrix without projection (last row 0 0 0 1), false if the 3x3 part is singular.
+	bool InvertAffine(Float4x4& out, const Float4x4& in)
+	{
+		const auto& m = in.m;
+		const double c00 = double(m[1][1]) * m[2][2] - double(m[2][1]) * m[1][2];
+		const double c01 = double(m[2][1]) * m[0][2] - double(m[0][1]) * m[2][2];
+		const double c02 = double(m[0][1]) * m[1][2] - double(m[1][1]) * m[0][2];
+		const double det = m[0][0] * c00 + m[1][0] * c01 + m[2][0] * c02;
+		if(std::abs(det) <= std::numeric_limits<float>::min())
+			return false;
+
+		const double invDet = 1.0 / det;
+		double r[3][3]; // [column][row]
+		r[0][0] = c00 * invDet;
+		r[0][1] = c01 * invDet;
+		r[0][2] = c02 * invDet;
+		r[1][0] = (double(m[2][0]) * m[1][2] - double(m[1][0]) * m[2][2]) * invDet;
+		r[1][1] = (double(m[0][0]) * m[2][2] - double(m[2][0]) * m[0][2]) * invDet;
+		r[1][2] = (double(m[1][0]) * m[0][2] - double(m[0][0]) * m[1][2]) * invDet;
+		r[2][0] = (double(m[1][0]) * m[2][1] - double(m[2][0]) * m[1][1]) * invDet;
+		r[2][1] = (double(m[2][0]) * m[0][1] - double(m[0][0]) * m[2][1]) * invDet;
+		r[2][2] = (double(m[0][0]) * m[1][1] - double(m[1][0]) * m[0][1]) * invDet;
+
+		out = Float4x4{};
+		for(int col=0; col<3; ++col)
+		{
+			for(int row=0; row<3; ++row)
+				out.m[col][row] = float(r[col][row]);
+		}
+
+		for(int row=0; row<3; ++row)
+			out.m[3][row] = float(-(r[0][row] * m[3][0] + r[1][row] * m[3][1] + r[2][row] * m[3][2]));
+
+		out.m[3][3] = 1.0f;
+		return true;
+	}
 }
 
+enum class AccessMode
+{
+	Trusted,	// validated blocks are read without per-access checks
+	Untrusted	// every typed access is bounds checked
+};
+
+struct BlockValidationReport
+{
+	size_t truncatedBlocks{ 0 };	// block header or payload runs past the end of the file
+	size_t badSdnaIndex{ 0 };		// sdnaIndex >= number of SDNA structs
+	size_t payloadTooSmall{ 0 };	// size < struct length * count
+	size_t invalidStructs{ 0 };		// SDNA struct whose fields don't fit its length, or bad type/name index
+	size_t orphanDataBlocks{ 0 };	// DATA block without a preceding parent block
+
+	bool IsValid() const
+	{
+		return (truncatedBlocks | badSdnaIndex | payloadTooSmall | invalidStructs | orphanDataBlocks) == 0;
+	}
+
+	void Print() const
+	{
+		std::cout << "Block validation: " << (IsValid() ? "OK" : "issues found") << '\n';
+		if(IsValid())
+			return;
+
+		std::cout << "  truncated blocks: " << truncatedBlocks << '\n';
+		std::cout << "  bad sdna index: " << badSdnaIndex << '\n';
+		std::cout << "  payload smaller than struct * count: " << payloadTooSmall << '\n';
+		std::cout << "  invalid sdna structs: " << invalidStructs << '\n';
+		std::cout << "  DATA blocks without parent: " << orphanDataBlocks << '\n';
+	}
+};
+
+enum class MeshRepair
+{
+	None,	// report only
+	Drop,	// drop every poly/edge which has a bad index or is degenerate/duplicate
+	Clamp	// clamp bad indices into range, drop only what is still degenerate/duplicate afterwards
+};
+
+struct MeshValidationReport
+{
+	size_t loopVertOutOfRange{ 0 };	// MLoop.v >= totvert or < 0
+	size_t loopEdgeOutOfRange{ 0 };	// MLoop.e >= totedge or < 0
+	size_t edgeVertOutOfRange{ 0 };	// MEdge.v1/v2 >= totvert or < 0
+	size_t degenerateEdges{ 0 };	// v1 == v2
+	size_t polyLoopOutOfRange{ 0 };	// loopstart + totloop > totloop of mesh
+	size_t polyBadEdge{ 0 };		// uses an out of range or degenerate edge (repair only, the edge is dropped)
+	size_t degeneratePolys{ 0 };	// less than 3 loops or repeated vertex
+	size_t duplicatePolys{ 0 };		// same vertex set as an earlier poly
+	size_t vertCountMismatch{ 0 };	// difference of Mesh.verts_num and the vertices actually read
+	size_t polyCountMismatch{ 0 };	// difference of Mesh.faces_num and the polys actually read
+
+	size_t clampedIndices{ 0 };
+	size_t droppedEdges{ 0 };
+	size_t droppedPolys{ 0 };
+
+	bool IsValid() const
+	{
+		return (loopVertOutOfRange | loopEdgeOutOfRange | edgeVertOutOfRange | degenerateEdges |
+				polyLoopOutOfRange | polyBadEdge | degeneratePolys | duplicatePolys | vertCountMismatch | polyCountMismatch) == 0;
+	}
+
+	void Print() const
+	{
+		std::cout << "Mesh validation: " << (IsValid() ? "OK" : "issues found") << '\n';
+		if(IsValid())
+			return;
+
+		std::cout << "  loop vertex out of range: " << loopVertOutOfRange << '\n';
+		std::cout << "  loop edge out of range: " << loopEdgeOutOfRange << '\n';
+		std::cout << "  edge vertex out of range: " << edgeVertOutOfRange << '\n';
+		std::cout << "  degenerate edges: " << degenerateEdges << '\n';
+		std::cout << "  poly loop range out of range: " << polyLoopOutOfRange << '\n';
+		std::cout << "  poly using a bad edge: " << polyBadEdge << '\n';
+		std::cout << "  degenerate polys: " << degeneratePolys << '\n';
+		std::cout << "  duplicate polys: " << duplicatePolys << '\n';
+		std::cout << "  vertex count mismatch: " << vertCountMismatch << '\n';
+		std::cout << "  poly count mismatch: " << polyCountMismatch << '\n';
+		std::cout << "  repair - clamped: " << clampedIndices << " dropped edges: " << droppedEdges << " dropped polys: " << droppedPolys << '\n';
+	}
+};
+
 class blendMesh
 {
 	public:
 		friend class blendExpl;
 
-	protected:
-		void Read_MVert(MemorySpan span, size_t count) const
+		const std::vector<blender::MVert>& Verts() const { return verts; }
+		const std::vector<blender::MEdge>& Edges() const { return edges; }
+		const std::vector<blender::MLoop>& Loops() const { return loops; }
+		const std::vector<blender::MPoly>& Polys() const { return polys; }
+		size_t NumUvLayers() const { return uvLayers.size(); }
+
+		std::vector<blender::Float3> Positions() const
 		{
-			for(size_t i=0; i<count; ++i)
+			std::vector<blender::Float3> positions(verts.size());
+			WritePositions(positions.data());
+			return positions;
+		}
+
+		// 'out' holds Verts().size() elements, can be any memory (eg. a shared memory arena).
+		void WritePositions(blender::Float3* out) const
+		{
+			std::transform(std::execution::par_unseq, verts.begin(), verts.end(), out, [](const blender::MVert& v)
 			{
-				const auto* mvert = ReadTypePtr<blender::MVert>(span);
-				std::cout << "Vertex#" << i << " coord (" << mvert->co[0] << ", " << mvert->co[1] << ", " << mvert->co[0] << ") ";
+				return blender::Float3{ v.co[0], v.co[1], v.co[2] };
+			});
+		}
 
-				blender::Float3 normalf;
-				blender::NormalShortToFloat(&normalf.x, mvert->no);
-				std::cout << "normal (" << normalf.x << ", " <<normalf.y << ", " << normalf.z << ")\n";
-			}
+		// Fan triangulation of every poly, 3 vertex indices per triangle. Expects a validated mesh.
+		std::vector<uint32_t> Triangulate() const
+		{
+			std::vector<size_t> firstTri;
+			std::vector<uint32_t> indices(CountTriangles(firstTri) * 3);
+			WriteTriangles(firstTri, indices.data());
+			return indices;
 		}
 
-		void Read_MDeformVert(MemorySpan span, size_t count)
+		// First triangle of every poly (prefix sum, one extra element at the end), returns the number of triangles.
+		size_t CountTriangles(std::vector<size_t>& firstTri) const
 		{
-			for(size_t i=0; i<count; ++i)
-			{
-				const auto* dvert = ReadTypePtr<blender::MDeformVert>(span);
-				std::cout << "VertexGroup#" << i << " num_weights: " << dvert->totweight << '\n';
-			}
+			firstTri.assign(polys.size() + 1, 0);
+			std::transform_inclusive_scan(std::execution::par, polys.begin(), polys.end(), firstTri.begin() + 1, std::plus<>(),
+				[](const blender::MPoly& p) { return size_t(std::max(p.totloop - 2, 0)); });
+
+			return firstTri.back();
 		}
 
-		void Read_MDeformWeight(MemorySpan span, size_t count)
+		// 'out' holds 3 * CountTriangles() elements.
+		void WriteTriangles(const std::vector<size_t>& firstTri, uint32_t* out) const
 		{
-			for(size_t i=0; i<count; ++i)
+			std::for_each(std::execution::par, polys.begin(), polys.end(), [&](const blender::MPoly& p)
 			{
-				const auto* dweight = ReadTypePtr<blender::MDeformWeight>(span);
-				std::cout << "Weight#" << numWeights << "_" << i << " def_nr: " << dweight->def_nr << " w: " << ' ' << dweight->weight << '\n';
-				numWeights++;
-			}
+				uint32_t* tri = out + firstTri[&p - polys.data()] * 3;
+				for(int32_t l=1; l + 1<p.totloop; ++l)
+				{
+					*tri++ = loops[p.loopstart].v;
+					*tri++ = loops[p.loopstart + l].v;
+					*tri++ = loops[p.loopstart + l + 1].v;
+				}
+			});
 		}
 
-		void Read_MLoopUV(MemorySpan span, size_t count) const
+		// UVs of a layer per corner of Triangulate(), empty if the layer doesn't cover the loops.
+		std::vector<blender::Float2> TriangulatedUvs(size_t layer) const
 		{
-			for(size_t i=0; i<count; ++i)
+			if(layer >= uvLayers.size() || uvLayers[layer].size() < loops.size())
+				return {};
+
+			std::vector<size_t> firstTri;
+			std::vector<blender::Float2> uvs(CountTriangles(firstTri) * 3);
+			const auto& layerUvs = uvLayers[layer];
+			std::for_each(std::execution::par, polys.begin(), polys.end(), [&](const blender::MPoly& p)
 			{
-				const auto* mloop = ReadTypePtr<blender::MLoopUV>(span);
-				std::cout << "LoopUV#" << i << " (" << mloop->uv[0] << ", " << mloop->uv[1] << ")\n";
-			}
+				blender::Float2* tri = uvs.data() + firstTri[&p - polys.data()] * 3;
+				for(int32_t l=1; l + 1<p.totloop; ++l)
+				{
+					for(const int32_t loop: { p.loopstart, p.loopstart + l, p.loopstart + l + 1 })
+						*tri++ = blender::Float2{ layerUvs[loop].uv[0], layerUvs[loop].uv[1] };
+				}
+			});
+
+			return uvs;
 		}
 
-		void Read_MLoop(MemorySpan span, size_t count) const
+		/*
+		* Checks every index of the extracted arrays. The common case (a healthy mesh) is decided by one
+		* parallel min/max reduction per index stream, the per-element passes only run for the streams
+		* which actually leave their valid range.
+		*/
+		MeshValidationReport Validate(MeshRepair repair = MeshRepair::None)
 		{
-			for(size_t i=0; i<count; ++i)
+			MeshValidationReport report;
+
+			// a mesh whose arrays weren't found (eg. a layout this reader doesn't know) must not pass as valid and empty
+			const auto countMismatch = [](int64_t declared, size_t read) { return declared < 0 ? size_t(0) : size_t(std::abs(declared - int64_t(read))); };
+			report.vertCountMismatch = countMismatch(declaredVerts, verts.size());
+			report.polyCountMismatch = countMismatch(declaredPolys, polys.size());
+
+			if(repair == MeshRepair::Clamp)
+				report.clampedIndices = ClampIndices();
+
+			const int64_t numVerts = static_cast<int64_t>(verts.size());
+			const int64_t numEdges = static_cast<int64_t>(edges.size());
+			const int64_t numLoops = static_cast<int64_t>(loops.size());
+
+			const IndexRange loopVertRange = ReduceRange(loops, [](const blender::MLoop& l) { return IndexRange{ l.v, l.v }; });
+			const IndexRange loopEdgeRange = ReduceRange(loops, [](const blender::MLoop& l) { return IndexRange{ l.e, l.e }; });
+			const IndexRange edgeVertRange = ReduceRange(edges, [](const blender::MEdge& e) { return IndexRange{ std::min(e.v1, e.v2), std::max(e.v1, e.v2) }; });
+			const IndexRange polyLoopRange = ReduceRange(polys, [](const blender::MPoly& p) { return IndexRange{ std::min(p.loopstart, p.totloop), int64_t(p.loopstart) + p.totloop }; });
+
+			std::vector<uint8_t> badLoop;
+			if(!loopVertRange.Within(numVerts) || !loopEdgeRange.Within(numEdges))
 			{
-				const auto* mloop = ReadTypePtr<blender::MLoop>(span);
-				std::cout << "Loop#" << i << " v: " << mloop->v << " e: " << mloop->e << '\n';
+				badLoop.resize(loops.size());
+				std::transform(std::execution::par_unseq, loops.begin(), loops.end(), badLoop.begin(), [=](const blender::MLoop& l)
+				{
+					return static_cast<uint8_t>((l.v < 0 || l.v >= numVerts ? 1 : 0) | (l.e < 0 || l.e >= numEdges ? 2 : 0));
+				});
+
+				report.loopVertOutOfRange = std::count_if(std::execution::par_unseq, badLoop.begin(), badLoop.end(), [](uint8_t b) { return (b & 1) != 0; });
+				report.loopEdgeOutOfRange = std::count_if(std::execution::par_unseq, badLoop.begin(), badLoop.end(), [](uint8_t b) { return (b & 2) != 0; });
 			}
-		}
 
-		void Read_MLoopCol(MemorySpan span, size_t count) const
-		{
-			for(size_t i=0; i<count; ++i)
+			// edges
+			std::vector<uint8_t> badEdge(edges.size(), 0);
+			std::transform(std::execution::par_unseq, edges.begin(), edges.end(), badEdge.begin(), [=](const blender::MEdge& e)
+			{
+				const bool outOfRange = (e.v1 < 0 || e.v1 >= numVerts || e.v2 < 0 || e.v2 >= numVerts);
+				return static_cast<uint8_t>((outOfRange ? EdgeOutOfRange : 0) | (e.v1 == e.v2 ? EdgeDegenerate : 0));
+			});
+
+			if(!edgeVertRange.Within(numVerts))
+				report.edgeVertOutOfRange = std::count_if(std::execution::par_unseq, badEdge.begin(), badEdge.end(), [](uint8_t b) { return (b & EdgeOutOfRange) != 0; });
+			report.degenerateEdges = std::count_if(std::execution::par_unseq, badEdge.begin(), badEdge.end(), [](uint8_t b) { return (b & EdgeDegenerate) != 0; });
+
+			// polys
+			const bool checkPolyRange = !polyLoopRange.Within(numLoops + 1);
+			std::vector<uint8_t> badPoly(polys.size(), 0);
+			std::transform(std::execution::par, polys.begin(), polys.end(), badPoly.begin(), [&](const blender::MPoly& p)
+			{
+				if(checkPolyRange && (p.loopstart < 0 || p.totloop < 0 || int64_t(p.loopstart) + p.totloop > numLoops))
+					return PolyOutOfRange;
+
+				if(p.totloop < 3)
+					return PolyDegenerate;
+
+				for(int32_t l=p.loopstart; l<p.loopstart + p.totloop; ++l)
+				{
+					if(!badLoop.empty() && badLoop[l] != 0)
+						return PolyOutOfRange;
+
+					if(repair != MeshRepair::None && badEdge[loops[l].e] != 0)
+						return PolyBadEdge;
+				}
+
+				for(int32_t a=p.loopstart; a<p.loopstart + p.totloop; ++a)
+					for(int32_t b=a + 1; b<p.loopstart + p.totloop; ++b)
+						if(loops[a].v == loops[b].v)
+							return PolyDegenerate;
+
+				return uint8_t(0);
+			});
+
+			report.polyLoopOutOfRange = std::count(std::execution::par_unseq, badPoly.begin(), badPoly.end(), PolyOutOfRange);
+			report.polyBadEdge = std::count(std::execution::par_unseq, badPoly.begin(), badPoly.end(), PolyBadEdge);
+			report.degeneratePolys = std::count(std::execution::par_unseq, badPoly.begin(), badPoly.end(), PolyDegenerate);
+			report.duplicatePolys = MarkDuplicatePolys(badPoly);
+
+			if(repair != MeshRepair::None)
 			{
-				const auto* mcol = ReadTypePtr<blender::MLoopCol>(span);
-				//std::cout << "Color# " << i << " (" << mcol->r << ',' << mcol->g << ',' << mcol->b << ',' << mcol->a << ")\n";
+				report.droppedEdges = DropEdges(badEdge);
+				report.droppedPolys = DropPolys(badPoly);
+
+				// the repaired arrays are the mesh from here on
+				declaredVerts = static_cast<int64_t>(verts.size());
+				declaredPolys = static_cast<int64_t>(polys.size());
 			}
+
+			return report;
 		}
 
-		void Read_MEdge(MemorySpan span, size_t count) const
+	protected:
+		struct IndexRange
 		{
-			for(size_t i=0; i<count; ++i)
-			{
-				const auto* edge = ReadTypePtr<blender::MEdge>(span);
-				std::cout << "Edge#" << i << " (" << edge->v1 << ", " << edge->v2 << ")\n";
-			}
+			int64_t min{ std::numeric_limits<int64_t>::max() };
+			int64_t max{ std::numeric_limits<int64_t>::min() };
+
+			bool Within(int64_t count) const { return min > max || (min >= 0 && max < count); }
+		};
+
+		static constexpr uint8_t EdgeOutOfRange = 1;
+		static constexpr uint8_t EdgeDegenerate = 2;
+
+		static constexpr uint8_t PolyOutOfRange = 1;
+		static constexpr uint8_t PolyDegenerate = 2;
+		static constexpr uint8_t PolyDuplicate = 3;
+		static constexpr uint8_t PolyBadEdge = 4;
+
+		template<typename T, typename F>
+		static IndexRange ReduceRange(const std::vector<T>& array, F&& toRange)
+		{
+			return std::transform_reduce(std::execution::par_unseq, array.begin(), array.end(), IndexRange{},
+				[](const IndexRange& a, const IndexRange& b) { return IndexRange{ std::min(a.min, b.min), std::max(a.max, b.max) }; },
+				[&](const T& elem) { const IndexRange r = toRange(elem); return IndexRange{ r.min, r.max }; });
 		}
 
-		void Read_MPoly(MemorySpan span, size_t count) const
+		size_t ClampIndices()
 		{
-			for(size_t i=0; i<count; ++i)
+			// an empty target array has no index to clamp to: its loops go, their polys are left without loops and
+			// dropped as degenerate, edges without vertices stay out of range and are dropped
+			if(verts.empty() || edges.empty())
+				loops.clear();
+
+			const int32_t maxVert = int32_t(verts.size()) - 1;
+			const int32_t maxEdge = int32_t(edges.size()) - 1;
+			const int32_t numLoops = int32_t(loops.size());
+
+			const auto clampIndex = [](int32_t& idx, int32_t hi)
 			{
-				const auto* poly = ReadTypePtr<blender::MPoly>(span);
-				std::cout << "Poly#" << i << " loopstart: " << poly->loopstart << " totloop: " << poly->totloop << '\n';
+				const int32_t c = std::clamp(idx, 0, hi);
+				const size_t changed = (c != idx ? 1 : 0);
+				idx = c;
+				return changed;
+			};
+
+			size_t clamped = 0;
+			clamped += std::transform_reduce(std::execution::par_unseq, loops.begin(), loops.end(), size_t(0), std::plus<>(),
+				[&](blender::MLoop& l) { return clampIndex(l.v, maxVert) + clampIndex(l.e, maxEdge); });
+			if(!verts.empty())
+			{
+				clamped += std::transform_reduce(std::execution::par_unseq, edges.begin(), edges.end(), size_t(0), std::plus<>(),
+					[&](blender::MEdge& e) { return clampIndex(e.v1, maxVert) + clampIndex(e.v2, maxVert); });
 			}
-		}
+			clamped += std::transform_reduce(std::execution::par_unseq, polys.begin(), polys.end(), size_t(0), std::plus<>(),
+				[&](blender::MPoly& p)
+				{
+					const size_t start = clampIndex(p.loopstart, numLoops);
+					return start + clampIndex(p.totloop, numLoops - p.loopstart);
+				});
 
-		size_t numWeights{ 0 };
-};
+			return clamped;
+		}
 
-/*
-* Traverse:
-*	- Scene:
-*		- Time Markers (for animation identification eg. 'enemy_run' frames[20,50])
-*		- Master Collection:
-*			- Objects
-*				- Armature
-*					- Bones
-*						- BonePose
-*				- Mesh
-*					- Verts/Edges/Loops/Weights
-*				- Key (ShapeKeys for vertex animations)
-*/
+		// Keeps the first poly of every vertex set, marks the rest. Only polys that passed the other checks take part.
+		size_t MarkDuplicatePolys(std::vector<uint8_t>& badPoly) const
+		{
+			std::vector<uint64_t> keys(polys.size(), 0);
+			std::transform(std::execution::par, polys.begin(), polys.end(), badPoly.begin(), keys.begin(), [&](const blender::MPoly& p, uint8_t bad) -> uint64_t
+			{
+				if(bad != 0)
+					return 0;
 
-class blendExpl
-{
-	public:
-		~blendExpl()
+				// order independent hash of the vertex set
+				uint64_t sum = 0, mix = 0;
+				for(int32_t l=p.loopstart; l<p.loopstart + p.totloop; ++l)
+				{
+					const uint64_t h = (uint64_t(uint32_t(loops[l].v)) + 1) * 0x9E3779B97F4A7C15ull;
+					sum += h;
+					mix ^= (h >> 29) | (h << 35);
+				}
+
+				return (sum ^ (mix * 0xBF58476D1CE4E5B9ull) ^ uint64_t(p.totloop)) | 1; // never 0, 0 marks skipped polys
+			});
+
+			std::vector<uint32_t> order(polys.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::sort(std::execution::par_unseq, order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] != keys[b] ? keys[a] < keys[b] : a < b; });
+
+			const auto sortedVerts = [&](const blender::MPoly& p)
+			{
+				std::vector<int32_t> v(p.totloop);
+				for(int32_t l=0; l<p.totloop; ++l)
+					v[l] = loops[p.loopstart + l].v;
+				std::sort(v.begin(), v.end());
+				return v;
+			};
+
+			size_t duplicates = 0;
+			for(size_t i=0; i<order.size(); )
+			{
+				size_t j = i + 1;
+				while(j < order.size() && keys[order[j]] == keys[order[i]])
+					++j;
+
+				if(keys[order[i]] != 0 && j - i > 1)
+				{
+					// hash collision candidates, compare the real vertex sets
+					for(size_t a=i; a<j; ++a)
+					{
+						if(badPoly[order[a]] != 0)
+							continue;
+
+						const auto va = sortedVerts(polys[order[a]]);
+						for(size_t b=a + 1; b<j; ++b)
+						{
+							if(badPoly[order[b]] == 0 && sortedVerts(polys[order[b]]) == va)
+							{
+								badPoly[order[b]] = PolyDuplicate;
+								duplicates++;
+							}
+						}
+					}
+				}
+
+				i = j;
+			}
+
+			return duplicates;
+		}
+
+		size_t DropEdges(const std::vector<uint8_t>& badEdge)
 		{
-			Cleanup();
+			std::vector<int32_t> remap(edges.size());
+			int32_t kept = 0;
+			for(size_t i=0; i<edges.size(); ++i)
+			{
+				remap[i] = (badEdge[i] == 0 ? kept : -1);
+				if(badEdge[i] == 0)
+					edges[kept++] = edges[i];
+			}
+
+			const size_t dropped = edges.size() - kept;
+			if(dropped == 0)
+				return 0;
+
+			edges.resize(kept);
+
+			// loops of dropped edges only survive inside dropped polys, point them at edge 0 to keep the array in range
+			std::for_each(std::execution::par_unseq, loops.begin(), loops.end(), [&](blender::MLoop& l)
+			{
+				l.e = (l.e >= 0 && size_t(l.e) < remap.size() && remap[l.e] >= 0 ? remap[l.e] : 0);
+			});
+
+			return dropped;
 		}
 
-		void Explore()
+		size_t DropPolys(const std::vector<uint8_t>& badPoly)
 		{
-			if(ParseFile(BLEND_FILE))
+			size_t kept = 0;
+			for(size_t i=0; i<polys.size(); ++i)
 			{
-				std::cout << '\n';
+				if(badPoly[i] == 0)
+					polys[kept++] = polys[i];
+			}
 
-				blendMesh mesh;
-				//ExploreMeshData(mesh);
+			const size_t dropped = polys.size() - kept;
+			polys.resize(kept);
+			return dropped;
+		}
 
-				//PrintStructByName("Object");
-				//ExploreNonDataBlocks();
-				//ExploreDataBlocks();
-				//ExploreObjectData();
-				//ExploreScene();
-				ExploreArmature();
+		template<typename T>
+		void LoadArray(std::vector<T>& out, const StridedView<T>& view)
+		{
+			const size_t first = out.size();
+			out.resize(first + view.Size());
+			view.Gather(out.data() + first, 0, view.Size());
+		}
+
+		// views use the SDNA struct length as stride, so a file struct which grew at its end still loads
+		void Load_MVert(const StridedView<blender::MVert>& view) { LoadArray(verts, view); }
+		void Load_MEdge(const StridedView<blender::MEdge>& view) { LoadArray(edges, view); }
+		void Load_MLoop(const StridedView<blender::MLoop>& view) { LoadArray(loops, view); }
+		void Load_MPoly(const StridedView<blender::MPoly>& view) { LoadArray(polys, view); }
+		void Load_MLoopUV(const StridedView<blender::MLoopUV>& view) { LoadArray(uvLayers.emplace_back(), view); } // a block per layer
+
+		// 3.4+ meshes keep their arrays as generic attributes, these rebuild the legacy structs from them (flags, normals and materials stay 0)
+		void Load_Positions(const StridedView<blender::Float3>& view)
+		{
+			std::vector<blender::Float3> positions(view.Size());
+			view.Gather(positions.data(), 0, view.Size());
+
+			verts.resize(positions.size());
+			std::transform(std::execution::par_unseq, positions.begin(), positions.end(), verts.begin(), [](const blender::Float3& co)
+			{
+				return blender::MVert{ { co.x, co.y, co.z }, {}, 0, 0 };
+			});
+		}
+
+		// '.edge_verts' is an int2 per edge, 'v1' and 'v2' view its two components
+		void Load_EdgeVerts(const StridedView<int32_t>& v1, const StridedView<int32_t>& v2)
+		{
+			edges.resize(std::min(v1.Size(), v2.Size()));
+			for(size_t i=0; i<edges.size(); ++i)
+				edges[i] = blender::MEdge{ v1[i], v2[i], 0, 0, 0 };
+		}
+
+		// a missing '.corner_edge' leaves the edge indices at -1, so validation reports them
+		void Load_Corners(const StridedView<int32_t>& cornerVerts, const StridedView<int32_t>& cornerEdges)
+		{
+			loops.resize(cornerVerts.Size());
+			for(size_t i=0; i<loops.size(); ++i)
+				loops[i] = blender::MLoop{ cornerVerts[i], i < cornerEdges.Size() ? cornerEdges[i] : -1 };
+		}
+
+		// a float2 corner attribute per UV layer, in layer order
+		void Load_UvLayer(const StridedView<blender::Float2>& view)
+		{
+			auto& layer = uvLayers.emplace_back(view.Size());
+			for(size_t i=0; i<layer.size(); ++i)
+			{
+				const blender::Float2 uv = view[i];
+				layer[i] = blender::MLoopUV{ { uv.x, uv.y }, 0 };
 			}
 		}
 
-		void ExploreNonDataBlocks()
+		// faces_num + 1 offsets into the corners, face i uses [offsets[i], offsets[i + 1])
+		void Load_FaceOffsets(const StridedView<int32_t>& offsets)
 		{
-			for(const auto& block: m_blockArray)
+			polys.resize(offsets.Size() > 0 ? offsets.Size() - 1 : 0);
+			for(size_t i=0; i<polys.size(); ++i)
+				polys[i] = blender::MPoly{ offsets[i], offsets[i + 1] - offsets[i], 0, 0, 0 };
+		}
+
+		// Mesh.verts_num / faces_num, Validate() reports arrays which don't hold that many elements. -1 = unknown
+		void SetDeclaredCounts(int64_t numVerts, int64_t numPolys)
+		{
+			declaredVerts = numVerts;
+			declaredPolys = numPolys;
+		}
+
+		void Read_MVert(MemorySpan span, size_t count) const
+		{
+			for(size_t i=0; i<count; ++i)
 			{
-				if(Identify(block.desc.code, "DATA", 4))
-					continue;
+				const auto mvert = ReadType<blender::MVert>(span);
+				std::cout << "Vertex#" << i << " coord (" << mvert.co[0] << ", " << mvert.co[1] << ", " << mvert.co[0] << ") ";
 
-				PrintBlockSDNA(block);
-				PrintStructBySDNA(block.desc.sdnaIndex);
+				blender::Float3 normalf;
+				blender::NormalShortToFloat(&normalf.x, mvert.no);
+				std::cout << "normal (" << normalf.x << ", " <<normalf.y << ", " << normalf.z << ")\n";
 			}
 		}
 
-		void ExploreDataBlocks()
+		void Read_MDeformVert(MemorySpan span, size_t count)
 		{
-			size_t fcurves = 0;
-			size_t actiongrps = 0;
-			size_t beztriples = 0;
+			for(size_t i=0; i<count; ++i)
+			{
+				const auto dvert = ReadType<blender::MDeformVert>(span);
+				std::cout << "VertexGroup#" << i << " num_weights: " << dvert.totweight << '\n';
+			}
+		}
 
-			for(const auto& block: m_blockArray)
+		void Read_MDeformWeight(MemorySpan span, size_t count)
+		{
+			for(size_t i=0; i<count; ++i)
 			{
-				if(!Identify(block.desc.code, "DATA", 4))
-					continue;
+				const auto dweight = ReadType<blender::MDeformWeight>(span);
+				std::cout << "Weight#" << numWeights << "_" << i << " def_nr: " << dweight.def_nr << " w: " << ' ' << dweight.weight << '\n';
+				numWeights++;
+			}
+		}
 
-				if(IdentifyStruct(block.desc.sdnaIndex, "FCurve"))
+		void Read_MLoopUV(MemorySpan span, size_t count) const
+		{
+			for(size_t i=0; i<count; ++i)
+			{
+				const auto mloop = ReadType<blender::MLoopUV>(span);
+				std::cout << "LoopUV#" << i << " (" << mloop.uv[0] << ", " << mloop.uv[1] << ")\n";
+			}
+		}
+
+		void Read_MLoop(MemorySpan span, size_t count) const
+		{
+			for(size_t i=0; i<count; ++i)
+			{
+				const auto mloop = ReadType<blender::MLoop>(span);
+				std::cout << "Loop#" << i << " v: " << mloop.v << " e: " << mloop.e << '\n';
+			}
+		}
+
+		void Read_MLoopCol(MemorySpan span, size_t count) const
+		{
+			for(size_t i=0; i<count; ++i)
+			{
+				const auto mcol = ReadType<blender::MLoopCol>(span);
+				//std::cout << "Color# " << i << " (" << mcol.r << ',' << mcol.g << ',' << mcol.b << ',' << mcol.a << ")\n";
+			}
+		}
+
+		void Read_MEdge(MemorySpan span, size_t count) const
+		{
+			for(size_t i=0; i<count; ++i)
+			{
+				const auto edge = ReadType<blender::MEdge>(span);
+				std::cout << "Edge#" << i << " (" << edge.v1 << ", " << edge.v2 << ")\n";
+			}
+		}
+
+		void Read_MPoly(MemorySpan span, size_t count) const
+		{
+			for(size_t i=0; i<count; ++i)
+			{
+				const auto poly = ReadType<blender::MPoly>(span);
+				std::cout << "Poly#" << i << " loopstart: " << poly.loopstart << " totloop: " << poly.totloop << '\n';
+			}
+		}
+
+		size_t numWeights{ 0 };
+		int64_t declaredVerts{ -1 };
+		int64_t declaredPolys{ -1 };
+
+		std::vector<blender::MVert> verts;
+		std::vector<blender::MEdge> edges;
+		std::vector<blender::MLoop> loops;
+		std::vector<blender::MPoly> polys;
+		std::vector<std::vector<blender::MLoopUV>> uvLayers;
+};
+
+struct ChunkingOptions
+{
+	size_t maxTriangles{ 1 << 16 };	// triangle budget of a chunk
+	size_t maxBytes{ 0 };			// optional byte budget of a chunk (vertex + index buffer), 0 = unused
+	size_t numLods{ 3 };			// LOD levels after the full resolution one
+	uint32_t maxDepth{ 20 };		// octree depth limit, stops splitting coincident triangles forever
+};
+
+struct MeshChunk
+{
+	blender::Float3 boundsMin;
+	blender::Float3 boundsMax;
+	std::vector<blender::Float3> positions;		// compacted vertex buffer of the chunk
+	std::vector<uint32_t> sourceVertex;			// chunk vertex -> vertex index in the source mesh
+	std::vector<std::vector<uint32_t>> lods;	// index buffers into 'positions', lods[0] is full resolution
+};
+
+/*
+* Splits a triangle soup into spatial chunks for streaming: an octree over triangle centroids is refined one level
+* at a time, every node over budget of the level is split in parallel. Leaves become chunks, which are compacted
+* and decimated (vertex clustering, chunk border vertices locked so neighbouring LODs don't crack) in parallel.
+*/
+class meshPartitioner
+{
+	public:
+		explicit meshPartitioner(const ChunkingOptions& options = {}) : m_options(options)
+		{
+			// estimate of a closed triangle mesh: ~0.5 vertex per triangle, 3 indices per triangle
+			if(m_options.maxBytes != 0)
+			{
+				const size_t bytesPerTriangle = 3 * sizeof(uint32_t) + sizeof(blender::Float3) / 2;
+				m_options.maxTriangles = std::min(m_options.maxTriangles, std::max<size_t>(m_options.maxBytes / bytesPerTriangle, 1));
+			}
+		}
+
+		std::vector<MeshChunk> Partition(const std::vector<blender::Float3>& positions, const std::vector<uint32_t>& indices) const
+		{
+			const size_t numTris = indices.size() / 3;
+
+			std::vector<blender::Float3> centroids(numTris);
+			std::vector<uint32_t> tris(numTris);
+			std::iota(tris.begin(), tris.end(), 0);
+			std::for_each(std::execution::par_unseq, tris.begin(), tris.end(), [&](uint32_t t)
+			{
+				const blender::Float3& a = positions[indices[t * 3]];
+				const blender::Float3& b = positions[indices[t * 3 + 1]];
+				const blender::Float3& c = positions[indices[t * 3 + 2]];
+				centroids[t] = blender::Float3{ (a.x + b.x + c.x) / 3.0f, (a.y + b.y + c.y) / 3.0f, (a.z + b.z + c.z) / 3.0f };
+			});
+
+			// octree nodes are [begin, end) ranges of 'tris', splitting reorders the range in place
+			std::vector<Node> leaves;
+			std::vector<Node> level = { Node{ 0, numTris, Bounds(centroids, tris, 0, numTris), 0 } };
+
+			while(!level.empty())
+			{
+				std::vector<std::array<Node, 8>> children(level.size());
+				std::vector<uint8_t> split(level.size(), 0);
+
+				std::for_each(std::execution::par, level.begin(), level.end(), [&](const Node& node)
 				{
-					const uint32_t totvert = *PeekTypePtr<char>(block.data, GetFieldOffset("FCurve", "totvert"));
-					std::cout << "FCurve totvert: " << totvert << '\n';
-					fcurves++;
+					const size_t n = &node - level.data();
+					if(node.end - node.begin <= m_options.maxTriangles || node.depth >= m_options.maxDepth)
+						return;
+
+					split[n] = 1;
+					SplitNode(node, centroids, tris, children[n]);
+				});
+
+				std::vector<Node> nextLevel;
+				for(size_t n=0; n<level.size(); ++n)
+				{
+					if(split[n] == 0)
+					{
+						if(level[n].end > level[n].begin)
+							leaves.emplace_back(level[n]);
+						continue;
+					}
+
+					for(const Node& child: children[n])
+						if(child.end > child.begin)
+							nextLevel.emplace_back(child);
 				}
-				else if(IdentifyStruct(block.desc.sdnaIndex, "bActionGroup"))
+
+				level = std::move(nextLevel);
+			}
+
+			// vertices referenced by more than one chunk form the chunk borders
+			std::vector<std::atomic<uint32_t>> vertexOwner(positions.size());
+			std::vector<std::atomic<uint8_t>> vertexShared(positions.size());
+			std::for_each(std::execution::par_unseq, vertexOwner.begin(), vertexOwner.end(), [](std::atomic<uint32_t>& owner) { owner.store(NoOwner, std::memory_order_relaxed); });
+			std::for_each(std::execution::par, leaves.begin(), leaves.end(), [&](const Node& leaf)
+			{
+				const uint32_t chunk = uint32_t(&leaf - leaves.data());
+				for(size_t t=leaf.begin; t<leaf.end; ++t)
 				{
-					const std::string_view name(PeekTypePtr<char>(block.data, GetFieldOffset("bActionGroup", "name[64]")));
-					std::cout << "Action group name: " << name << '\n';
+					for(size_t k=0; k<3; ++k)
+					{
+						const uint32_t v = indices[tris[t] * 3 + k];
+						uint32_t expected = NoOwner;
+						if(!vertexOwner[v].compare_exchange_strong(expected, chunk, std::memory_order_relaxed) && expected != chunk)
+							vertexShared[v].store(1, std::memory_order_relaxed);
+					}
+				}
+			});
 
-					actiongrps++;
+			std::vector<MeshChunk> chunks(leaves.size());
+			std::for_each(std::execution::par, leaves.begin(), leaves.end(), [&](const Node& leaf)
+			{
+				MeshChunk& chunk = chunks[&leaf - leaves.data()];
+				CompactChunk(leaf, positions, indices, tris, chunk);
+				BuildLods(chunk, [&](uint32_t chunkVertex) { return vertexShared[chunk.sourceVertex[chunkVertex]].load(std::memory_order_relaxed) != 0; });
+			});
+
+			return chunks;
+		}
+
+	private:
+		static constexpr uint32_t NoOwner = std::numeric_limits<uint32_t>::max();
+
+		struct Node
+		{
+			size_t begin;
+			size_t end;
+			std::array<blender::Float3, 2> bounds; // of the centroids
+			uint32_t depth;
+		};
+
+		static std::array<blender::Float3, 2> Bounds(const std::vector<blender::Float3>& points, const std::vector<uint32_t>& ids, size_t begin, size_t end)
+		{
+			using Box = std::array<blender::Float3, 2>;
+			const float inf = std::numeric_limits<float>::infinity();
+
+			return std::transform_reduce(std::execution::par_unseq, ids.begin() + begin, ids.begin() + end, Box{ blender::Float3{ inf, inf, inf }, blender::Float3{ -inf, -inf, -inf } },
+				[](const Box& a, const Box& b)
+				{
+					return Box{ blender::Float3{ std::min(a[0].x, b[0].x), std::min(a[0].y, b[0].y), std::min(a[0].z, b[0].z) },
+								blender::Float3{ std::max(a[1].x, b[1].x), std::max(a[1].y, b[1].y), std::max(a[1].z, b[1].z) } };
+				},
+				[&](uint32_t id) { return Box{ points[id], points[id] }; });
+		}
+
+		static void SplitNode(const Node& node, const std::vector<blender::Float3>& centroids, std::vector<uint32_t>& tris, std::array<Node, 8>& children)
+		{
+			const blender::Float3 center{ (node.bounds[0].x + node.bounds[1].x) * 0.5f, (node.bounds[0].y + node.bounds[1].y) * 0.5f, (node.bounds[0].z + node.bounds[1].z) * 0.5f };
+
+			// thin axes are not split (terrain becomes a quadtree instead of slicing its height into interleaved chunks)
+			const blender::Float3 size{ node.bounds[1].x - node.bounds[0].x, node.bounds[1].y - node.bounds[0].y, node.bounds[1].z - node.bounds[0].z };
+			const float minSplitSize = std::max({ size.x, size.y, size.z }) * 0.5f;
+			const bool splitX = size.x >= minSplitSize, splitY = size.y >= minSplitSize, splitZ = size.z >= minSplitSize;
+
+			const auto octant = [&](uint32_t t)
+			{
+				const blender::Float3& c = centroids[t];
+				return (splitX && c.x > center.x ? 1 : 0) | (splitY && c.y > center.y ? 2 : 0) | (splitZ && c.z > center.z ? 4 : 0);
+			};
+
+			// counting sort of the node's range by octant
+			std::array<size_t, 9> start{};
+			for(size_t t=node.begin; t<node.end; ++t)
+				start[octant(tris[t]) + 1]++;
+			std::partial_sum(start.begin(), start.end(), start.begin());
+
+			std::vector<uint32_t> sorted(node.end - node.begin);
+			std::array<size_t, 8> cursor;
+			std::copy(start.begin(), start.begin() + 8, cursor.begin());
+			for(size_t t=node.begin; t<node.end; ++t)
+				sorted[cursor[octant(tris[t])]++] = tris[t];
+			std::copy(sorted.begin(), sorted.end(), tris.begin() + node.begin);
+
+			for(size_t o=0; o<8; ++o)
+			{
+				const size_t begin = node.begin + start[o];
+				const size_t end = node.begin + start[o + 1];
+				children[o] = Node{ begin, end, (end > begin ? Bounds(centroids, tris, begin, end) : node.bounds), node.depth + 1 };
+			}
+		}
+
+		static void CompactChunk(const Node& leaf, const std::vector<blender::Float3>& positions, const std::vector<uint32_t>& indices, const std::vector<uint32_t>& tris, MeshChunk& chunk)
+		{
+			chunk.sourceVertex.reserve((leaf.end - leaf.begin) * 3);
+			for(size_t t=leaf.begin; t<leaf.end; ++t)
+				for(size_t k=0; k<3; ++k)
+					chunk.sourceVertex.emplace_back(indices[tris[t] * 3 + k]);
+
+			std::sort(chunk.sourceVertex.begin(), chunk.sourceVertex.end());
+			chunk.sourceVertex.erase(std::unique(chunk.sourceVertex.begin(), chunk.sourceVertex.end()), chunk.sourceVertex.end());
+
+			const float inf = std::numeric_limits<float>::infinity();
+			chunk.boundsMin = blender::Float3{ inf, inf, inf };
+			chunk.boundsMax = blender::Float3{ -inf, -inf, -inf };
+
+			chunk.positions.resize(chunk.sourceVertex.size());
+			for(size_t v=0; v<chunk.sourceVertex.size(); ++v)
+			{
+				const blender::Float3& p = positions[chunk.sourceVertex[v]];
+				chunk.positions[v] = p;
+				chunk.boundsMin = blender::Float3{ std::min(chunk.boundsMin.x, p.x), std::min(chunk.boundsMin.y, p.y), std::min(chunk.boundsMin.z, p.z) };
+				chunk.boundsMax = blender::Float3{ std::max(chunk.boundsMax.x, p.x), std::max(chunk.boundsMax.y, p.y), std::max(chunk.boundsMax.z, p.z) };
+			}
+
+			auto& lod0 = chunk.lods.emplace_back();
+			lod0.reserve((leaf.end - leaf.begin) * 3);
+			for(size_t t=leaf.begin; t<leaf.end; ++t)
+			{
+				for(size_t k=0; k<3; ++k)
+				{
+					const auto it = std::lower_bound(chunk.sourceVertex.begin(), chunk.sourceVertex.end(), indices[tris[t] * 3 + k]);
+					lod0.emplace_back(uint32_t(it - chunk.sourceVertex.begin()));
 				}
-				else if(IdentifyStruct(block.desc.sdnaIndex, "BezTriple"))
+			}
+		}
+
+		/*
+		* Vertex clustering. LOD 1 uses sqrt(vertex count) / 2 cells along the longest axis (about a quarter of the
+		* vertices of a surface), every further level halves it. Locked vertices always map to themselves.
+		*/
+		template<typename F>
+		void BuildLods(MeshChunk& chunk, F&& isLocked) const
+		{
+			const float extent = std::max({ chunk.boundsMax.x - chunk.boundsMin.x, chunk.boundsMax.y - chunk.boundsMin.y, chunk.boundsMax.z - chunk.boundsMin.z, 1e-6f });
+			float cells = std::sqrt(float(chunk.positions.size()));
+
+			for(size_t lod=1; lod<=m_options.numLods; ++lod)
+			{
+				cells = std::max(cells * 0.5f, 1.0f);
+				const float cellsPerUnit = cells / extent;
+
+				std::vector<std::pair<uint64_t, uint32_t>> cellOfVertex(chunk.positions.size());
+				for(uint32_t v=0; v<chunk.positions.size(); ++v)
 				{
-					const size_t bezTripleSize = GetStructSizeByName("BezTriple");
-					MemorySpan bezTripleArraySpan = block.data;
+					const blender::Float3& p = chunk.positions[v];
+					const uint64_t cx = uint64_t((p.x - chunk.boundsMin.x) * cellsPerUnit);
+					const uint64_t cy = uint64_t((p.y - chunk.boundsMin.y) * cellsPerUnit);
+					const uint64_t cz = uint64_t((p.z - chunk.boundsMin.z) * cellsPerUnit);
+					const uint64_t cell = isLocked(v) ? (uint64_t(1) << 63) | v : (cx << 42) | (cy << 21) | cz;
+					cellOfVertex[v] = { cell, v };
+				}
 
-					for(size_t i=0; i<2; ++i)
-					{
-						const float* vecPtr = PeekTypePtr<float>(bezTripleArraySpan, GetFieldOffset("BezTriple", "vec[3][3]"));
-					
-						std::cout << "Keyframe: " << std::nearbyint(vecPtr[3]) << "  [";
-						for(size_t i=0; i<9; ++i)
-							std::cout << vecPtr[i] << (i == 8 ? "]\n" : ",");
+				std::sort(cellOfVertex.begin(), cellOfVertex.end());
 
-						beztriples++;
-						bezTripleArraySpan.Advance(bezTripleSize);
-					}
+				std::vector<uint32_t> representative(chunk.positions.size());
+				for(size_t i=0; i<cellOfVertex.size(); )
+				{
+					size_t j = i;
+					while(j < cellOfVertex.size() && cellOfVertex[j].first == cellOfVertex[i].first)
+						representative[cellOfVertex[j++].second] = cellOfVertex[i].second;
+					i = j;
+				}
+
+				const std::vector<uint32_t>& fine = chunk.lods.front();
+				std::vector<uint32_t> coarse;
+				coarse.reserve(fine.size());
+				for(size_t t=0; t<fine.size(); t+=3)
+				{
+					const uint32_t a = representative[fine[t]], b = representative[fine[t + 1]], c = representative[fine[t + 2]];
+					if(a != b && b != c && a != c)
+						coarse.insert(coarse.end(), { a, b, c });
 				}
+
+				chunk.lods.emplace_back(std::move(coarse));
 			}
+		}
 
-			std::cout << "FCurves: " << fcurves << '\n';
-			std::cout << "bActionGroups: " << actiongrps << '\n';
-			std::cout << "BezTriple: " << beztriples << '\n';
+		ChunkingOptions m_options;
+};
+
+struct HullOptions
+{
+	uint32_t maxVertices{ 64 };	// the hull stops growing here, the farthest points are added first so it's the best fit of the budget
+};
+
+struct ConvexHull
+{
+	std::vector<blender::Float3> vertices;
+	std::vector<uint32_t> indices; // triangles, counter-clockwise seen from outside
+};
+
+/*
+* 3D quickhull. The initial simplex and the partitioning of the points to its faces run in parallel, the expansion
+* (farthest outside point first, visible faces found by a walk over face adjacency, fan from the horizon) is serial:
+* many hulls are built concurrently instead. Returns an empty hull for less than 4 points or flat input.
+*/
+class convexHullBuilder
+{
+	public:
+		explicit convexHullBuilder(const HullOptions& options = {}) : m_options(options)
+		{
+			m_options.maxVertices = std::clamp<uint32_t>(m_options.maxVertices, 4, std::numeric_limits<uint16_t>::max());
+		}
+
+		ConvexHull Build(const std::vector<blender::Float3>& points) const
+		{
+			if(points.size() < 4)
+				return {};
+
+			std::vector<uint32_t> ids(points.size());
+			std::iota(ids.begin(), ids.end(), 0);
+
+			// extreme points per axis and the scale of the input for the plane tolerance
+			const Extremes extremes = std::transform_reduce(std::execution::par_unseq, ids.begin(), ids.end(), Extremes{},
+				[this, &points](const Extremes& a, const Extremes& b) { return Merge(points, a, b); },
+				[](uint32_t i) { return Extremes{ { i, i, i }, { i, i, i } }; });
+
+			double scale = 0.0;
+			for(int axis=0; axis<3; ++axis)
+				scale += std::max(std::abs(Get(points[extremes.min[axis]], axis)), std::abs(Get(points[extremes.max[axis]], axis)));
+
+			const double eps = 3.0 * std::numeric_limits<float>::epsilon() * scale;
+
+			// initial simplex: most distant pair of extremes, then farthest from their line, then from their plane
+			uint32_t v0 = extremes.min[0], v1 = extremes.max[0];
+			double best = -1.0;
+			for(int a=0; a<3; ++a)
+			{
+				const double d = Length2(Sub(ToVec(points[extremes.max[a]]), ToVec(points[extremes.min[a]])));
+				if(d > best)
+				{
+					best = d;
+					v0 = extremes.min[a];
+					v1 = extremes.max[a];
+				}
+			}
+
+			if(best <= eps * eps)
+				return {};
+
+			const Vec p0 = ToVec(points[v0]), p1 = ToVec(points[v1]);
+			const Vec lineDir = Sub(p1, p0);
+			const uint32_t v2 = ArgMax(ids, [&](uint32_t i) { return Length2(Cross(lineDir, Sub(ToVec(points[i]), p0))); });
+			if(Length2(Cross(lineDir, Sub(ToVec(points[v2]), p0))) <= eps * eps * Length2(lineDir))
+				return {};
+
+			const Vec baseNormal = Cross(lineDir, Sub(ToVec(points[v2]), p0));
+			const uint32_t v3 = ArgMax(ids, [&](uint32_t i) { return std::abs(Dot(baseNormal, Sub(ToVec(points[i]), p0))); });
+			const double v3Side = Dot(baseNormal, Sub(ToVec(points[v3]), p0));
+			if(std::abs(v3Side) <= eps * std::sqrt(Length2(baseNormal)))
+				return {};
+
+			State state(points, eps);
+			if(v3Side < 0.0)
+			{
+				state.AddFace(v0, v1, v2);
+				state.AddFace(v0, v3, v1);
+				state.AddFace(v1, v3, v2);
+				state.AddFace(v2, v3, v0);
+			}
+			else
+			{
+				state.AddFace(v0, v2, v1);
+				state.AddFace(v0, v1, v3);
+				state.AddFace(v1, v2, v3);
+				state.AddFace(v2, v0, v3);
+			}
+
+			// partition the rest of the points to the faces they are outside of, in parallel
+			std::vector<uint32_t> owner(points.size(), NoFace);
+			std::for_each(std::execution::par_unseq, ids.begin(), ids.end(), [&](uint32_t i)
+			{
+				if(i != v0 && i != v1 && i != v2 && i != v3)
+					owner[i] = state.FarthestFace(i, 0, 4);
+			});
+
+			for(uint32_t i=0; i<points.size(); ++i)
+			{
+				if(owner[i] != NoFace)
+					state.AssignOutside(owner[i], i);
+			}
+
+			while(state.numHullVerts < m_options.maxVertices && state.Expand());
+
+			return state.Compact();
+		}
+
+	private:
+		static constexpr uint32_t NoFace = std::numeric_limits<uint32_t>::max();
+
+		struct Vec
+		{
+			double x, y, z;
+		};
+
+		static Vec ToVec(const blender::Float3& p) { return Vec{ p.x, p.y, p.z }; }
+		static Vec Sub(const Vec& a, const Vec& b) { return Vec{ a.x - b.x, a.y - b.y, a.z - b.z }; }
+		static Vec Cross(const Vec& a, const Vec& b) { return Vec{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+		static double Dot(const Vec& a, const Vec& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+		static double Length2(const Vec& a) { return Dot(a, a); }
+		static double Get(const blender::Float3& p, int axis) { return (axis == 0 ? p.x : (axis == 1 ? p.y : p.z)); }
+
+		struct Extremes
+		{
+			uint32_t min[3];
+			uint32_t max[3];
+		};
+
+		Extremes Merge(const std::vector<blender::Float3>& points, const Extremes& a, const Extremes& b) const
+		{
+			Extremes r;
+			for(int axis=0; axis<3; ++axis)
+			{
+				r.min[axis] = (Get(points[b.min[axis]], axis) < Get(points[a.min[axis]], axis) ? b.min[axis] : a.min[axis]);
+				r.max[axis] = (Get(points[b.max[axis]], axis) > Get(points[a.max[axis]], axis) ? b.max[axis] : a.max[axis]);
+			}
+
+			return r;
+		}
+
+		template<typename F>
+		static uint32_t ArgMax(const std::vector<uint32_t>& ids, F&& value)
+		{
+			using Candidate = std::pair<double, uint32_t>;
+			return std::transform_reduce(std::execution::par_unseq, ids.begin(), ids.end(), Candidate{ -1.0, 0 },
+				[](const Candidate& a, const Candidate& b) { return (b.first > a.first || (b.first == a.first && b.second < a.second)) ? b : a; },
+				[&value](uint32_t i) { return Candidate{ value(i), i }; }).second;
+		}
+
+		struct Face
+		{
+			uint32_t v[3];
+			Vec normal;		// unit length
+			double offset;	// plane: dot(normal, p) == offset
+			std::vector<uint32_t> outside;
+			uint32_t farthest;
+			double farthestDistance;
+			bool alive;
+		};
+
+		struct State
+		{
+			State(const std::vector<blender::Float3>& inPoints, double inEps) : points(inPoints), eps(inEps), vertexFaces(inPoints.size(), 0)
+			{
+			}
+
+			static uint64_t EdgeKey(uint32_t a, uint32_t b) { return (uint64_t(a) << 32) | b; }
+
+			double Distance(const Face& face, uint32_t i) const
+			{
+				return Dot(face.normal, ToVec(points[i])) - face.offset;
+			}
+
+			uint32_t AddFace(uint32_t a, uint32_t b, uint32_t c)
+			{
+				const Vec pa = ToVec(points[a]);
+				Vec normal = Cross(Sub(ToVec(points[b]), pa), Sub(ToVec(points[c]), pa));
+				const double length = std::sqrt(Length2(normal));
+				if(length > 0.0)
+					normal = Vec{ normal.x / length, normal.y / length, normal.z / length };
+
+				const uint32_t f = uint32_t(faces.size());
+				faces.emplace_back(Face{ { a, b, c }, normal, Dot(normal, pa), {}, 0, 0.0, true });
+
+				for(int e=0; e<3; ++e)
+				{
+					edgeFace[EdgeKey(faces[f].v[e], faces[f].v[(e + 1) % 3])] = f;
+					if(vertexFaces[faces[f].v[e]]++ == 0)
+						numHullVerts++;
+				}
+
+				return f;
+			}
+
+			void RemoveFace(uint32_t f)
+			{
+				Face& face = faces[f];
+				face.alive = false;
+				for(int e=0; e<3; ++e)
+				{
+					const auto it = edgeFace.find(EdgeKey(face.v[e], face.v[(e + 1) % 3]));
+					if(it != edgeFace.end() && it->second == f)
+						edgeFace.erase(it);
+
+					if(--vertexFaces[face.v[e]] == 0)
+						numHullVerts--;
+				}
+			}
+
+			// NoFace if the point is on or inside all faces [first, last)
+			uint32_t FarthestFace(uint32_t i, size_t first, size_t last) const
+			{
+				uint32_t best = NoFace;
+				double bestDistance = eps;
+				for(size_t f=first; f<last; ++f)
+				{
+					const double d = Distance(faces[f], i);
+					if(d > bestDistance)
+					{
+						bestDistance = d;
+						best = uint32_t(f);
+					}
+				}
+
+				return best;
+			}
+
+			void AssignOutside(uint32_t f, uint32_t i)
+			{
+				Face& face = faces[f];
+				const double d = Distance(face, i);
+				if(face.outside.empty() || d > face.farthestDistance)
+				{
+					face.farthest = i;
+					face.farthestDistance = d;
+				}
+
+				face.outside.emplace_back(i);
+			}
+
+			// Adds the farthest outside point of all faces, false when every point is inside.
+			bool Expand()
+			{
+				uint32_t seed = NoFace;
+				for(uint32_t f=0; f<faces.size(); ++f)
+				{
+					if(faces[f].alive && !faces[f].outside.empty() && (seed == NoFace || faces[f].farthestDistance > faces[seed].farthestDistance))
+						seed = f;
+				}
+
+				if(seed == NoFace)
+					return false;
+
+				const uint32_t apex = faces[seed].farthest;
+
+				// visible faces connected to the seed, horizon: edges from a visible face to a hidden one
+				std::vector<uint32_t> visible{ seed };
+				std::vector<std::pair<uint32_t, uint32_t>> horizon;
+				std::unordered_set<uint32_t> visited{ seed };
+				for(size_t n=0; n<visible.size(); ++n)
+				{
+					const Face& face = faces[visible[n]];
+					for(int e=0; e<3; ++e)
+					{
+						const uint32_t a = face.v[e], b = face.v[(e + 1) % 3];
+						const auto neighbour = edgeFace.find(EdgeKey(b, a));
+						if(neighbour == edgeFace.end())
+							continue;
+
+						const uint32_t nf = neighbour->second;
+						if(visited.contains(nf))
+						{
+							if(std::find(visible.begin(), visible.end(), nf) == visible.end())
+								horizon.emplace_back(a, b);
+							continue;
+						}
+
+						visited.insert(nf);
+						if(Distance(faces[nf], apex) > eps)
+							visible.emplace_back(nf);
+						else
+							horizon.emplace_back(a, b);
+					}
+				}
+
+				std::vector<uint32_t> orphans;
+				for(const uint32_t f: visible)
+				{
+					orphans.insert(orphans.end(), faces[f].outside.begin(), faces[f].outside.end());
+					faces[f].outside.clear();
+					faces[f].outside.shrink_to_fit();
+					RemoveFace(f);
+				}
+
+				const size_t firstNew = faces.size();
+				for(const auto& [a, b]: horizon)
+					AddFace(a, b, apex);
+
+				for(const uint32_t i: orphans)
+				{
+					if(i == apex)
+						continue;
+
+					const uint32_t f = FarthestFace(i, firstNew, faces.size());
+					if(f != NoFace)
+						AssignOutside(f, i);
+				}
+
+				return true;
+			}
+
+			ConvexHull Compact() const
+			{
+				ConvexHull hull;
+				std::vector<uint32_t> remap(points.size(), NoFace);
+				for(const Face& face: faces)
+				{
+					if(!face.alive)
+						continue;
+
+					for(const uint32_t v: face.v)
+					{
+						if(remap[v] == NoFace)
+						{
+							remap[v] = uint32_t(hull.vertices.size());
+							hull.vertices.emplace_back(points[v]);
+						}
+
+						hull.indices.emplace_back(remap[v]);
+					}
+				}
+
+				return hull;
+			}
+
+			const std::vector<blender::Float3>& points;
+			const double eps;
+			std::vector<Face> faces;
+			std::unordered_map<uint64_t, uint32_t> edgeFace;	// directed edge -> face
+			std::vector<uint32_t> vertexFaces;					// faces using the vertex
+			uint32_t numHullVerts{ 0 };
+		};
+
+		HullOptions m_options;
+};
+
+struct LightmapOptions
+{
+	uint32_t resolution{ 512 };		// texels along a side of the square atlas
+	uint32_t paddingTexels{ 2 };	// empty texels around every chart
+	float maxChartAngle{ 66.0f };	// degrees between a triangle and the average normal of its chart
+	float maxEdgeAngle{ 60.0f };	// degrees between neighbouring triangles of a chart
+};
+
+struct LightmapUvs
+{
+	std::vector<blender::Float2> uvs;	// per triangle corner, in [0, 1]
+	uint32_t numCharts{ 0 };
+	float texelsPerUnit{ 0.0f };
+};
+
+/*
+* Lightmap UVs for a triangle list. Charts are grown over shared edges from the largest triangles while the normals
+* stay within the angle limits. Every chart is projected on the plane of its average normal and turned to its smallest
+* bounding rectangle (in parallel), then the charts are packed by a skyline packer: several scales are packed
+* concurrently and the largest one which fits the atlas wins.
+*/
+class lightmapUvGenerator
+{
+	public:
+		explicit lightmapUvGenerator(const LightmapOptions& options = {}) : m_options(options)
+		{
+			m_options.resolution = std::max<uint32_t>(m_options.resolution, 2 * m_options.paddingTexels + 1);
+		}
+
+		LightmapUvs Generate(const std::vector<blender::Float3>& positions, const std::vector<uint32_t>& indices) const
+		{
+			LightmapUvs result;
+			const size_t numTris = indices.size() / 3;
+			if(numTris == 0)
+				return result;
+
+			std::vector<uint32_t> tris(numTris);
+			std::iota(tris.begin(), tris.end(), 0);
+
+			std::vector<Vec> normals(numTris); // area weighted
+			std::transform(std::execution::par_unseq, tris.begin(), tris.end(), normals.begin(), [&](uint32_t t)
+			{
+				const Vec a = ToVec(positions[indices[t * 3]]);
+				return Cross(Sub(ToVec(positions[indices[t * 3 + 1]]), a), Sub(ToVec(positions[indices[t * 3 + 2]]), a));
+			});
+
+			// the largest triangles seed the charts
+			std::vector<uint32_t> seeds = tris;
+			std::sort(std::execution::par, seeds.begin(), seeds.end(), [&](uint32_t a, uint32_t b)
+			{
+				const double areaA = Length2(normals[a]), areaB = Length2(normals[b]);
+				return areaA > areaB || (areaA == areaB && a < b);
+			});
+
+			std::vector<uint32_t> chartOf;
+			std::vector<Chart> charts = Segment(indices, normals, seeds, chartOf);
+
+			std::vector<blender::Float2> local(indices.size());
+			std::for_each(std::execution::par, charts.begin(), charts.end(), [&](Chart& chart)
+			{
+				Parameterize(positions, indices, chart, local);
+			});
+
+			const Packing packing = Pack(charts);
+
+			result.uvs.resize(indices.size());
+			result.numCharts = uint32_t(charts.size());
+			result.texelsPerUnit = float(packing.texelsPerUnit);
+
+			// only the fallback packing is larger than the atlas, it's scaled down to fit
+			const double toUv = 1.0 / std::max<double>(packing.extent, m_options.resolution);
+			const double pad = m_options.paddingTexels;
+			std::for_each(std::execution::par_unseq, tris.begin(), tris.end(), [&](uint32_t t)
+			{
+				const Chart& chart = charts[chartOf[t]];
+				const Placement& place = packing.placements[chartOf[t]];
+				for(size_t c=t * 3; c<t * 3 + 3; ++c)
+				{
+					double x = local[c].x * packing.texelsPerUnit, y = local[c].y * packing.texelsPerUnit;
+					if(place.rotated)
+					{
+						const double turned = chart.height * packing.texelsPerUnit - y;
+						y = x;
+						x = turned;
+					}
+
+					result.uvs[c] = blender::Float2{ float((place.x + pad + x) * toUv), float((place.y + pad + y) * toUv) };
+				}
+			});
+
+			return result;
+		}
+
+	private:
+		static constexpr uint32_t NoChart = std::numeric_limits<uint32_t>::max();
+
+		struct Vec
+		{
+			double x, y, z;
+		};
+
+		static Vec ToVec(const blender::Float3& p) { return Vec{ p.x, p.y, p.z }; }
+		static Vec Add(const Vec& a, const Vec& b) { return Vec{ a.x + b.x, a.y + b.y, a.z + b.z }; }
+		static Vec Sub(const Vec& a, const Vec& b) { return Vec{ a.x - b.x, a.y - b.y, a.z - b.z }; }
+		static Vec Cross(const Vec& a, const Vec& b) { return Vec{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+		static double Dot(const Vec& a, const Vec& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+		static double Length2(const Vec& a) { return Dot(a, a); }
+
+		// zero for a zero vector
+		static Vec Normalize(const Vec& a)
+		{
+			const double length = std::sqrt(Length2(a));
+			return (length > 0.0 ? Vec{ a.x / length, a.y / length, a.z / length } : Vec{ 0.0, 0.0, 0.0 });
+		}
+
+		struct Chart
+		{
+			std::vector<uint32_t> triangles;
+			Vec normal;		// area weighted sum
+			double width;	// extents of the projection, world units
+			double height;
+		};
+
+		struct Placement
+		{
+			uint32_t x, y;	// texels, lower left corner of the padded rectangle
+			bool rotated;	// turned by 90 degrees
+		};
+
+		struct Packing
+		{
+			double texelsPerUnit{ 0.0 };
+			uint64_t extent{ std::numeric_limits<uint64_t>::max() }; // the larger of the used width and height, in texels
+			std::vector<Placement> placements;
+		};
+
+		std::vector<Chart> Segment(const std::vector<uint32_t>& indices, const std::vector<Vec>& normals, const std::vector<uint32_t>& seeds, std::vector<uint32_t>& chartOf) const
+		{
+			const auto EdgeKey = [](uint32_t a, uint32_t b) { return (uint64_t(a) << 32) | b; };
+
+			std::unordered_map<uint64_t, uint32_t> edgeTri; // directed edge -> triangle
+			edgeTri.reserve(indices.size());
+			for(uint32_t t=0; t<normals.size(); ++t)
+			{
+				for(int e=0; e<3; ++e)
+					edgeTri.emplace(EdgeKey(indices[t * 3 + e], indices[t * 3 + (e + 1) % 3]), t);
+			}
+
+			constexpr double DegToRad = 3.14159265358979323846 / 180.0;
+			const double cosChart = std::cos(m_options.maxChartAngle * DegToRad);
+			const double cosEdge = std::cos(m_options.maxEdgeAngle * DegToRad);
+
+			std::vector<Chart> charts;
+			chartOf.assign(normals.size(), NoChart);
+			for(const uint32_t seed: seeds)
+			{
+				if(chartOf[seed] != NoChart)
+					continue;
+
+				const uint32_t chartId = uint32_t(charts.size());
+				Chart& chart = charts.emplace_back(Chart{ { seed }, normals[seed], 0.0, 0.0 });
+				chartOf[seed] = chartId;
+
+				for(size_t n=0; n<chart.triangles.size(); ++n)
+				{
+					const uint32_t t = chart.triangles[n];
+					const Vec triNormal = Normalize(normals[t]);
+					for(int e=0; e<3; ++e)
+					{
+						// the neighbour across the edge runs it the other way
+						const auto it = edgeTri.find(EdgeKey(indices[t * 3 + (e + 1) % 3], indices[t * 3 + e]));
+						if(it == edgeTri.end() || chartOf[it->second] != NoChart)
+							continue;
+
+						// degenerate triangles join any chart, they don't turn its normal
+						const Vec neighbourNormal = Normalize(normals[it->second]);
+						if(Length2(neighbourNormal) > 0.0)
+						{
+							if(Length2(triNormal) > 0.0 && Dot(neighbourNormal, triNormal) < cosEdge)
+								continue;
+
+							if(Dot(neighbourNormal, Normalize(chart.normal)) < cosChart)
+								continue;
+						}
+
+						chartOf[it->second] = chartId;
+						chart.triangles.emplace_back(it->second);
+						chart.normal = Add(chart.normal, normals[it->second]);
+					}
+				}
+			}
+
+			return charts;
+		}
+
+		// Writes the chart's corners (world units, lower left at 0) to 'local' and sets its extents.
+		static void Parameterize(const std::vector<blender::Float3>& positions, const std::vector<uint32_t>& indices, Chart& chart, std::vector<blender::Float2>& local)
+		{
+			Vec axis = Normalize(chart.normal);
+			if(Length2(axis) == 0.0)
+				axis = Vec{ 0.0, 0.0, 1.0 };
+
+			const Vec u = Normalize(Cross(std::abs(axis.z) < 0.9 ? Vec{ 0.0, 0.0, 1.0 } : Vec{ 1.0, 0.0, 0.0 }, axis));
+			const Vec v = Cross(axis, u);
+
+			// relative to a corner of the chart, float precision is kept for charts far from the origin
+			const Vec origin = ToVec(positions[indices[chart.triangles.front() * 3]]);
+			std::vector<std::pair<double, double>> hull;
+			hull.reserve(chart.triangles.size() * 3);
+			for(const uint32_t t: chart.triangles)
+			{
+				for(size_t c=t * 3; c<t * 3 + 3; ++c)
+				{
+					const Vec p = Sub(ToVec(positions[indices[c]]), origin);
+					hull.emplace_back(Dot(p, u), Dot(p, v));
+				}
+			}
+
+			// the smallest bounding rectangle has a side on the 2D convex hull (monotone chain), the chart is turned to it
+			std::sort(hull.begin(), hull.end());
+			hull.erase(std::unique(hull.begin(), hull.end()), hull.end());
+
+			const auto Turn = [](const auto& o, const auto& a, const auto& b) { return (a.first - o.first) * (b.second - o.second) - (a.second - o.second) * (b.first - o.first); };
+			if(hull.size() > 2)
+			{
+				std::vector<std::pair<double, double>> chain(hull.size() * 2);
+				size_t k = 0;
+				for(size_t i=0; i<hull.size(); ++i)
+				{
+					while(k >= 2 && Turn(chain[k - 2], chain[k - 1], hull[i]) <= 0.0)
+						k--;
+					chain[k++] = hull[i];
+				}
+
+				for(size_t i=hull.size() - 1, lower=k + 1; i-- > 0;)
+				{
+					while(k >= lower && Turn(chain[k - 2], chain[k - 1], hull[i]) <= 0.0)
+						k--;
+					chain[k++] = hull[i];
+				}
+
+				chain.resize(k - 1);
+				hull = std::move(chain);
+			}
+
+			// every edge for usual charts, an even sample of them for huge outlines
+			constexpr size_t MaxEdgeTries = 256;
+			double cosA = 1.0, sinA = 0.0, bestArea = std::numeric_limits<double>::max();
+			const size_t step = std::max<size_t>(hull.size() / MaxEdgeTries, 1);
+			for(size_t e=0; e<hull.size(); e+=step)
+			{
+				const auto& a = hull[e];
+				const auto& b = hull[(e + 1) % hull.size()];
+				const double length = std::hypot(b.first - a.first, b.second - a.second);
+				if(length <= 0.0)
+					continue;
+
+				const double c = (b.first - a.first) / length, s = (b.second - a.second) / length;
+				double lo[2] = { std::numeric_limits<double>::max(), std::numeric_limits<double>::max() };
+				double hi[2] = { std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest() };
+				for(const auto& [x, y]: hull)
+				{
+					const double rx = x * c + y * s, ry = y * c - x * s;
+					lo[0] = std::min(lo[0], rx);
+					lo[1] = std::min(lo[1], ry);
+					hi[0] = std::max(hi[0], rx);
+					hi[1] = std::max(hi[1], ry);
+				}
+
+				const double area = (hi[0] - lo[0]) * (hi[1] - lo[1]);
+				if(area < bestArea)
+				{
+					bestArea = area;
+					cosA = c;
+					sinA = s;
+				}
+			}
+
+			double minX = std::numeric_limits<double>::max(), minY = minX;
+			double maxX = std::numeric_limits<double>::lowest(), maxY = maxX;
+			for(const uint32_t t: chart.triangles)
+			{
+				for(size_t c=t * 3; c<t * 3 + 3; ++c)
+				{
+					const Vec p = Sub(ToVec(positions[indices[c]]), origin);
+					const double x = Dot(p, u), y = Dot(p, v);
+					const double rx = x * cosA + y * sinA, ry = y * cosA - x * sinA;
+					local[c] = blender::Float2{ float(rx), float(ry) };
+					minX = std::min(minX, rx);
+					minY = std::min(minY, ry);
+					maxX = std::max(maxX, rx);
+					maxY = std::max(maxY, ry);
+				}
+			}
+
+			for(const uint32_t t: chart.triangles)
+			{
+				for(size_t c=t * 3; c<t * 3 + 3; ++c)
+					local[c] = blender::Float2{ float(local[c].x - minX), float(local[c].y - minY) };
+			}
+
+			chart.width = maxX - minX;
+			chart.height = maxY - minY;
+		}
+
+		Packing Pack(const std::vector<Chart>& charts) const
+		{
+			// biggest charts first, the same order for every scale
+			std::vector<uint32_t> order(charts.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+			{
+				const double sizeA = std::max(charts[a].width, charts[a].height), sizeB = std::max(charts[b].width, charts[b].height);
+				return sizeA > sizeB || (sizeA == sizeB && a < b);
+			});
+
+			// the start scale would fill the atlas without padding and packing loss, every try shrinks it a bit
+			double area = 0.0;
+			for(const Chart& chart: charts)
+				area += chart.width * chart.height;
+
+			const double fullScale = m_options.resolution * (area > 0.0 ? std::sqrt(1.0 / area) : 1.0);
+			constexpr int TriesPerRound = 8;
+			constexpr int Rounds = 4;
+			constexpr double Shrink = 0.93;
+
+			std::vector<int> tries(TriesPerRound);
+			std::vector<Packing> packings(TriesPerRound);
+			for(int round=0; round<Rounds; ++round)
+			{
+				std::iota(tries.begin(), tries.end(), round * TriesPerRound);
+				std::transform(std::execution::par, tries.begin(), tries.end(), packings.begin(), [&](int n)
+				{
+					return PackSkyline(charts, order, fullScale * std::pow(Shrink, n));
+				});
+
+				for(Packing& packing: packings)
+				{
+					if(packing.extent <= m_options.resolution)
+						return std::move(packing);
+				}
+			}
+
+			return std::move(packings.back());
+		}
+
+		Packing PackSkyline(const std::vector<Chart>& charts, const std::vector<uint32_t>& order, double texelsPerUnit) const
+		{
+			struct Segment
+			{
+				uint64_t x, y, width;
+			};
+
+			const uint64_t atlasWidth = m_options.resolution;
+			const uint64_t pad = 2 * uint64_t(m_options.paddingTexels);
+
+			Packing packing;
+			packing.texelsPerUnit = texelsPerUnit;
+			packing.placements.resize(charts.size());
+
+			std::vector<Segment> skyline{ Segment{ 0, 0, atlasWidth } };
+			std::vector<Segment> next;
+			uint64_t extent = 0;
+
+			// lowest top edge of a w x h rectangle resting on the skyline, then leftmost
+			const auto FindPosition = [&](uint64_t w, uint64_t h, uint64_t& bestX, uint64_t& bestY, uint64_t& bestTop)
+			{
+				bool found = false;
+				for(size_t i=0; i<skyline.size(); ++i)
+				{
+					const uint64_t x = skyline[i].x;
+					if(x + w > atlasWidth)
+						break;
+
+					uint64_t y = 0;
+					for(size_t j=i; j<skyline.size() && skyline[j].x < x + w; ++j)
+						y = std::max(y, skyline[j].y);
+
+					if(!found || y + h < bestTop || (y + h == bestTop && x < bestX))
+					{
+						found = true;
+						bestX = x;
+						bestY = y;
+						bestTop = y + h;
+					}
+				}
+
+				return found;
+			};
+
+			for(const uint32_t chartId: order)
+			{
+				const Chart& chart = charts[chartId];
+				const uint64_t w = std::max<uint64_t>(uint64_t(std::ceil(chart.width * texelsPerUnit)), 1) + pad;
+				const uint64_t h = std::max<uint64_t>(uint64_t(std::ceil(chart.height * texelsPerUnit)), 1) + pad;
+
+				uint64_t x = 0, y = 0, top = 0;
+				bool rotated = false;
+				bool found = FindPosition(w, h, x, y, top);
+
+				uint64_t rx = 0, ry = 0, rtop = 0;
+				if(w != h && FindPosition(h, w, rx, ry, rtop) && (!found || rtop < top))
+				{
+					found = true;
+					rotated = true;
+					x = rx;
+					y = ry;
+					top = rtop;
+				}
+
+				const uint64_t placedWidth = (rotated ? h : w);
+				if(!found)
+				{
+					// wider than the atlas: on top of everything, the packing doesn't fit
+					y = 0;
+					for(const Segment& segment: skyline)
+						y = std::max(y, segment.y);
+
+					top = y + h;
+					extent = std::max(extent, w);
+				}
+
+				packing.placements[chartId] = Placement{ uint32_t(x), uint32_t(y), rotated };
+				extent = std::max(extent, top);
+
+				if(!found)
+				{
+					skyline.assign(1, Segment{ 0, top, atlasWidth });
+					continue;
+				}
+
+				// the rectangle's top replaces the skyline under it
+				const Segment placed{ x, top, placedWidth };
+				const uint64_t end = x + placedWidth;
+				bool inserted = false;
+				next.clear();
+				for(const Segment& segment: skyline)
+				{
+					const uint64_t segmentEnd = segment.x + segment.width;
+					if(segmentEnd <= x || segment.x >= end)
+					{
+						if(!inserted && segment.x >= end)
+						{
+							next.emplace_back(placed);
+							inserted = true;
+						}
+
+						next.emplace_back(segment);
+						continue;
+					}
+
+					if(segment.x < x)
+						next.emplace_back(Segment{ segment.x, segment.y, x - segment.x });
+
+					if(!inserted)
+					{
+						next.emplace_back(placed);
+						inserted = true;
+					}
+
+					if(segmentEnd > end)
+						next.emplace_back(Segment{ end, segment.y, segmentEnd - end });
+				}
+
+				if(!inserted)
+					next.emplace_back(placed);
+
+				skyline.clear();
+				for(const Segment& segment: next)
+				{
+					if(segment.width == 0)
+						continue;
+
+					if(!skyline.empty() && skyline.back().y == segment.y && skyline.back().x + skyline.back().width == segment.x)
+						skyline.back().width += segment.width;
+					else
+						skyline.emplace_back(segment);
+				}
+			}
+
+			packing.extent = extent;
+			return packing;
+		}
+
+		LightmapOptions m_options;
+};
+
+struct BoundingBox
+{
+	blender::Float3 min{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+	blender::Float3 max{ std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+
+	bool IsEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+	blender::Float3 Center() const { return blender::Float3{ (min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f }; }
+
+	void Extend(const blender::Float3& p)
+	{
+		min = blender::Float3{ std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z) };
+		max = blender::Float3{ std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z) };
+	}
+
+	void Extend(const BoundingBox& b)
+	{
+		if(!b.IsEmpty())
+		{
+			Extend(b.min);
+			Extend(b.max);
+		}
+	}
+
+	bool Overlaps(const BoundingBox& b) const
+	{
+		return min.x <= b.max.x && b.min.x <= max.x &&
+			   min.y <= b.max.y && b.min.y <= max.y &&
+			   min.z <= b.max.z && b.min.z <= max.z;
+	}
+
+	// Blender matrix layout: mat[column][row], mat[3] is the translation.
+	BoundingBox Transformed(const float mat[4][4]) const
+	{
+		if(IsEmpty())
+			return *this;
+
+		const float lo[3] = { min.x, min.y, min.z };
+		const float hi[3] = { max.x, max.y, max.z };
+		float outMin[3] = { mat[3][0], mat[3][1], mat[3][2] };
+		float outMax[3] = { mat[3][0], mat[3][1], mat[3][2] };
+
+		for(size_t row=0; row<3; ++row)
+		{
+			for(size_t col=0; col<3; ++col)
+			{
+				const float a = mat[col][row] * lo[col];
+				const float b = mat[col][row] * hi[col];
+				outMin[row] += std::min(a, b);
+				outMax[row] += std::max(a, b);
+			}
+		}
+
+		return BoundingBox{ blender::Float3{ outMin[0], outMin[1], outMin[2] }, blender::Float3{ outMax[0], outMax[1], outMax[2] } };
+	}
+};
+
+/*
+* BVH over world space object bounds (binary, median split along the longest axis of the centroid bounds).
+* Items are whatever the caller indexes with, blendExpl uses the block index of the OB block.
+*/
+class objectBvh
+{
+	public:
+		struct Item
+		{
+			BoundingBox bounds;
+			size_t id;
+		};
+
+		void Build(std::vector<Item> items)
+		{
+			m_items = std::move(items);
+			m_nodes.clear();
+
+			if(!m_items.empty())
+			{
+				m_nodes.reserve(2 * m_items.size());
+				m_nodes.emplace_back();
+				BuildNode(0, 0, m_items.size(), 0);
+			}
+		}
+
+		template<typename F>
+		void Query(const BoundingBox& region, F&& onItem) const
+		{
+			if(m_nodes.empty())
+				return;
+
+			size_t stack[64];
+			size_t stackSize = 0;
+			stack[stackSize++] = 0;
+
+			while(stackSize > 0)
+			{
+				const Node& node = m_nodes[stack[--stackSize]];
+				if(!node.bounds.Overlaps(region))
+					continue;
+
+				if(node.count > 0)
+				{
+					for(size_t i=node.first; i<node.first + node.count; ++i)
+						if(m_items[i].bounds.Overlaps(region))
+							onItem(m_items[i].id);
+				}
+				else
+				{
+					stack[stackSize++] = node.first;		// left child
+					stack[stackSize++] = node.first + 1;	// right child
+				}
+			}
+		}
+
+		size_t NumItems() const { return m_items.size(); }
+		size_t NumNodes() const { return m_nodes.size(); }
+		const std::vector<Item>& Items() const { return m_items; } // in tree order
+
+	private:
+		static constexpr size_t MaxLeafItems = 4;
+
+		struct Node
+		{
+			BoundingBox bounds;
+			size_t first;	// first item of a leaf, left child of an inner node (right child is first + 1)
+			size_t count;	// 0 for inner nodes
+		};
+
+		void BuildNode(size_t nodeId, size_t begin, size_t end, size_t depth)
+		{
+			BoundingBox bounds, centroids;
+			for(size_t i=begin; i<end; ++i)
+			{
+				bounds.Extend(m_items[i].bounds);
+				centroids.Extend(m_items[i].bounds.Center());
+			}
+
+			m_nodes[nodeId].bounds = bounds;
+
+			// depth limit keeps the query stack bounded for degenerate input
+			if(end - begin <= MaxLeafItems || depth >= 30)
+			{
+				m_nodes[nodeId].first = begin;
+				m_nodes[nodeId].count = end - begin;
+				return;
+			}
+
+			const float ext[3] = { centroids.max.x - centroids.min.x, centroids.max.y - centroids.min.y, centroids.max.z - centroids.min.z };
+			const size_t axis = (ext[0] >= ext[1] && ext[0] >= ext[2]) ? 0 : (ext[1] >= ext[2] ? 1 : 2);
+			const auto centerOnAxis = [axis](const Item& item)
+			{
+				const blender::Float3 c = item.bounds.Center();
+				return axis == 0 ? c.x : (axis == 1 ? c.y : c.z);
+			};
+
+			const size_t mid = begin + (end - begin) / 2;
+			std::nth_element(m_items.begin() + begin, m_items.begin() + mid, m_items.begin() + end,
+				[&](const Item& a, const Item& b) { return centerOnAxis(a) < centerOnAxis(b); });
+
+			// children are allocated as a pair so the right one is always left + 1
+			const size_t leftId = m_nodes.size();
+			m_nodes.emplace_back();
+			m_nodes.emplace_back();
+			m_nodes[nodeId].first = leftId;
+			m_nodes[nodeId].count = 0;
+
+			BuildNode(leftId, begin, mid, depth + 1);
+			BuildNode(leftId + 1, mid, end, depth + 1);
+		}
+
+		std::vector<Item> m_items;
+		std::vector<Node> m_nodes;
+};
+
+/*
+* Skeletal and shape key animation: the skeleton of an armature, actions (FCurves of BezTriple keys) bound to its pose
+* channels, pose evaluation to armature space matrices, frame sampled clips, linear blend skinning.
+*/
+namespace anim
+{
+	using Quat = blender::Float4; // w, x, y, z like Blender
+
+	inline constexpr int16_t RotationQuaternion = 0;	// bPoseChannel.rotmode, 1..6: euler XYZ, XZY, YXZ, YZX, ZXY, ZYX
+	inline constexpr int16_t RotationAxisAngle = -1;
+	inline constexpr uint8_t InterpolationConstant = 0;	// BezTriple.ipo
+	inline constexpr uint8_t InterpolationLinear = 1;
+
+	inline Quat QuatMultiply(const Quat& a, const Quat& b)
+	{
+		return Quat{ a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+					 a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+					 a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+					 a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w };
+	}
+
+	inline Quat QuatConjugate(const Quat& q) { return Quat{ q.w, -q.x, -q.y, -q.z }; }
+
+	inline Quat QuatNormalize(const Quat& q)
+	{
+		const float length = std::sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+		return (length > 0.0f ? Quat{ q.w / length, q.x / length, q.y / length, q.z / length } : Quat{ 1.0f, 0.0f, 0.0f, 0.0f });
+	}
+
+	inline blender::Float3 QuatRotate(const Quat& q, const blender::Float3& v)
+	{
+		const Quat r = QuatMultiply(QuatMultiply(q, Quat{ 0.0f, v.x, v.y, v.z }), QuatConjugate(q));
+		return blender::Float3{ r.x, r.y, r.z };
+	}
+
+	inline Quat QuatFromAxisAngle(const blender::Float3& axis, float angle)
+	{
+		const float length = std::sqrt(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+		if(length == 0.0f)
+			return Quat{ 1.0f, 0.0f, 0.0f, 0.0f };
+
+		const float s = std::sin(angle * 0.5f) / length;
+		return Quat{ std::cos(angle * 0.5f), axis.x * s, axis.y * s, axis.z * s };
+	}
+
+	inline Quat QuatFromEuler(const float euler[3], int16_t rotationMode)
+	{
+		// axes in the order they are applied
+		static constexpr int Orders[6][3] = { { 0, 1, 2 }, { 0, 2, 1 }, { 1, 0, 2 }, { 1, 2, 0 }, { 2, 0, 1 }, { 2, 1, 0 } };
+		const int* order = Orders[std::clamp<int>(rotationMode, 1, 6) - 1];
+
+		Quat q{ 1.0f, 0.0f, 0.0f, 0.0f };
+		for(int i=0; i<3; ++i)
+		{
+			float axis[3] = { 0.0f, 0.0f, 0.0f };
+			axis[order[i]] = 1.0f;
+			q = QuatMultiply(QuatFromAxisAngle(blender::Float3{ axis[0], axis[1], axis[2] }, euler[order[i]]), q);
+		}
+
+		return q;
+	}
+
+	// Rotation of the 3x3 part, its columns normalized first (scale removed).
+	inline Quat QuatFromMatrix(const blender::Float4x4& mat)
+	{
+		float m[3][3];
+		for(int col=0; col<3; ++col)
+		{
+			const float length = std::sqrt(mat.m[col][0] * mat.m[col][0] + mat.m[col][1] * mat.m[col][1] + mat.m[col][2] * mat.m[col][2]);
+			for(int row=0; row<3; ++row)
+				m[col][row] = (length > 0.0f ? mat.m[col][row] / length : 0.0f);
+		}
+
+		Quat q;
+		const float trace = m[0][0] + m[1][1] + m[2][2];
+		if(trace > 0.0f)
+		{
+			const float s = 2.0f * std::sqrt(trace + 1.0f);
+			q = Quat{ 0.25f * s, (m[1][2] - m[2][1]) / s, (m[2][0] - m[0][2]) / s, (m[0][1] - m[1][0]) / s };
+		}
+		else if(m[0][0] > m[1][1] && m[0][0] > m[2][2])
+		{
+			const float s = 2.0f * std::sqrt(1.0f + m[0][0] - m[1][1] - m[2][2]);
+			q = Quat{ (m[1][2] - m[2][1]) / s, 0.25f * s, (m[1][0] + m[0][1]) / s, (m[2][0] + m[0][2]) / s };
+		}
+		else if(m[1][1] > m[2][2])
+		{
+			const float s = 2.0f * std::sqrt(1.0f + m[1][1] - m[0][0] - m[2][2]);
+			q = Quat{ (m[2][0] - m[0][2]) / s, (m[1][0] + m[0][1]) / s, 0.25f * s, (m[2][1] + m[1][2]) / s };
+		}
+		else
+		{
+			const float s = 2.0f * std::sqrt(1.0f + m[2][2] - m[0][0] - m[1][1]);
+			q = Quat{ (m[0][1] - m[1][0]) / s, (m[2][0] + m[0][2]) / s, (m[2][1] + m[1][2]) / s, 0.25f * s };
+		}
+
+		return QuatNormalize(q);
+	}
+
+#if defined(__AVX2__)
+	// 8 quaternions in SoA registers, for batches of frames.
+	struct Quat8
+	{
+		__m256 w, x, y, z;
+	};
+
+	inline Quat8 QuatBroadcast(const Quat& q)
+	{
+		return Quat8{ _mm256_set1_ps(q.w), _mm256_set1_ps(q.x), _mm256_set1_ps(q.y), _mm256_set1_ps(q.z) };
+	}
+
+	inline Quat8 QuatLoad(const float* w, const float* x, const float* y, const float* z)
+	{
+		return Quat8{ _mm256_loadu_ps(w), _mm256_loadu_ps(x), _mm256_loadu_ps(y), _mm256_loadu_ps(z) };
+	}
+
+	inline void QuatStore(const Quat8& q, float* w, float* x, float* y, float* z)
+	{
+		_mm256_storeu_ps(w, q.w);
+		_mm256_storeu_ps(x, q.x);
+		_mm256_storeu_ps(y, q.y);
+		_mm256_storeu_ps(z, q.z);
+	}
+
+	inline Quat8 QuatMultiply(const Quat8& a, const Quat8& b)
+	{
+		return Quat8{ _mm256_sub_ps(_mm256_sub_ps(_mm256_mul_ps(a.w, b.w), _mm256_mul_ps(a.x, b.x)), _mm256_add_ps(_mm256_mul_ps(a.y, b.y), _mm256_mul_ps(a.z, b.z))),
+					  _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a.w, b.x), _mm256_mul_ps(a.x, b.w)), _mm256_sub_ps(_mm256_mul_ps(a.y, b.z), _mm256_mul_ps(a.z, b.y))),
+					  _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(a.w, b.y), _mm256_mul_ps(a.x, b.z)), _mm256_add_ps(_mm256_mul_ps(a.y, b.w), _mm256_mul_ps(a.z, b.x))),
+					  _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(a.w, b.z), _mm256_mul_ps(a.y, b.x)), _mm256_add_ps(_mm256_mul_ps(a.x, b.y), _mm256_mul_ps(a.z, b.w))) };
+	}
+
+	inline Quat8 QuatConjugate(const Quat8& q)
+	{
+		const __m256 sign = _mm256_set1_ps(-0.0f);
+		return Quat8{ q.w, _mm256_xor_ps(q.x, sign), _mm256_xor_ps(q.y, sign), _mm256_xor_ps(q.z, sign) };
+	}
+#endif
+
+	struct BoneTransform
+	{
+		blender::Float3 location{ 0.0f, 0.0f, 0.0f };
+		Quat rotation{ 1.0f, 0.0f, 0.0f, 0.0f };
+		blender::Float3 scale{ 1.0f, 1.0f, 1.0f };
+	};
+
+	// translation * rotation * scale
+	inline blender::Float4x4 MatrixFromTransform(const BoneTransform& t)
+	{
+		const Quat& q = t.rotation;
+		const float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+		const float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+		const float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+		blender::Float4x4 m{};
+		m.m[0][0] = (1.0f - 2.0f * (yy + zz)) * t.scale.x;
+		m.m[0][1] = 2.0f * (xy + wz) * t.scale.x;
+		m.m[0][2] = 2.0f * (xz - wy) * t.scale.x;
+		m.m[1][0] = 2.0f * (xy - wz) * t.scale.y;
+		m.m[1][1] = (1.0f - 2.0f * (xx + zz)) * t.scale.y;
+		m.m[1][2] = 2.0f * (yz + wx) * t.scale.y;
+		m.m[2][0] = 2.0f * (xz + wy) * t.scale.z;
+		m.m[2][1] = 2.0f * (yz - wx) * t.scale.z;
+		m.m[2][2] = (1.0f - 2.0f * (xx + yy)) * t.scale.z;
+		m.m[3][0] = t.location.x;
+		m.m[3][1] = t.location.y;
+		m.m[3][2] = t.location.z;
+		m.m[3][3] = 1.0f;
+		return m;
+	}
+
+	// Pose channel values as the FCurves address them, the rotation in the channel's own mode.
+	struct ChannelValues
+	{
+		float location[3]{ 0.0f, 0.0f, 0.0f };
+		float quaternion[4]{ 1.0f, 0.0f, 0.0f, 0.0f };
+		float euler[3]{ 0.0f, 0.0f, 0.0f };
+		float axisAngle[4]{ 0.0f, 0.0f, 1.0f, 0.0f }; // angle, axis x, y, z (rotation_axis_angle)
+		float scale[3]{ 1.0f, 1.0f, 1.0f };
+		int16_t rotationMode{ RotationQuaternion };
+
+		BoneTransform Resolve() const
+		{
+			BoneTransform t;
+			t.location = blender::Float3{ location[0], location[1], location[2] };
+			t.scale = blender::Float3{ scale[0], scale[1], scale[2] };
+			if(rotationMode == RotationQuaternion)
+				t.rotation = QuatNormalize(Quat{ quaternion[0], quaternion[1], quaternion[2], quaternion[3] });
+			else if(rotationMode == RotationAxisAngle)
+				t.rotation = QuatFromAxisAngle(blender::Float3{ axisAngle[1], axisAngle[2], axisAngle[3] }, axisAngle[0]);
+			else
+				t.rotation = QuatFromEuler(euler, rotationMode);
+
+			return t;
+		}
+	};
+
+	// Shortest arc rotation taking direction 'from' to direction 'to', the identity for degenerate input.
+	inline Quat QuatBetween(const blender::Float3& from, const blender::Float3& to)
+	{
+		const float lengths = std::sqrt((from.x * from.x + from.y * from.y + from.z * from.z) * (to.x * to.x + to.y * to.y + to.z * to.z));
+		if(lengths <= 0.0f)
+			return Quat{ 1.0f, 0.0f, 0.0f, 0.0f };
+
+		const float d = from.x * to.x + from.y * to.y + from.z * to.z;
+		blender::Float3 axis{ from.y * to.z - from.z * to.y, from.z * to.x - from.x * to.z, from.x * to.y - from.y * to.x };
+		if(d <= -0.999999f * lengths)
+		{
+			// half turn about any axis perpendicular to 'from'
+			axis = (std::abs(from.x) < std::abs(from.z) ? blender::Float3{ 0.0f, -from.z, from.y } : blender::Float3{ -from.y, from.x, 0.0f });
+			return QuatNormalize(Quat{ 0.0f, axis.x, axis.y, axis.z });
+		}
+
+		return QuatNormalize(Quat{ lengths + d, axis.x, axis.y, axis.z });
+	}
+
+	inline Quat QuatSlerp(const Quat& a, Quat b, float t)
+	{
+		float d = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+		if(d < 0.0f)
+		{
+			b = Quat{ -b.w, -b.x, -b.y, -b.z };
+			d = -d;
+		}
+
+		float wa = 1.0f - t, wb = t;
+		if(d < 0.9995f)
+		{
+			const float angle = std::acos(d);
+			const float s = std::sin(angle);
+			wa = std::sin((1.0f - t) * angle) / s;
+			wb = std::sin(t * angle) / s;
+		}
+
+		return QuatNormalize(Quat{ wa * a.w + wb * b.w, wa * a.x + wb * b.x, wa * a.y + wb * b.y, wa * a.z + wb * b.z });
+	}
+
+	// Euler XYZ (X applied first) of a rotation.
+	inline void EulerFromQuat(const Quat& q, float euler[3])
+	{
+		BoneTransform t;
+		t.rotation = q;
+		const blender::Float4x4 m = MatrixFromTransform(t);
+		const float cy = std::sqrt(m.m[0][0] * m.m[0][0] + m.m[0][1] * m.m[0][1]);
+		euler[1] = std::atan2(-m.m[0][2], cy);
+		if(cy > 1e-6f)
+		{
+			euler[0] = std::atan2(m.m[1][2], m.m[2][2]);
+			euler[2] = std::atan2(m.m[0][1], m.m[0][0]);
+		}
+		else
+		{
+			euler[0] = std::atan2(-m.m[2][1], m.m[1][1]);
+			euler[2] = 0.0f;
+		}
+	}
+
+	inline blender::Float3 MatrixTranslation(const blender::Float4x4& m) { return blender::Float3{ m.m[3][0], m.m[3][1], m.m[3][2] }; }
+
+	inline BoneTransform DecomposeMatrix(const blender::Float4x4& m)
+	{
+		BoneTransform t;
+		t.location = MatrixTranslation(m);
+		t.rotation = QuatFromMatrix(m);
+		t.scale = blender::Float3{ std::sqrt(m.m[0][0] * m.m[0][0] + m.m[0][1] * m.m[0][1] + m.m[0][2] * m.m[0][2]),
+								   std::sqrt(m.m[1][0] * m.m[1][0] + m.m[1][1] * m.m[1][1] + m.m[1][2] * m.m[1][2]),
+								   std::sqrt(m.m[2][0] * m.m[2][0] + m.m[2][1] * m.m[2][1] + m.m[2][2] * m.m[2][2]) };
+		return t;
+	}
+
+	// Interpolates location, rotation and scale of two matrices.
+	inline blender::Float4x4 BlendMatrix(const blender::Float4x4& a, const blender::Float4x4& b, float t)
+	{
+		if(t >= 1.0f)
+			return b;
+
+		const BoneTransform ta = DecomposeMatrix(a), tb = DecomposeMatrix(b);
+		const auto Lerp = [t](const blender::Float3& u, const blender::Float3& v) { return blender::Float3{ u.x + (v.x - u.x) * t, u.y + (v.y - u.y) * t, u.z + (v.z - u.z) * t }; };
+		return MatrixFromTransform(BoneTransform{ Lerp(ta.location, tb.location), QuatSlerp(ta.rotation, tb.rotation, t), Lerp(ta.scale, tb.scale) });
+	}
+
+	// Rotates a matrix by 'q' about the point 'pivot' (both armature space).
+	inline blender::Float4x4 RotateAbout(const blender::Float4x4& m, const Quat& q, const blender::Float3& pivot)
+	{
+		BoneTransform t;
+		t.rotation = q;
+		const blender::Float3 moved = QuatRotate(q, pivot);
+		t.location = blender::Float3{ pivot.x - moved.x, pivot.y - moved.y, pivot.z - moved.z };
+		return blender::Multiply(MatrixFromTransform(t), m);
+	}
+
+	enum class ConstraintType: uint8_t
+	{
+		Ik,				// bKinematicConstraint
+		CopyRotation,	// bRotateLikeConstraint
+		DampedTrack,	// bDampTrackConstraint
+		ChildOf			// bChildOfConstraint
+	};
+
+	enum class RotationMix: uint8_t
+	{
+		Replace,
+		Offset,		// legacy, the Offset checkbox of files before mix_mode
+		Add,		// euler angles added
+		Before,		// target rotation before the owner's, as if the target was its parent
+		After		// after the owner's, as if it was a child
+	};
+
+	inline std::optional<RotationMix> RotationMixFromDna(int8_t mixMode)
+	{
+		switch(mixMode)
+		{
+			case blender::ROTLIKE_MIX_REPLACE: return RotationMix::Replace;
+			case blender::ROTLIKE_MIX_OFFSET: return RotationMix::Offset;
+			case blender::ROTLIKE_MIX_ADD: return RotationMix::Add;
+			case blender::ROTLIKE_MIX_BEFORE: return RotationMix::Before;
+			case blender::ROTLIKE_MIX_AFTER: return RotationMix::After;
+			default: return {};
+		}
+	}
+
+	// Bone constraint, evaluated in armature space.
+	struct Constraint
+	{
+		ConstraintType type;
+		float influence{ 1.0f };
+		int32_t target{ -1 };					// bone of the skeleton, -1: 'targetMatrix'
+		blender::Float4x4 targetMatrix{};		// armature space matrix of an object target (as saved, not animated)
+
+		// Ik
+		uint32_t chainLength{ 0 };				// 0: up to the root bone
+		uint32_t iterations{ 64 };				// FABRIK iterations for chains other than two bones
+		bool useTip{ true };					// the effector is the tail of the bone, otherwise its head
+		std::optional<int32_t> pole;			// bone, or -1 for 'poleMatrix'
+		blender::Float4x4 poleMatrix{};
+
+		// CopyRotation
+		uint8_t axes{ 7 };						// 1 x, 2 y, 4 z
+		uint8_t invert{ 0 };					// same bits
+		RotationMix mix{ RotationMix::Replace };
+
+		// DampedTrack: +X, +Y, +Z, -X, -Y, -Z
+		uint8_t trackAxis{ 1 };
+
+		// ChildOf
+		blender::Float4x4 inverse = blender::Identity();
+	};
+
+	struct Bone
+	{
+		std::string name;
+		int32_t parent{ -1 };				// parents come before their children
+		blender::Float4x4 rest{};			// armature space (Bone.arm_mat)
+		blender::Float4x4 restInverse{};
+		blender::Float4x4 restRelative{};	// to the parent's rest, the rest itself for roots
+		float length{ 0.0f };				// head to tail, along Y
+		ChannelValues channel;				// pose channel as saved, the value of unanimated channels
+		std::vector<Constraint> constraints;	// in stack order
+	};
+
+	/*
+	* Applies the constraints of a pose, bones in order and the constraints of a bone in stack order. A bone moved by a
+	* constraint carries its children along, their matrices relative to it are kept. Targets are read from the pose as it
+	* is when the constraint runs.
+	*	Ik: analytic two-bone solve for chains of two, FABRIK for other lengths. Rotations about the joints, the
+	*	effector is the owner's tail (its head without useTip). A pole target sets the bend plane of two-bone chains.
+	*	CopyRotation: armature space rotation of the target, partial axes through XYZ euler.
+	*	DampedTrack: shortest rotation pointing the track axis at the target.
+	*	ChildOf: target * inverse * pose.
+	*/
+	class constraintSolver
+	{
+		public:
+			// 'relative' is each bone's pose relative to its parent's pose
+			constraintSolver(const std::vector<Bone>& bones, blender::Float4x4* pose, std::vector<blender::Float4x4>&& relative)
+				: m_bones(bones)
+				, m_pose(pose)
+				, m_relative(std::move(relative))
+				, m_changed(bones.size(), 0)
+			{
+			}
+
+			void Apply()
+			{
+				for(size_t i=0; i<m_bones.size(); ++i)
+				{
+					for(const Constraint& c: m_bones[i].constraints)
+					{
+						switch(c.type)
+						{
+							case ConstraintType::Ik: SolveIk(i, c); break;
+							case ConstraintType::CopyRotation: CopyRotation(i, c); break;
+							case ConstraintType::DampedTrack: DampedTrack(i, c); break;
+							case ConstraintType::ChildOf: ChildOf(i, c); break;
+						}
+					}
+				}
+			}
+
+		private:
+			blender::Float3 Head(size_t bone) const { return MatrixTranslation(m_pose[bone]); }
+			blender::Float3 Tail(size_t bone) const { return blender::TransformPoint(m_pose[bone], blender::Float3{ 0.0f, m_bones[bone].length, 0.0f }); }
+			blender::Float4x4 TargetMatrix(const Constraint& c) const { return (c.target >= 0 ? m_pose[c.target] : c.targetMatrix); }
+			blender::Float3 TargetPoint(const Constraint& c) const { return MatrixTranslation(TargetMatrix(c)); }
+
+			static blender::Float3 Sub(const blender::Float3& a, const blender::Float3& b) { return blender::Float3{ a.x - b.x, a.y - b.y, a.z - b.z }; }
+			static float Dot(const blender::Float3& a, const blender::Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+			static float Length(const blender::Float3& a) { return std::sqrt(Dot(a, a)); }
+
+			// Sets the armature space pose of a bone and moves its descendants with it.
+			void SetPose(size_t bone, const blender::Float4x4& m)
+			{
+				m_pose[bone] = m;
+				const int32_t parent = m_bones[bone].parent;
+				blender::Float4x4 parentInverse;
+				if(parent < 0)
+					m_relative[bone] = m;
+				else if(blender::InvertAffine(parentInverse, m_pose[parent]))
+					m_relative[bone] = blender::Multiply(parentInverse, m);
+
+				std::fill(m_changed.begin(), m_changed.end(), 0);
+				m_changed[bone] = 1;
+				for(size_t i=bone + 1; i<m_bones.size(); ++i)
+				{
+					const int32_t p = m_bones[i].parent;
+					if(p >= 0 && m_changed[p])
+					{
+						m_pose[i] = blender::Multiply(m_pose[p], m_relative[i]);
+						m_changed[i] = 1;
+					}
+				}
+			}
+
+			void Rotate(size_t bone, const Quat& q, float influence)
+			{
+				SetPose(bone, RotateAbout(m_pose[bone], QuatSlerp(Quat{ 1.0f, 0.0f, 0.0f, 0.0f }, q, influence), Head(bone)));
+			}
+
+			void SolveIk(size_t owner, const Constraint& c)
+			{
+				std::vector<size_t> chain;
+				for(int32_t bone=(c.useTip ? int32_t(owner) : m_bones[owner].parent); bone >= 0 && (c.chainLength == 0 || chain.size() < c.chainLength); bone=m_bones[bone].parent)
+					chain.emplace_back(size_t(bone));
+
+				if(chain.empty())
+					return;
+
+				std::reverse(chain.begin(), chain.end());
+				const auto Effector = [&] { return (c.useTip ? Tail(owner) : Head(owner)); };
+				const blender::Float3 target = TargetPoint(c);
+
+				if(chain.size() != 2 || !SolveTwoBone(chain[0], chain[1], Effector, target, c))
+					SolveFabrik(chain, Effector, target, c);
+			}
+
+			template<typename E>
+			bool SolveTwoBone(size_t upper, size_t lower, const E& Effector, const blender::Float3& target, const Constraint& c)
+			{
+				const blender::Float3 a = Head(upper), b = Head(lower), e = Effector();
+				const float l1 = Length(Sub(b, a)), l2 = Length(Sub(e, b));
+				const blender::Float3 toTarget = Sub(target, a);
+				const float distance = Length(toTarget);
+				if(l1 <= 1e-6f || l2 <= 1e-6f || distance <= 1e-6f)
+					return false;
+
+				const blender::Float3 dir{ toTarget.x / distance, toTarget.y / distance, toTarget.z / distance };
+				const float reach = std::clamp(distance, std::abs(l1 - l2) + 1e-5f, l1 + l2 - 1e-5f);
+
+				// bend direction: towards the pole target, else where the middle joint is
+				blender::Float3 bend = Sub(c.pole.has_value() ? (c.pole.value() >= 0 ? Head(c.pole.value()) : MatrixTranslation(c.poleMatrix)) : b, a);
+				const float along = Dot(bend, dir);
+				bend = Sub(bend, blender::Float3{ dir.x * along, dir.y * along, dir.z * along });
+				if(Length(bend) <= 1e-6f)
+					bend = (std::abs(dir.x) < 0.9f ? blender::Float3{ 0.0f, dir.z, -dir.y } : blender::Float3{ -dir.z, 0.0f, dir.x });
+
+				const float bendLength = Length(bend);
+				bend = blender::Float3{ bend.x / bendLength, bend.y / bendLength, bend.z / bendLength };
+
+				const float cosAngle = std::clamp((l1 * l1 + reach * reach - l2 * l2) / (2.0f * l1 * reach), -1.0f, 1.0f);
+				const float sinAngle = std::sqrt(1.0f - cosAngle * cosAngle);
+				const blender::Float3 joint{ l1 * (cosAngle * dir.x + sinAngle * bend.x), l1 * (cosAngle * dir.y + sinAngle * bend.y), l1 * (cosAngle * dir.z + sinAngle * bend.z) };
+
+				Rotate(upper, QuatBetween(Sub(b, a), joint), c.influence);
+				const blender::Float3 middle = Head(lower);
+				Rotate(lower, QuatBetween(Sub(Effector(), middle), Sub(target, middle)), c.influence);
+				return true;
+			}
+
+			template<typename E>
+			void SolveFabrik(const std::vector<size_t>& chain, const E& Effector, const blender::Float3& target, const Constraint& c)
+			{
+				const size_t n = chain.size();
+				std::vector<blender::Float3> joints(n + 1);
+				for(size_t k=0; k<n; ++k)
+					joints[k] = Head(chain[k]);
+
+				joints[n] = Effector();
+
+				std::vector<float> lengths(n);
+				float total = 0.0f;
+				for(size_t k=0; k<n; ++k)
+					total += lengths[k] = Length(Sub(joints[k + 1], joints[k]));
+
+				if(total <= 1e-6f)
+					return;
+
+				// p + length * normalize(q - p)
+				const auto Place = [](const blender::Float3& p, const blender::Float3& q, float length)
+				{
+					const blender::Float3 d = Sub(q, p);
+					const float l = Length(d);
+					return (l > 0.0f ? blender::Float3{ p.x + d.x * length / l, p.y + d.y * length / l, p.z + d.z * length / l } : p);
+				};
+
+				const blender::Float3 root = joints[0];
+				if(Length(Sub(target, root)) >= total)
+				{
+					for(size_t k=0; k<n; ++k)
+						joints[k + 1] = Place(joints[k], target, lengths[k]);
+				}
+				else
+				{
+					for(uint32_t iteration=0; iteration<c.iterations && Length(Sub(joints[n], target)) > total * 1e-5f; ++iteration)
+					{
+						joints[n] = target;
+						for(size_t k=n; k-- > 0; )
+							joints[k] = Place(joints[k + 1], joints[k], lengths[k]);
+
+						joints[0] = root;
+						for(size_t k=0; k<n; ++k)
+							joints[k + 1] = Place(joints[k], joints[k + 1], lengths[k]);
+					}
+				}
+
+				for(size_t k=0; k<n; ++k)
+				{
+					const blender::Float3 head = Head(chain[k]);
+					const blender::Float3 next = (k + 1 < n ? Head(chain[k + 1]) : Effector());
+					Rotate(chain[k], QuatBetween(Sub(next, head), Sub(joints[k + 1], head)), c.influence);
+				}
+			}
+
+			void CopyRotation(size_t bone, const Constraint& c)
+			{
+				BoneTransform owner = DecomposeMatrix(m_pose[bone]);
+				const Quat target = QuatFromMatrix(TargetMatrix(c));
+				const bool allAxes = (c.axes == 7 && c.invert == 0);
+
+				float targetEuler[3], ownerAngles[3], ownerEuler[3], masked[3];
+				EulerFromQuat(target, targetEuler);
+				EulerFromQuat(owner.rotation, ownerAngles);
+				std::copy(ownerAngles, ownerAngles + 3, ownerEuler);
+				for(int axis=0; axis<3; ++axis)
+				{
+					const float value = ((c.invert >> axis) & 1 ? -targetEuler[axis] : targetEuler[axis]);
+					masked[axis] = ((c.axes >> axis) & 1 ? value : 0.0f);
+					if((c.axes >> axis) & 1)
+						ownerEuler[axis] = (c.mix == RotationMix::Add ? ownerEuler[axis] + value : value);
+				}
+
+				const Quat partial = (allAxes ? target : QuatFromEuler(masked, 1));
+				switch(c.mix)
+				{
+					case RotationMix::Replace: owner.rotation = (allAxes ? target : QuatFromEuler(ownerEuler, 1)); break;
+					case RotationMix::Offset: owner.rotation = OffsetRotation(targetEuler, ownerAngles, c); break;
+					case RotationMix::Add: owner.rotation = QuatFromEuler(ownerEuler, 1); break;
+					case RotationMix::Before: owner.rotation = QuatMultiply(partial, owner.rotation); break;
+					case RotationMix::After: owner.rotation = QuatMultiply(owner.rotation, partial); break;
+				}
+
+				SetPose(bone, BlendMatrix(m_pose[bone], MatrixFromTransform(owner), c.influence));
+			}
+
+			// Legacy offset as Blender does it (rotate_eulO): axis by axis, the copied rotation is turned by the owner's angle about that axis, then inverted.
+			static Quat OffsetRotation(const float targetEuler[3], const float ownerEuler[3], const Constraint& c)
+			{
+				float euler[3] = { targetEuler[0], targetEuler[1], targetEuler[2] };
+				for(int axis=0; axis<3; ++axis)
+				{
+					if(((c.axes >> axis) & 1) == 0)
+					{
+						euler[axis] = ownerEuler[axis];
+						continue;
+					}
+
+					float turn[3] = { 0.0f, 0.0f, 0.0f };
+					turn[axis] = ownerEuler[axis];
+					EulerFromQuat(QuatMultiply(QuatFromEuler(euler, 1), QuatFromEuler(turn, 1)), euler);
+					if((c.invert >> axis) & 1)
+						euler[axis] = -euler[axis];
+				}
+
+				return QuatFromEuler(euler, 1);
+			}
+
+			void DampedTrack(size_t bone, const Constraint& c)
+			{
+				float axis[3] = { 0.0f, 0.0f, 0.0f };
+				axis[c.trackAxis % 3] = (c.trackAxis < 3 ? 1.0f : -1.0f);
+				const blender::Float3 from = blender::TransformDirection(m_pose[bone], blender::Float3{ axis[0], axis[1], axis[2] });
+				Rotate(bone, QuatBetween(from, Sub(TargetPoint(c), Head(bone))), c.influence);
+			}
+
+			void ChildOf(size_t bone, const Constraint& c)
+			{
+				SetPose(bone, BlendMatrix(m_pose[bone], blender::Multiply(TargetMatrix(c), blender::Multiply(c.inverse, m_pose[bone])), c.influence));
+			}
+
+			const std::vector<Bone>& m_bones;
+			blender::Float4x4* m_pose;
+			std::vector<blender::Float4x4> m_relative;
+			std::vector<uint8_t> m_changed;
+	};
+
+	struct Skeleton
+	{
+		std::vector<Bone> bones;
+
+		std::optional<size_t> Find(std::string_view name) const
+		{
+			for(size_t i=0; i<bones.size(); ++i)
+			{
+				if(bones[i].name == name)
+					return { i };
+			}
+
+			return {};
+		}
+
+		bool HasConstraints() const
+		{
+			return std::any_of(bones.begin(), bones.end(), [](const Bone& bone) { return !bone.constraints.empty(); });
+		}
+
+		// Armature space pose matrices, the default inheritance of location, rotation and scale, then the constraints.
+		void PoseMatrices(const BoneTransform* locals, blender::Float4x4* out) const
+		{
+			const bool constrained = HasConstraints();
+			std::vector<blender::Float4x4> relative(constrained ? bones.size() : 0);
+			for(size_t i=0; i<bones.size(); ++i)
+			{
+				const blender::Float4x4 m = blender::Multiply(bones[i].restRelative, MatrixFromTransform(locals[i]));
+				out[i] = (bones[i].parent < 0 ? m : blender::Multiply(out[bones[i].parent], m));
+				if(constrained)
+					relative[i] = m;
+			}
+
+			if(constrained)
+				constraintSolver(bones, out, std::move(relative)).Apply();
+		}
+
+		// pose * rest^-1, rest armature space -> posed armature space
+		void SkinMatrices(const BoneTransform* locals, blender::Float4x4* out) const
+		{
+			PoseMatrices(locals, out);
+			for(size_t i=0; i<bones.size(); ++i)
+				out[i] = blender::Multiply(out[i], bones[i].restInverse);
+		}
+	};
+
+	struct BezKey
+	{
+		float frame, value;
+		float left[2];	// handles (frame, value)
+		float right[2];
+		uint8_t interpolation;
+	};
+
+	struct FCurve
+	{
+		std::string rnaPath;
+		int32_t arrayIndex{ 0 };
+		std::vector<BezKey> keys; // sorted by frame
+
+		// Constant extrapolation, the interpolation of a segment is the one of its first key.
+		float Evaluate(float frame) const
+		{
+			if(keys.empty())
+				return 0.0f;
+
+			if(frame <= keys.front().frame)
+				return keys.front().value;
+
+			if(frame >= keys.back().frame)
+				return keys.back().value;
+
+			const auto next = std::upper_bound(keys.begin(), keys.end(), frame, [](float f, const BezKey& key) { return f < key.frame; });
+			const BezKey& k0 = *(next - 1);
+			const BezKey& k1 = *next;
+
+			if(k0.interpolation == InterpolationConstant)
+				return k0.value;
+
+			if(k0.interpolation == InterpolationLinear || k1.frame <= k0.frame)
+				return k0.value + (k1.value - k0.value) * (frame - k0.frame) / std::max(k1.frame - k0.frame, std::numeric_limits<float>::min());
+
+			// handles kept inside the segment so the frame is monotonic in t, t found by bisection
+			const float x0 = k0.frame, x3 = k1.frame;
+			const float x1 = std::clamp(k0.right[0], x0, x3), x2 = std::clamp(k1.left[0], x0, x3);
+			const auto Cubic = [](float p0, float p1, float p2, float p3, float t)
+			{
+				const float u = 1.0f - t;
+				return u * u * u * p0 + 3.0f * u * u * t * p1 + 3.0f * u * t * t * p2 + t * t * t * p3;
+			};
+
+			float lo = 0.0f, hi = 1.0f;
+			for(int i=0; i<24; ++i)
+			{
+				const float mid = 0.5f * (lo + hi);
+				if(Cubic(x0, x1, x2, x3, mid) < frame)
+					lo = mid;
+				else
+					hi = mid;
+			}
+
+			return Cubic(k0.value, k0.right[1], k1.left[1], k1.value, 0.5f * (lo + hi));
+		}
+	};
+
+	struct Action
+	{
+		std::string name;
+		std::vector<FCurve> curves;
+		float frameStart{ 0.0f }; // keyed range
+		float frameEnd{ 0.0f };
+	};
+
+	// "prefix["Name"]suffix" -> Name, empty if the path doesn't start with the prefix
+	inline std::string QuotedName(std::string_view path, std::string_view prefix, std::string_view& rest)
+	{
+		if(!path.starts_with(prefix))
+			return {};
+
+		std::string name;
+		for(size_t i=prefix.size(); i<path.size(); ++i)
+		{
+			if(path[i] == '\\' && i + 1 < path.size())
+			{
+				name += path[++i];
+				continue;
+			}
+
+			if(path[i] == '"')
+			{
+				rest = path.substr(std::min(i + 2, path.size())); // past "]
+				return name;
+			}
+
+			name += path[i];
+		}
+
+		return {};
+	}
+
+	enum class ChannelProperty: uint8_t
+	{
+		Location,
+		Quaternion,
+		Euler,
+		AxisAngle,
+		Scale
+	};
+
+	// An FCurve of an action driving a pose channel value.
+	struct ChannelBinding
+	{
+		uint32_t curve;
+		uint32_t bone;
+		ChannelProperty property;
+		uint8_t component;
+	};
+
+	inline std::vector<ChannelBinding> BindAction(const Skeleton& skeleton, const Action& action)
+	{
+		static constexpr std::pair<std::string_view, ChannelProperty> Properties[] = {
+			{ ".location", ChannelProperty::Location },
+			{ ".rotation_quaternion", ChannelProperty::Quaternion },
+			{ ".rotation_euler", ChannelProperty::Euler },
+			{ ".rotation_axis_angle", ChannelProperty::AxisAngle },
+			{ ".scale", ChannelProperty::Scale }
+		};
+
+		static constexpr int32_t NumComponents[] = { 3, 4, 3, 4, 3 };
+
+		std::vector<ChannelBinding> bindings;
+		for(uint32_t c=0; c<action.curves.size(); ++c)
+		{
+			const FCurve& curve = action.curves[c];
+			std::string_view rest;
+			const auto bone = skeleton.Find(QuotedName(curve.rnaPath, "pose.bones[\"", rest));
+			if(!bone.has_value())
+				continue;
+
+			for(const auto& [suffix, property]: Properties)
+			{
+				if(rest == suffix && curve.arrayIndex >= 0 && curve.arrayIndex < NumComponents[size_t(property)])
+					bindings.emplace_back(ChannelBinding{ c, uint32_t(bone.value()), property, uint8_t(curve.arrayIndex) });
+			}
+		}
+
+		return bindings;
+	}
+
+	// Local transforms of every bone at 'frame', unanimated channels keep the values saved in the file.
+	inline void EvaluatePose(const Skeleton& skeleton, const Action& action, const std::vector<ChannelBinding>& bindings, float frame, BoneTransform* locals)
+	{
+		std::vector<ChannelValues> values(skeleton.bones.size());
+		for(size_t i=0; i<values.size(); ++i)
+			values[i] = skeleton.bones[i].channel;
+
+		for(const ChannelBinding& binding: bindings)
+		{
+			ChannelValues& channel = values[binding.bone];
+			float* const targets[] = { channel.location, channel.quaternion, channel.euler, channel.axisAngle, channel.scale };
+			targets[size_t(binding.property)][binding.component] = action.curves[binding.curve].Evaluate(frame);
+		}
+
+		for(size_t i=0; i<values.size(); ++i)
+			locals[i] = values[i].Resolve();
+	}
+
+	struct SampledClip
+	{
+		std::string name;
+		float frameStart{ 0.0f };
+		float frameStep{ 1.0f };
+		uint32_t numFrames{ 0 };
+		uint32_t numBones{ 0 };
+		std::vector<BoneTransform> locals; // [frame * numBones + bone]
+
+		BoneTransform* Frame(size_t frame) { return locals.data() + frame * numBones; }
+		const BoneTransform* Frame(size_t frame) const { return locals.data() + frame * numBones; }
+	};
+
+	inline uint32_t FrameCount(float frameStart, float frameEnd, float frameStep)
+	{
+		return (frameEnd >= frameStart && frameStep > 0.0f ? uint32_t(std::floor((frameEnd - frameStart) / frameStep + 1e-4f)) + 1 : 1);
+	}
+
+	// Samples the action over [frameStart, frameEnd], frames in parallel.
+	inline SampledClip SampleClip(const Skeleton& skeleton, const Action& action, float frameStart, float frameEnd, float frameStep = 1.0f)
+	{
+		SampledClip clip;
+		clip.name = action.name;
+		clip.frameStart = frameStart;
+		clip.frameStep = frameStep;
+		clip.numFrames = FrameCount(frameStart, frameEnd, frameStep);
+		clip.numBones = uint32_t(skeleton.bones.size());
+		clip.locals.resize(size_t(clip.numFrames) * clip.numBones);
+
+		const std::vector<ChannelBinding> bindings = BindAction(skeleton, action);
+		std::vector<uint32_t> frames(clip.numFrames);
+		std::iota(frames.begin(), frames.end(), 0);
+		std::for_each(std::execution::par, frames.begin(), frames.end(), [&](uint32_t f)
+		{
+			EvaluatePose(skeleton, action, bindings, frameStart + f * frameStep, clip.Frame(f));
+		});
+
+		return clip;
+	}
+
+	// Root motion of a frame in armature space: planar translation and yaw (radians about +Z) of the character.
+	struct RootMotionFrame
+	{
+		float x, y;
+		float yaw;
+	};
+
+	struct RootMotionTrack
+	{
+		std::string clip;
+		std::vector<RootMotionFrame> frames;	// continuous yaw, may leave [-pi, pi]
+	};
+
+	// The root bone with the most descendants, empty for a skeleton without bones.
+	inline std::optional<size_t> FindRootBone(const Skeleton& skeleton)
+	{
+		std::vector<uint32_t> descendants(skeleton.bones.size(), 0);
+		for(size_t i=skeleton.bones.size(); i-- > 0; )
+		{
+			if(skeleton.bones[i].parent >= 0)
+				descendants[skeleton.bones[i].parent] += descendants[i] + 1;
+		}
+
+		std::optional<size_t> root;
+		for(size_t i=0; i<skeleton.bones.size(); ++i)
+		{
+			if(skeleton.bones[i].parent < 0 && (!root.has_value() || descendants[i] > descendants[root.value()]))
+				root = i;
+		}
+
+		return root;
+	}
+
+	/*
+	* Splits the root bone's motion into a root motion track and removes it from the clips. The root's pose is
+	* T(d) * Rh(D) * rest - d its location in armature space, D its rotation in armature space about its rest head h.
+	* D = yaw * swing (twist about Z), the track is T(d.xy) * Rh(yaw), what stays T(d.z) * Rh(swing). All frames of all
+	* clips go through one structure of arrays batch.
+	*/
+	inline std::vector<RootMotionTrack> ExtractRootMotion(const Skeleton& skeleton, size_t root, std::vector<SampledClip>& clips)
+	{
+		const Bone& bone = skeleton.bones.at(root);
+		const Quat restRotation = QuatFromMatrix(bone.rest);
+		const Quat restInverse = QuatConjugate(restRotation);
+		const float hx = bone.rest.m[3][0], hy = bone.rest.m[3][1];
+
+		// location -> armature space is the 3x3 of the rest (parent pose of a root is the identity), its inverse puts d.z back
+		const blender::Float4x4& r = bone.rest;
+		blender::Float4x4 inverse{};
+		blender::InvertAffine(inverse, bone.rest);
+		const float zx = inverse.m[2][0], zy = inverse.m[2][1], zz = inverse.m[2][2];
+
+		size_t n = 0;
+		for(const SampledClip& clip: clips)
+			n += clip.numFrames;
+
+		enum Lane { LocX, LocY, LocZ, RotW, RotX, RotY, RotZ, TwistW, TwistZ, MoveX, MoveY, NumLanes };
+		std::vector<float> lanes[NumLanes];
+		for(auto& lane: lanes)
+			lane.resize(n);
+
+		for(size_t i=0; const SampledClip& clip: clips)
+		{
+			for(uint32_t f=0; f<clip.numFrames; ++f, ++i)
+			{
+				const BoneTransform& t = clip.Frame(f)[root];
+				lanes[LocX][i] = t.location.x;
+				lanes[LocY][i] = t.location.y;
+				lanes[LocZ][i] = t.location.z;
+				lanes[RotW][i] = t.rotation.w;
+				lanes[RotX][i] = t.rotation.x;
+				lanes[RotY][i] = t.rotation.y;
+				lanes[RotZ][i] = t.rotation.z;
+			}
+		}
+
+		size_t i = 0;
+
+#if defined(__AVX2__)
+		{
+			const Quat8 qr = QuatBroadcast(restRotation), qrInverse = QuatBroadcast(restInverse);
+			const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f), tiny = _mm256_set1_ps(1e-12f);
+			for(; i + 8 <= n; i += 8)
+			{
+				const __m256 lx = _mm256_loadu_ps(&lanes[LocX][i]), ly = _mm256_loadu_ps(&lanes[LocY][i]), lz = _mm256_loadu_ps(&lanes[LocZ][i]);
+				const __m256 dx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(r.m[0][0]), lx), _mm256_mul_ps(_mm256_set1_ps(r.m[1][0]), ly)), _mm256_mul_ps(_mm256_set1_ps(r.m[2][0]), lz));
+				const __m256 dy = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(r.m[0][1]), lx), _mm256_mul_ps(_mm256_set1_ps(r.m[1][1]), ly)), _mm256_mul_ps(_mm256_set1_ps(r.m[2][1]), lz));
+				const __m256 dz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(r.m[0][2]), lx), _mm256_mul_ps(_mm256_set1_ps(r.m[1][2]), ly)), _mm256_mul_ps(_mm256_set1_ps(r.m[2][2]), lz));
+
+				const Quat8 d = QuatMultiply(QuatMultiply(qr, QuatLoad(&lanes[RotW][i], &lanes[RotX][i], &lanes[RotY][i], &lanes[RotZ][i])), qrInverse);
+
+				// twist (tw, 0, 0, tz) with tw >= 0, the identity where D is a half turn about a horizontal axis
+				const __m256 signW = _mm256_and_ps(d.w, _mm256_set1_ps(-0.0f));
+				const __m256 length2 = _mm256_add_ps(_mm256_mul_ps(d.w, d.w), _mm256_mul_ps(d.z, d.z));
+				const __m256 valid = _mm256_cmp_ps(length2, tiny, _CMP_GT_OQ);
+				const __m256 invLength = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_max_ps(length2, tiny)));
+				const __m256 tw = _mm256_blendv_ps(one, _mm256_xor_ps(_mm256_mul_ps(d.w, invLength), signW), valid);
+				const __m256 tz = _mm256_blendv_ps(zero, _mm256_xor_ps(_mm256_mul_ps(d.z, invLength), signW), valid);
+
+				const Quat8 swing = QuatMultiply(Quat8{ tw, zero, zero, _mm256_sub_ps(zero, tz) }, d);
+				QuatStore(QuatMultiply(QuatMultiply(qrInverse, swing), qr), &lanes[RotW][i], &lanes[RotX][i], &lanes[RotY][i], &lanes[RotZ][i]);
+
+				_mm256_storeu_ps(&lanes[LocX][i], _mm256_mul_ps(_mm256_set1_ps(zx), dz));
+				_mm256_storeu_ps(&lanes[LocY][i], _mm256_mul_ps(_mm256_set1_ps(zy), dz));
+				_mm256_storeu_ps(&lanes[LocZ][i], _mm256_mul_ps(_mm256_set1_ps(zz), dz));
+				_mm256_storeu_ps(&lanes[TwistW][i], tw);
+				_mm256_storeu_ps(&lanes[TwistZ][i], tz);
+
+				// d.xy + h - Rz(yaw) h
+				const __m256 c = _mm256_sub_ps(_mm256_mul_ps(tw, tw), _mm256_mul_ps(tz, tz));
+				const __m256 s = _mm256_mul_ps(_mm256_set1_ps(2.0f), _mm256_mul_ps(tw, tz));
+				const __m256 x = _mm256_set1_ps(hx), y = _mm256_set1_ps(hy);
+				_mm256_storeu_ps(&lanes[MoveX][i], _mm256_add_ps(dx, _mm256_sub_ps(x, _mm256_sub_ps(_mm256_mul_ps(c, x), _mm256_mul_ps(s, y)))));
+				_mm256_storeu_ps(&lanes[MoveY][i], _mm256_add_ps(dy, _mm256_sub_ps(y, _mm256_add_ps(_mm256_mul_ps(s, x), _mm256_mul_ps(c, y)))));
+			}
+		}
+#endif
+
+		for(; i<n; ++i)
+		{
+			const float lx = lanes[LocX][i], ly = lanes[LocY][i], lz = lanes[LocZ][i];
+			const float dx = r.m[0][0] * lx + r.m[1][0] * ly + r.m[2][0] * lz;
+			const float dy = r.m[0][1] * lx + r.m[1][1] * ly + r.m[2][1] * lz;
+			const float dz = r.m[0][2] * lx + r.m[1][2] * ly + r.m[2][2] * lz;
+
+			const Quat d = QuatMultiply(QuatMultiply(restRotation, Quat{ lanes[RotW][i], lanes[RotX][i], lanes[RotY][i], lanes[RotZ][i] }), restInverse);
+			const float length2 = d.w * d.w + d.z * d.z;
+			const float invLength = std::copysign(1.0f / std::sqrt(std::max(length2, 1e-12f)), d.w);
+			const float tw = (length2 > 1e-12f ? d.w * invLength : 1.0f);
+			const float tz = (length2 > 1e-12f ? d.z * invLength : 0.0f);
+
+			const Quat rotation = QuatMultiply(QuatMultiply(restInverse, QuatMultiply(Quat{ tw, 0.0f, 0.0f, -tz }, d)), restRotation);
+			lanes[RotW][i] = rotation.w;
+			lanes[RotX][i] = rotation.x;
+			lanes[RotY][i] = rotation.y;
+			lanes[RotZ][i] = rotation.z;
+			lanes[LocX][i] = zx * dz;
+			lanes[LocY][i] = zy * dz;
+			lanes[LocZ][i] = zz * dz;
+			lanes[TwistW][i] = tw;
+			lanes[TwistZ][i] = tz;
+
+			const float c = tw * tw - tz * tz, s = 2.0f * tw * tz;
+			lanes[MoveX][i] = dx + hx - (c * hx - s * hy);
+			lanes[MoveY][i] = dy + hy - (s * hx + c * hy);
+		}
+
+		std::vector<RootMotionTrack> tracks(clips.size());
+		for(size_t c=0, i=0; c<clips.size(); ++c)
+		{
+			SampledClip& clip = clips[c];
+			tracks[c].clip = clip.name;
+			tracks[c].frames.resize(clip.numFrames);
+
+			float previousYaw = 0.0f;
+			for(uint32_t f=0; f<clip.numFrames; ++f, ++i)
+			{
+				BoneTransform& t = clip.Frame(f)[root];
+				t.location = blender::Float3{ lanes[LocX][i], lanes[LocY][i], lanes[LocZ][i] };
+				t.rotation = Quat{ lanes[RotW][i], lanes[RotX][i], lanes[RotY][i], lanes[RotZ][i] };
+
+				// unwrapped against the previous frame so the track interpolates
+				constexpr float TwoPi = 6.28318530717958647692f;
+				float yaw = 2.0f * std::atan2(lanes[TwistZ][i], lanes[TwistW][i]);
+				if(f > 0)
+					yaw -= std::nearbyint((yaw - previousYaw) / TwoPi) * TwoPi;
+
+				previousYaw = yaw;
+				tracks[c].frames[f] = RootMotionFrame{ lanes[MoveX][i], lanes[MoveY][i], yaw };
+			}
+		}
+
+		return tracks;
+	}
+
+	// source bone name -> target bone name
+	using BoneMapping = std::pair<std::string, std::string>;
+
+	/*
+	* Bone map file: one "source=target" per line, blank lines and lines starting with '#' ignored, spaces around the
+	* names trimmed. Empty if the file can't be read or has a malformed line.
+	*/
+	inline std::optional<std::vector<BoneMapping>> ReadBoneMap(const std::filesystem::path& path)
+	{
+		FILE* f = OpenFile(path, "rb");
+		if(f == nullptr)
+		{
+			std::cout << "ERROR - can't open bone map " << path.string() << "!\n";
+			return {};
+		}
+
+		std::string text;
+		char buffer[4096];
+		for(size_t n; (n = fread(buffer, 1, sizeof(buffer), f)) > 0; )
+			text.append(buffer, n);
+
+		fclose(f);
+
+		const auto Trim = [](std::string_view s)
+		{
+			const size_t first = s.find_first_not_of(" \t\r");
+			return (first == std::string_view::npos ? std::string_view{} : s.substr(first, s.find_last_not_of(" \t\r") - first + 1));
+		};
+
+		std::vector<BoneMapping> mappings;
+		size_t lineNumber = 0;
+		for(std::string_view rest=text; !rest.empty(); )
+		{
+			const size_t end = std::min(rest.find('\n'), rest.size());
+			const std::string_view line = Trim(rest.substr(0, end));
+			rest.remove_prefix(std::min(end + 1, rest.size()));
+			++lineNumber;
+
+			if(line.empty() || line.front() == '#')
+				continue;
+
+			const size_t separator = line.find('=');
+			const std::string_view source = (separator != std::string_view::npos ? Trim(line.substr(0, separator)) : std::string_view{});
+			const std::string_view target = (separator != std::string_view::npos ? Trim(line.substr(separator + 1)) : std::string_view{});
+			if(source.empty() || target.empty())
+			{
+				std::cout << "ERROR - bone map " << path.string() << " line " << lineNumber << " is not source=target!\n";
+				return {};
+			}
+
+			mappings.emplace_back(std::string(source), std::string(target));
+		}
+
+		return mappings;
+	}
+
+	/*
+	* Per target bone: its source bone and the corrections for the rest pose difference. A local rotation q_s of the
+	* source is the armature space rotation Rs * q_s * Rs^-1, the same one on the target is C * q_s * C^-1 with
+	* C = Rt^-1 * Rs (Rs, Rt: rest rotations). Locations go through armature space the same way, scaled by the ratio
+	* of the skeletons' heights.
+	*/
+	struct RetargetMap
+	{
+		std::vector<int32_t> source;				// per target bone, -1 unmapped (keeps its channel values)
+		std::vector<Quat> correction;				// C
+		std::vector<blender::Float4x4> location;	// heightRatio * Rt^-1 * Rs, 3x3 part
+		float heightRatio{ 1.0f };
+
+		size_t NumMapped() const { return size_t(std::count_if(source.begin(), source.end(), [](int32_t s) { return s >= 0; })); }
+	};
+
+	// Height of the rest pose: the highest bone head above the armature origin.
+	inline float RestHeight(const Skeleton& skeleton)
+	{
+		float height = 0.0f;
+		for(const Bone& bone: skeleton.bones)
+			height = std::max(height, bone.rest.m[3][2]);
+
+		return height;
+	}
+
+	// Bones of the map, then the remaining target bones to source bones of the same name. Map lines naming a bone
+	// either skeleton doesn't have are reported and ignored.
+	inline RetargetMap BuildRetargetMap(const Skeleton& source, const Skeleton& target, const std::vector<BoneMapping>& mappings)
+	{
+		RetargetMap map;
+		map.source.assign(target.bones.size(), -1);
+		map.correction.assign(target.bones.size(), Quat{ 1.0f, 0.0f, 0.0f, 0.0f });
+		map.location.assign(target.bones.size(), blender::Identity());
+
+		for(const auto& [sourceName, targetName]: mappings)
+		{
+			const auto s = source.Find(sourceName);
+			const auto t = target.Find(targetName);
+			if(s.has_value() && t.has_value())
+			{
+				map.source[t.value()] = int32_t(s.value());
+				continue;
+			}
+
+			std::cout << "WARNING - bone map line " << sourceName << '=' << targetName << " ignored, no "
+					  << (s.has_value() ? "target bone" : t.has_value() ? "source bone" : "source or target bone") << " of that name!\n";
+		}
+
+		for(size_t t=0; t<target.bones.size(); ++t)
+		{
+			const auto s = source.Find(target.bones[t].name);
+			if(map.source[t] < 0 && s.has_value())
+				map.source[t] = int32_t(s.value());
+		}
+
+		const float sourceHeight = RestHeight(source), targetHeight = RestHeight(target);
+		map.heightRatio = (sourceHeight > 0.0f && targetHeight > 0.0f ? targetHeight / sourceHeight : 1.0f);
+
+		for(size_t t=0; t<target.bones.size(); ++t)
+		{
+			if(map.source[t] < 0)
+				continue;
+
+			const Bone& s = source.bones[map.source[t]];
+			map.correction[t] = QuatMultiply(QuatConjugate(QuatFromMatrix(target.bones[t].rest)), QuatFromMatrix(s.rest));
+
+			blender::Float4x4 rs = s.rest, rt = target.bones[t].rest;
+			rs.m[3][0] = rs.m[3][1] = rs.m[3][2] = 0.0f;
+			rt.m[3][0] = rt.m[3][1] = rt.m[3][2] = 0.0f;
+			blender::Float4x4 rtInverse;
+			if(!blender::InvertAffine(rtInverse, rt))
+				continue;
+
+			map.location[t] = blender::Multiply(rtInverse, rs);
+			for(int col=0; col<3; ++col)
+			{
+				for(int row=0; row<3; ++row)
+					map.location[t].m[col][row] *= map.heightRatio;
+			}
+		}
+
+		return map;
+	}
+
+	/*
+	* Retargets sampled clips of the source skeleton onto the target. Every mapped bone is one structure of arrays pass
+	* over the frames of a clip - 8 frames per step with AVX2 - and the clips run in parallel.
+	*/
+	inline std::vector<SampledClip> Retarget(const Skeleton& target, const RetargetMap& map, const std::vector<SampledClip>& clips)
+	{
+		std::vector<SampledClip> retargeted(clips.size());
+		std::transform(std::execution::par, clips.begin(), clips.end(), retargeted.begin(), [&](const SampledClip& clip)
+		{
+			SampledClip out;
+			out.name = clip.name;
+			out.frameStart = clip.frameStart;
+			out.frameStep = clip.frameStep;
+			out.numFrames = clip.numFrames;
+			out.numBones = uint32_t(target.bones.size());
+			out.locals.resize(size_t(out.numFrames) * out.numBones);
+
+			for(uint32_t f=0; f<out.numFrames; ++f)
+			{
+				for(uint32_t b=0; b<out.numBones; ++b)
+					out.Frame(f)[b] = target.bones[b].channel.Resolve();
+			}
+
+			enum Lane { LocX, LocY, LocZ, RotW, RotX, RotY, RotZ, NumLanes };
+			std::vector<float> lanes[NumLanes];
+			for(auto& lane: lanes)
+				lane.resize(clip.numFrames);
+
+			for(uint32_t b=0; b<out.numBones; ++b)
+			{
+				if(map.source[b] < 0)
+					continue;
+
+				const uint32_t s = uint32_t(map.source[b]);
+				for(uint32_t f=0; f<clip.numFrames; ++f)
+				{
+					const BoneTransform& t = clip.Frame(f)[s];
+					lanes[LocX][f] = t.location.x;
+					lanes[LocY][f] = t.location.y;
+					lanes[LocZ][f] = t.location.z;
+					lanes[RotW][f] = t.rotation.w;
+					lanes[RotX][f] = t.rotation.x;
+					lanes[RotY][f] = t.rotation.y;
+					lanes[RotZ][f] = t.rotation.z;
+				}
+
+				const Quat& c = map.correction[b];
+				const auto& m = map.location[b].m;
+				size_t i = 0;
+
+#if defined(__AVX2__)
+				{
+					const Quat8 correction = QuatBroadcast(c), correctionInverse = QuatBroadcast(QuatConjugate(c));
+					for(; i + 8 <= clip.numFrames; i += 8)
+					{
+						QuatStore(QuatMultiply(QuatMultiply(correction, QuatLoad(&lanes[RotW][i], &lanes[RotX][i], &lanes[RotY][i], &lanes[RotZ][i])), correctionInverse),
+								  &lanes[RotW][i], &lanes[RotX][i], &lanes[RotY][i], &lanes[RotZ][i]);
+
+						const __m256 x = _mm256_loadu_ps(&lanes[LocX][i]), y = _mm256_loadu_ps(&lanes[LocY][i]), z = _mm256_loadu_ps(&lanes[LocZ][i]);
+						for(int row=0; row<3; ++row)
+						{
+							const __m256 v = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m[0][row]), x), _mm256_mul_ps(_mm256_set1_ps(m[1][row]), y)),
+														   _mm256_mul_ps(_mm256_set1_ps(m[2][row]), z));
+							_mm256_storeu_ps(&lanes[LocX + row][i], v);
+						}
+					}
+				}
+#endif
+
+				for(; i<clip.numFrames; ++i)
+				{
+					const Quat q = QuatMultiply(QuatMultiply(c, Quat{ lanes[RotW][i], lanes[RotX][i], lanes[RotY][i], lanes[RotZ][i] }), QuatConjugate(c));
+					lanes[RotW][i] = q.w;
+					lanes[RotX][i] = q.x;
+					lanes[RotY][i] = q.y;
+					lanes[RotZ][i] = q.z;
+
+					const float x = lanes[LocX][i], y = lanes[LocY][i], z = lanes[LocZ][i];
+					for(int row=0; row<3; ++row)
+						lanes[LocX + row][i] = m[0][row] * x + m[1][row] * y + m[2][row] * z;
+				}
+
+				for(uint32_t f=0; f<clip.numFrames; ++f)
+				{
+					BoneTransform& t = out.Frame(f)[b];
+					t.location = blender::Float3{ lanes[LocX][f], lanes[LocY][f], lanes[LocZ][f] };
+					t.rotation = Quat{ lanes[RotW][f], lanes[RotX][f], lanes[RotY][f], lanes[RotZ][f] };
+					t.scale = clip.Frame(f)[s].scale;
+				}
+			}
+
+			return out;
+		});
+
+		return retargeted;
+	}
+
+	struct SkinInfluence
+	{
+		uint16_t bone[4];
+		float weight[4]; // sum 1, or all 0 for a vertex no bone deforms
+	};
+
+	// Linear blend skinning with armature space skin matrices, 'premat' takes the mesh to armature space, 'postmat' back.
+	inline void Skin(const std::vector<blender::Float3>& positions, const std::vector<SkinInfluence>& influences, const std::vector<blender::Float4x4>& skinMatrices,
+					 std::vector<blender::Float3>& out)
+	{
+		out.resize(positions.size());
+		std::transform(std::execution::unseq, positions.begin(), positions.end(), influences.begin(), out.begin(), [&](const blender::Float3& p, const SkinInfluence& influence)
+		{
+			if(influence.weight[0] == 0.0f)
+				return p;
+
+			blender::Float3 sum{ 0.0f, 0.0f, 0.0f };
+			for(int i=0; i<4; ++i)
+			{
+				if(influence.weight[i] == 0.0f)
+					break;
+
+				const blender::Float3 moved = blender::TransformPoint(skinMatrices[influence.bone[i]], p);
+				sum.x += moved.x * influence.weight[i];
+				sum.y += moved.y * influence.weight[i];
+				sum.z += moved.z * influence.weight[i];
+			}
+
+			return sum;
+		});
+	}
+
+	// Area weighted vertex normals of a triangle list.
+	inline void VertexNormals(const std::vector<blender::Float3>& positions, const std::vector<uint32_t>& indices, std::vector<blender::Float3>& normals)
+	{
+		normals.assign(positions.size(), blender::Float3{ 0.0f, 0.0f, 0.0f });
+		for(size_t t=0; t + 2<indices.size(); t+=3)
+		{
+			const blender::Float3& a = positions[indices[t]];
+			const blender::Float3& b = positions[indices[t + 1]];
+			const blender::Float3& c = positions[indices[t + 2]];
+			const float ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+			const float vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+			const blender::Float3 n{ uy * vz - uz * vy, uz * vx - ux * vz, ux * vy - uy * vx };
+			for(int k=0; k<3; ++k)
+			{
+				blender::Float3& sum = normals[indices[t + k]];
+				sum.x += n.x;
+				sum.y += n.y;
+				sum.z += n.z;
+			}
+		}
+
+		for(blender::Float3& n: normals)
+		{
+			const float length = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+			n = (length > 0.0f ? blender::Float3{ n.x / length, n.y / length, n.z / length } : blender::Float3{ 0.0f, 0.0f, 1.0f });
+		}
+	}
+
+	// Relative shape keys of a mesh, block 0 is the basis.
+	struct ShapeKeys
+	{
+		struct Block
+		{
+			std::string name;
+			std::vector<blender::Float3> positions;
+			uint32_t relative{ 0 };	// block the offset is taken to
+			float value{ 0.0f };	// influence saved in the file
+			float sliderMin{ 0.0f };
+			float sliderMax{ 1.0f };
+		};
+
+		std::vector<Block> blocks;
+		Action action;						// key_blocks["Name"].value curves
+		std::vector<int32_t> curveBlock;	// per curve of the action, -1 unbound
+
+		void Bind()
+		{
+			curveBlock.assign(action.curves.size(), -1);
+			for(size_t c=0; c<action.curves.size(); ++c)
+			{
+				std::string_view rest;
+				const std::string name = QuotedName(action.curves[c].rnaPath, "key_blocks[\"", rest);
+				for(size_t b=1; b<blocks.size() && rest == ".value"; ++b)
+				{
+					if(blocks[b].name == name)
+						curveBlock[c] = int32_t(b);
+				}
+			}
+		}
+
+		// basis + sum of influence * (key - relative key)
+		void Evaluate(float frame, std::vector<blender::Float3>& out) const
+		{
+			std::vector<float> influence(blocks.size());
+			for(size_t b=0; b<blocks.size(); ++b)
+				influence[b] = blocks[b].value;
+
+			for(size_t c=0; c<curveBlock.size(); ++c)
+			{
+				if(curveBlock[c] >= 0)
+					influence[curveBlock[c]] = action.curves[c].Evaluate(frame);
+			}
+
+			out = blocks.front().positions;
+			for(size_t b=1; b<blocks.size(); ++b)
+			{
+				const float w = std::clamp(influence[b], blocks[b].sliderMin, blocks[b].sliderMax);
+				const auto& key = blocks[b].positions;
+				const auto& relative = blocks[std::min<size_t>(blocks[b].relative, blocks.size() - 1)].positions;
+				if(w == 0.0f || key.size() != out.size() || relative.size() != out.size())
+					continue;
+
+				for(size_t v=0; v<out.size(); ++v)
+				{
+					out[v].x += w * (key[v].x - relative[v].x);
+					out[v].y += w * (key[v].y - relative[v].y);
+					out[v].z += w * (key[v].z - relative[v].z);
+				}
+			}
+		}
+	};
+}
+
+/*
+* Lossless codec for the exported geometry streams, meant to run before any general purpose compression.
+*	Attributes: every component (4 bytes, eg. the bits of a float) is a stream of its own. A word is stored as the
+*	zigzag of its difference to the word 8 elements earlier, in blocks of 256 bit packed to the widest value of the
+*	block. The packing is vertical - value i in lane i % 8 - so a block decodes with 8 wide shifts and adds.
+*	Indices: a triangle reusing an edge of a recent triangle costs a code byte (edge FIFO slot, third vertex new, from
+*	the vertex FIFO or explicit) and 2 bits of rotation, other triangles 2 bytes of vertex references. Explicit
+*	vertices are varint deltas to a vertex just before them.
+* Stream: uint32 count, uint32 numChunks, uint32 chunkBytes[numChunks], the chunks. Chunks code independently, they are
+* encoded and decoded in parallel.
+*/
+namespace codec
+{
+	inline constexpr size_t Lanes = 8;
+	inline constexpr size_t BlockValues = Lanes * 32;
+	inline constexpr size_t ChunkElements = 64 * BlockValues;
+	inline constexpr size_t ChunkTriangles = 16384;
+	inline constexpr size_t EdgeFifoSize = 15;		// code byte high nibble, 15 = no shared edge
+	inline constexpr size_t VertexFifoSize = 14;	// code byte low nibble 1..14, 0 = next new vertex, 15 = explicit
+	inline constexpr uint8_t NoEdge = 0xF0;
+	inline constexpr uint8_t NewVertex = 0;
+	inline constexpr uint8_t ExplicitVertex = 15;
+
+	inline uint32_t ZigZag(uint32_t delta) { return (delta << 1) ^ uint32_t(int32_t(delta) >> 31); }
+	inline uint32_t UnZigZag(uint32_t value) { return (value >> 1) ^ (0u - (value & 1)); }
+
+	inline void AppendVarint(std::vector<uint8_t>& out, uint32_t value)
+	{
+		while(value >= 0x80)
+		{
+			out.emplace_back(uint8_t(value | 0x80));
+			value >>= 7;
+		}
+
+		out.emplace_back(uint8_t(value));
+	}
+
+	inline bool ReadVarint(const uint8_t*& p, const uint8_t* end, uint32_t& value)
+	{
+		value = 0;
+		for(int shift=0; shift<35 && p < end; shift+=7)
+		{
+			const uint8_t byte = *p++;
+			value |= uint32_t(byte & 0x7F) << shift;
+			if((byte & 0x80) == 0)
+				return true;
+		}
+
+		return false;
+	}
+
+	inline void AppendWord(std::vector<uint8_t>& out, uint32_t word)
+	{
+		const size_t at = out.size();
+		out.resize(at + 4);
+		memcpy(out.data() + at, &word, 4);
+	}
+
+	inline uint32_t ReadWord(const uint8_t* p)
+	{
+		uint32_t word;
+		memcpy(&word, p, 4);
+		return word;
+	}
+
+	// Header and chunk table in front of the chunks.
+	inline std::vector<uint8_t> Assemble(size_t count, const std::vector<std::vector<uint8_t>>& chunks)
+	{
+		size_t total = 8 + 4 * chunks.size();
+		for(const auto& chunk: chunks)
+			total += chunk.size();
+
+		std::vector<uint8_t> out;
+		out.reserve(total);
+		AppendWord(out, uint32_t(count));
+		AppendWord(out, uint32_t(chunks.size()));
+		for(const auto& chunk: chunks)
+			AppendWord(out, uint32_t(chunk.size()));
+
+		for(const auto& chunk: chunks)
+			out.insert(out.end(), chunk.begin(), chunk.end());
+
+		return out;
+	}
+
+	// Start of every chunk, false if the table doesn't match the stream or its element count.
+	inline bool ChunkTable(const uint8_t* data, size_t size, size_t count, size_t chunkElements, std::vector<const uint8_t*>& starts, std::vector<size_t>& sizes)
+	{
+		if(size < 8 || ReadWord(data) != count)
+			return false;
+
+		const size_t numChunks = ReadWord(data + 4);
+		if(numChunks != (count + chunkElements - 1) / chunkElements || (size - 8) / 4 < numChunks)
+			return false;
+
+		size_t offset = 8 + 4 * numChunks;
+		for(size_t c=0; c<numChunks; ++c)
+		{
+			const size_t chunkSize = ReadWord(data + 8 + 4 * c);
+			if(chunkSize > size - offset)
+				return false;
+
+			starts.emplace_back(data + offset);
+			sizes.emplace_back(chunkSize);
+			offset += chunkSize;
+		}
+
+		return offset == size;
+	}
+
+	// Rows of the block holding the values from 'first' on, only the last block of a chunk is short.
+	inline size_t BlockRows(size_t first, size_t n) { return (std::min(BlockValues, n - first) + Lanes - 1) / Lanes; }
+
+	// Words of a block of 'rows' rows of 'width' bits per lane.
+	inline size_t BlockWords(uint32_t width, size_t rows) { return Lanes * ((rows * width + 31) / 32); }
+
+	// 'rows' rows of 8 zigzag deltas -> width byte and BlockWords(width, rows) words.
+	inline void PackBlock(const uint32_t* values, size_t rows, std::vector<uint8_t>& widths, std::vector<uint8_t>& words)
+	{
+		uint32_t any = 0;
+		for(size_t i=0; i<rows * Lanes; ++i)
+			any |= values[i];
+
+		const uint32_t width = uint32_t(std::bit_width(any));
+		widths.emplace_back(uint8_t(width));
+
+		std::array<uint32_t, Lanes * 32> packed{};
+		for(size_t j=0; j<rows; ++j)
+		{
+			const size_t bit = j * width, word = bit / 32, shift = bit % 32;
+			for(size_t lane=0; lane<Lanes; ++lane)
+			{
+				const uint32_t value = values[j * Lanes + lane];
+				packed[word * Lanes + lane] |= value << shift;
+				if(shift + width > 32)
+					packed[(word + 1) * Lanes + lane] |= value >> (32 - shift);
+			}
+		}
+
+		for(size_t w=0; w<BlockWords(width, rows); ++w)
+			AppendWord(words, packed[w]);
+	}
+
+	// Unpacks 'rows' rows of 'width' bit values and adds them up per lane, 'carry' is the last row of the previous block.
+	inline void UnpackBlock(const uint8_t* words, uint32_t width, size_t rows, uint32_t* carry, uint32_t* out)
+	{
+		if(width == 0)
+		{
+			for(size_t j=0; j<rows; ++j)
+				memcpy(out + j * Lanes, carry, Lanes * 4);
+			return;
+		}
+
+		const uint32_t mask = (width == 32 ? ~0u : (1u << width) - 1);
+
+#if defined(__AVX2__)
+		__m256i sum = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(carry));
+		const __m256i valueMask = _mm256_set1_epi32(int32_t(mask));
+		const __m256i one = _mm256_set1_epi32(1);
+		for(size_t j=0; j<rows; ++j)
+		{
+			const size_t bit = j * width, word = bit / 32, shift = bit % 32;
+			__m256i v = _mm256_srl_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + word * Lanes * 4)), _mm_cvtsi32_si128(int(shift)));
+			if(shift + width > 32)
+				v = _mm256_or_si256(v, _mm256_sll_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + (word + 1) * Lanes * 4)), _mm_cvtsi32_si128(int(32 - shift))));
+
+			v = _mm256_and_si256(v, valueMask);
+			v = _mm256_xor_si256(_mm256_srli_epi32(v, 1), _mm256_sub_epi32(_mm256_setzero_si256(), _mm256_and_si256(v, one)));
+			sum = _mm256_add_epi32(sum, v);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j * Lanes), sum);
+		}
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(carry), sum);
+#else
+		for(size_t j=0; j<rows; ++j)
+		{
+			const size_t bit = j * width, word = bit / 32, shift = bit % 32;
+			for(size_t lane=0; lane<Lanes; ++lane)
+			{
+				uint32_t v = ReadWord(words + (word * Lanes + lane) * 4) >> shift;
+				if(shift + width > 32)
+					v |= ReadWord(words + ((word + 1) * Lanes + lane) * 4) << (32 - shift);
+
+				carry[lane] += UnZigZag(v & mask);
+				out[j * Lanes + lane] = carry[lane];
+			}
+		}
+#endif
+	}
+
+	/*
+	* 'count' elements of 'numComponents' 4 byte words each, interleaved (eg. Float3 positions: 3).
+	* Chunk: per component { uint8 widths[numBlocks], words }, the last block only packs the rows it holds.
+	*/
+	inline std::vector<uint8_t> EncodeAttributes(const void* elements, size_t count, size_t numComponents)
+	{
+		const uint8_t* src = static_cast<const uint8_t*>(elements);
+		std::vector<size_t> chunkIds((count + ChunkElements - 1) / ChunkElements);
+		std::iota(chunkIds.begin(), chunkIds.end(), 0);
+
+		std::vector<std::vector<uint8_t>> chunks(chunkIds.size());
+		std::transform(std::execution::par, chunkIds.begin(), chunkIds.end(), chunks.begin(), [&](size_t chunkId)
+		{
+			const size_t first = chunkId * ChunkElements;
+			const size_t n = std::min(ChunkElements, count - first);
+			const size_t numBlocks = (n + BlockValues - 1) / BlockValues;
+
+			std::vector<uint8_t> chunk;
+			std::vector<uint8_t> widths, words;
+			std::vector<uint32_t> deltas(numBlocks * BlockValues, 0);
+			for(size_t component=0; component<numComponents; ++component)
+			{
+				uint32_t previous[Lanes] = {};
+				for(size_t i=0; i<n; ++i)
+				{
+					uint32_t word;
+					memcpy(&word, src + ((first + i) * numComponents + component) * 4, 4);
+					deltas[i] = ZigZag(word - previous[i % Lanes]);
+					previous[i % Lanes] = word;
+				}
+
+				// the padding of the last block repeats the last row: zero deltas
+				std::fill(deltas.begin() + n, deltas.end(), 0);
+
+				widths.clear();
+				words.clear();
+				for(size_t b=0; b<numBlocks; ++b)
+					PackBlock(deltas.data() + b * BlockValues, BlockRows(b * BlockValues, n), widths, words);
+
+				chunk.insert(chunk.end(), widths.begin(), widths.end());
+				chunk.insert(chunk.end(), words.begin(), words.end());
+			}
+
+			return chunk;
+		});
+
+		return Assemble(count, chunks);
+	}
+
+	inline bool DecodeAttributes(const uint8_t* data, size_t size, void* elements, size_t count, size_t numComponents)
+	{
+		std::vector<const uint8_t*> starts;
+		std::vector<size_t> sizes;
+		if(!ChunkTable(data, size, count, ChunkElements, starts, sizes))
+			return false;
+
+		uint8_t* dst = static_cast<uint8_t*>(elements);
+		std::vector<size_t> chunkIds(starts.size());
+		std::iota(chunkIds.begin(), chunkIds.end(), 0);
+
+		std::atomic<bool> ok{ true };
+		std::for_each(std::execution::par, chunkIds.begin(), chunkIds.end(), [&](size_t chunkId)
+		{
+			const size_t first = chunkId * ChunkElements;
+			const size_t n = std::min(ChunkElements, count - first);
+			const size_t numBlocks = (n + BlockValues - 1) / BlockValues;
+
+			// widths and words of every component
+			const uint8_t* p = starts[chunkId];
+			const uint8_t* end = p + sizes[chunkId];
+			std::vector<const uint8_t*> widths(numComponents), words(numComponents);
+			for(size_t component=0; component<numComponents; ++component)
+			{
+				if(size_t(end - p) < numBlocks)
+				{
+					ok = false;
+					return;
+				}
+
+				widths[component] = p;
+				p += numBlocks;
+
+				size_t numWords = 0;
+				for(size_t b=0; b<numBlocks; ++b)
+					numWords += BlockWords(widths[component][b], BlockRows(b * BlockValues, n));
+
+				if(numWords / Lanes > 32 * numBlocks || size_t(end - p) / 4 < numWords)
+				{
+					ok = false;
+					return;
+				}
+
+				words[component] = p;
+				p += numWords * 4;
+			}
+
+			// a block of every component, then its elements are interleaved at once
+			std::vector<uint32_t> carry(numComponents * Lanes, 0);
+			std::vector<uint32_t> block(numComponents * BlockValues);
+			std::vector<uint32_t> interleaved(numComponents * BlockValues);
+			for(size_t b=0; b<numBlocks; ++b)
+			{
+				for(size_t component=0; component<numComponents; ++component)
+				{
+					const uint32_t width = widths[component][b];
+					if(width > 32)
+					{
+						ok = false;
+						return;
+					}
+
+					const size_t rows = BlockRows(b * BlockValues, n);
+					UnpackBlock(words[component], width, rows, carry.data() + component * Lanes, block.data() + component * BlockValues);
+					words[component] += BlockWords(width, rows) * 4;
+				}
+
+				const size_t blockCount = std::min(BlockValues, n - b * BlockValues);
+				for(size_t i=0; i<blockCount; ++i)
+				{
+					for(size_t component=0; component<numComponents; ++component)
+						interleaved[i * numComponents + component] = block[component * BlockValues + i];
+				}
+
+				memcpy(dst + (first + b * BlockValues) * numComponents * 4, interleaved.data(), blockCount * numComponents * 4);
+			}
+
+			if(p != end)
+				ok = false;
+		});
+
+		return ok;
+	}
+
+	// FIFO of the most recent entries, slot 0 is the newest.
+	template<typename T, size_t N>
+	struct Fifo
+	{
+		void Push(const T& value)
+		{
+			head = (head + 1) % N;
+			entries[head] = value;
+			size = std::min(size + 1, N);
+		}
+
+		const T& operator[](size_t slot) const { return entries[(head + N - slot) % N]; }
+
+		size_t Find(const T& value) const
+		{
+			for(size_t slot=0; slot<size; ++slot)
+			{
+				if((*this)[slot] == value)
+					return slot;
+			}
+
+			return N;
+		}
+
+		std::array<T, N> entries{};
+		size_t head{ 0 };
+		size_t size{ 0 };
+	};
+
+	struct IndexCoderState
+	{
+		Fifo<std::pair<uint32_t, uint32_t>, EdgeFifoSize> edges;
+		Fifo<uint32_t, VertexFifoSize> vertices;
+		uint32_t next{ 0 }; // one past the highest vertex so far
+		uint32_t last{ 0 }; // third vertex of the previous triangle
+
+		// 4 bit reference to the vertex, explicit ones append their delta to 'base'
+		uint8_t EncodeVertex(uint32_t v, uint32_t base, std::vector<uint8_t>& extra)
+		{
+			uint8_t ref = ExplicitVertex;
+			const size_t slot = vertices.Find(v);
+			if(v == next)
+				ref = NewVertex;
+			else if(slot < VertexFifoSize)
+				ref = uint8_t(1 + slot);
+			else
+				AppendVarint(extra, ZigZag(v - base));
+
+			next = std::max(next, v + 1);
+			return ref;
+		}
+
+		bool DecodeVertex(uint8_t ref, uint32_t base, const uint8_t*& p, const uint8_t* end, uint32_t& v)
+		{
+			uint32_t delta = 0;
+			if(ref == NewVertex)
+				v = next;
+			else if(ref != ExplicitVertex && ref - 1u < vertices.size)
+				v = vertices[ref - 1];
+			else if(ref == ExplicitVertex && ReadVarint(p, end, delta))
+				v = base + UnZigZag(delta);
+			else
+				return false;
+
+			next = std::max(next, v + 1);
+			return true;
+		}
+
+		void Emitted(uint32_t a, uint32_t b, uint32_t c)
+		{
+			// a neighbour runs the shared edge the other way
+			edges.Push({ b, a });
+			edges.Push({ c, b });
+			edges.Push({ a, c });
+
+			for(const uint32_t v: { a, b, c })
+			{
+				if(vertices.Find(v) == VertexFifoSize)
+					vertices.Push(v);
+			}
+
+			last = c;
+		}
+	};
+
+	/*
+	* Triangle list, 'count' a multiple of 3. Triangles keep their corners exactly: a triangle matched by a rotation of
+	* its corners stores the rotation. Chunk: uint8 codes[numTris], 2 bit rotations[numTris], extra bytes - the vertex
+	* references of unmatched triangles (byte: second << 4 | third) and the varint deltas.
+	*/
+	inline std::vector<uint8_t> EncodeIndices(const uint32_t* indices, size_t count)
+	{
+		const size_t numTris = count / 3;
+		std::vector<size_t> chunkIds((numTris + ChunkTriangles - 1) / ChunkTriangles);
+		std::iota(chunkIds.begin(), chunkIds.end(), 0);
+
+		std::vector<std::vector<uint8_t>> chunks(chunkIds.size());
+		std::transform(std::execution::par, chunkIds.begin(), chunkIds.end(), chunks.begin(), [&](size_t chunkId)
+		{
+			const size_t first = chunkId * ChunkTriangles;
+			const size_t n = std::min(ChunkTriangles, numTris - first);
+
+			std::vector<uint8_t> codes(n), rotations((n + 3) / 4, 0), extra, deltas;
+			IndexCoderState state;
+			for(size_t t=0; t<n; ++t)
+			{
+				const uint32_t* tri = indices + (first + t) * 3;
+
+				size_t rotation = 0, edgeSlot = EdgeFifoSize;
+				for(size_t r=0; r<3 && edgeSlot == EdgeFifoSize; ++r)
+				{
+					edgeSlot = state.edges.Find({ tri[r], tri[(r + 1) % 3] });
+					rotation = r;
+				}
+
+				if(edgeSlot == EdgeFifoSize)
+				{
+					codes[t] = uint8_t(NoEdge | state.EncodeVertex(tri[0], state.last, extra));
+
+					deltas.clear();
+					const uint8_t second = state.EncodeVertex(tri[1], tri[0], deltas);
+					const uint8_t third = state.EncodeVertex(tri[2], tri[0], deltas);
+					extra.emplace_back(uint8_t((second << 4) | third));
+					extra.insert(extra.end(), deltas.begin(), deltas.end());
+
+					state.Emitted(tri[0], tri[1], tri[2]);
+					continue;
+				}
+
+				const uint32_t a = tri[rotation], b = tri[(rotation + 1) % 3], c = tri[(rotation + 2) % 3];
+				codes[t] = uint8_t((edgeSlot << 4) | state.EncodeVertex(c, a, extra));
+				rotations[t / 4] |= uint8_t(rotation << ((t % 4) * 2));
+				state.Emitted(a, b, c);
+			}
+
+			codes.insert(codes.end(), rotations.begin(), rotations.end());
+			codes.insert(codes.end(), extra.begin(), extra.end());
+			return codes;
+		});
+
+		return Assemble(numTris * 3, chunks);
+	}
+
+	inline bool DecodeIndices(const uint8_t* data, size_t size, uint32_t* indices, size_t count)
+	{
+		std::vector<const uint8_t*> starts;
+		std::vector<size_t> sizes;
+		if(count % 3 != 0 || !ChunkTable(data, size, count, ChunkTriangles * 3, starts, sizes))
+			return false;
+
+		std::vector<size_t> chunkIds(starts.size());
+		std::iota(chunkIds.begin(), chunkIds.end(), 0);
+
+		std::atomic<bool> ok{ true };
+		std::for_each(std::execution::par, chunkIds.begin(), chunkIds.end(), [&](size_t chunkId)
+		{
+			const size_t first = chunkId * ChunkTriangles;
+			const size_t n = std::min(ChunkTriangles, count / 3 - first);
+			if(sizes[chunkId] < n + (n + 3) / 4)
+			{
+				ok = false;
+				return;
+			}
+
+			const uint8_t* codes = starts[chunkId];
+			const uint8_t* rotations = codes + n;
+			const uint8_t* p = rotations + (n + 3) / 4;
+			const uint8_t* end = starts[chunkId] + sizes[chunkId];
+
+			IndexCoderState state;
+			for(size_t t=0; t<n; ++t)
+			{
+				uint32_t* tri = indices + (first + t) * 3;
+				const uint8_t code = codes[t];
+				const size_t edgeSlot = code >> 4;
+				if(edgeSlot == NoEdge >> 4)
+				{
+					if(!state.DecodeVertex(code & 0xF, state.last, p, end, tri[0]) || p == end)
+					{
+						ok = false;
+						return;
+					}
+
+					const uint8_t refs = *p++;
+					if(!state.DecodeVertex(refs >> 4, tri[0], p, end, tri[1]) || !state.DecodeVertex(refs & 0xF, tri[0], p, end, tri[2]))
+					{
+						ok = false;
+						return;
+					}
+
+					state.Emitted(tri[0], tri[1], tri[2]);
+					continue;
+				}
+
+				const size_t rotation = (rotations[t / 4] >> ((t % 4) * 2)) & 3;
+				if(edgeSlot >= state.edges.size || rotation > 2)
+				{
+					ok = false;
+					return;
+				}
+
+				const auto [a, b] = state.edges[edgeSlot];
+				uint32_t c = 0;
+				if(!state.DecodeVertex(code & 0xF, a, p, end, c))
+				{
+					ok = false;
+					return;
+				}
+
+				tri[rotation] = a;
+				tri[(rotation + 1) % 3] = b;
+				tri[(rotation + 2) % 3] = c;
+				state.Emitted(a, b, c);
+			}
+
+			if(p != end)
+				ok = false;
+		});
+
+		return ok;
+	}
+}
+
+/*
+* Streaming container written by the export modes (little-endian, no padding between records):
+*	ContainerHeader
+*	ContainerObject[numObjects]
+*	numMeshes x { ContainerMesh, Float3 positions[numVerts], uint32_t indices[numIndices], Float2 lightmapUvs[numLightmapUvs] }
+* An array whose flag is set (MeshPositionsEncoded, MeshIndicesEncoded, MeshLightmapUvsEncoded) is stored as a codec
+* stream instead, after its uint32 size in bytes; arrays the codec doesn't make smaller stay raw.
+* A cell container references meshes shared with other cells through the common package (meshRef < -1).
+*/
+namespace container
+{
+	inline const char MagicCell[4] = { 'B', 'X', 'C', 'L' };
+	inline const char MagicShared[4] = { 'B', 'X', 'S', 'H' };
+	inline constexpr uint32_t Version = 3; // 2: lightmap UVs, 3: mesh flags
+	inline constexpr int32_t NoMesh = -1;
+	inline constexpr uint32_t MeshPositionsEncoded = 1;
+	inline constexpr uint32_t MeshIndicesEncoded = 2;
+	inline constexpr uint32_t MeshLightmapUvsEncoded = 4;
+
+	struct ContainerHeader
+	{
+		char magic[4];
+		uint32_t version;
+		int32_t cellX;
+		int32_t cellY;
+		uint32_t numObjects;
+		uint32_t numMeshes;
+	};
+
+	struct ContainerObject
+	{
+		char name[64];
+		blender::Float4x4 world;
+		int32_t meshRef; // >= 0 mesh of this container, -1 none, <= -2 mesh -(meshRef + 2) of the common package
+	};
+
+	struct ContainerMesh
+	{
+		char name[64];
+		uint32_t numVerts;
+		uint32_t numIndices;
+		uint32_t numLightmapUvs; // 0 or numIndices, one per triangle corner
+		uint32_t flags;
+	};
+
+	inline constexpr int32_t SharedMeshRef(size_t sharedIndex) { return -int32_t(sharedIndex) - 2; }
+
+	struct MeshData
+	{
+		std::string name;
+		std::vector<blender::Float3> positions;
+		std::vector<uint32_t> indices;
+		std::vector<blender::Float2> lightmapUvs;
+	};
+
+	struct ObjectData
+	{
+		std::string name;
+		blender::Float4x4 world;
+		int32_t meshRef;
+	};
+
+	inline void CopyName(char (&dst)[64], std::string_view src)
+	{
+		memset(dst, 0, sizeof(dst));
+		memcpy(dst, src.data(), std::min(src.size(), sizeof(dst) - 1));
+	}
+
+	inline bool WriteStream(FILE* f, const std::vector<uint8_t>& stream)
+	{
+		const uint32_t size = uint32_t(stream.size());
+		return fwrite(&size, sizeof(size), 1, f) == 1 && fwrite(stream.data(), 1, stream.size(), f) == stream.size();
+	}
+
+	// Array of a mesh as it's written: the codec stream when it's smaller than the raw bytes, otherwise raw.
+	struct MeshArray
+	{
+		const void* raw;
+		size_t rawSize;
+		std::vector<uint8_t> stream;
+		uint32_t flag;
+
+		bool Encoded() const { return !stream.empty(); }
+	};
+
+	inline MeshArray ChooseEncoding(const void* raw, size_t rawSize, std::vector<uint8_t> stream, uint32_t flag)
+	{
+		if(stream.size() + sizeof(uint32_t) >= rawSize)
+			stream.clear();
+
+		return MeshArray{ raw, rawSize, std::move(stream), flag };
+	}
+
+	inline std::array<MeshArray, 3> MeshArrays(const MeshData& mesh, bool encode)
+	{
+		const size_t positionsSize = mesh.positions.size() * sizeof(blender::Float3);
+		const size_t indicesSize = mesh.indices.size() * sizeof(uint32_t);
+		const size_t uvsSize = mesh.lightmapUvs.size() * sizeof(blender::Float2);
+		if(!encode)
+			return { MeshArray{ mesh.positions.data(), positionsSize, {}, 0 }, MeshArray{ mesh.indices.data(), indicesSize, {}, 0 }, MeshArray{ mesh.lightmapUvs.data(), uvsSize, {}, 0 } };
+
+		return
+		{
+			ChooseEncoding(mesh.positions.data(), positionsSize, codec::EncodeAttributes(mesh.positions.data(), mesh.positions.size(), 3), MeshPositionsEncoded),
+			ChooseEncoding(mesh.indices.data(), indicesSize, codec::EncodeIndices(mesh.indices.data(), mesh.indices.size()), MeshIndicesEncoded),
+			ChooseEncoding(mesh.lightmapUvs.data(), uvsSize, codec::EncodeAttributes(mesh.lightmapUvs.data(), mesh.lightmapUvs.size(), 2), MeshLightmapUvsEncoded)
+		};
+	}
+
+	inline bool Write(const std::filesystem::path& path, const char (&magic)[4], int32_t cellX, int32_t cellY,
+					  const std::vector<ObjectData>& objects, const std::vector<const MeshData*>& meshes, bool encode = false)
+	{
+		FILE* f = OpenFile(path, "wb");
+		if(f == nullptr)
+			return false;
+
+		ContainerHeader header{};
+		memcpy(header.magic, magic, 4);
+		header.version = Version;
+		header.cellX = cellX;
+		header.cellY = cellY;
+		header.numObjects = uint32_t(objects.size());
+		header.numMeshes = uint32_t(meshes.size());
+
+		bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+
+		for(const ObjectData& object: objects)
+		{
+			ContainerObject record{};
+			CopyName(record.name, object.name);
+			record.world = object.world;
+			record.meshRef = object.meshRef;
+			ok = ok && fwrite(&record, sizeof(record), 1, f) == 1;
+		}
+
+		for(const MeshData* mesh: meshes)
+		{
+			ContainerMesh record{};
+			CopyName(record.name, mesh->name);
+			record.numVerts = uint32_t(mesh->positions.size());
+			record.numIndices = uint32_t(mesh->indices.size());
+			record.numLightmapUvs = uint32_t(mesh->lightmapUvs.size());
+
+			const auto arrays = MeshArrays(*mesh, encode);
+			for(const MeshArray& array: arrays)
+				record.flags |= (array.Encoded() ? array.flag : 0);
+
+			ok = ok && fwrite(&record, sizeof(record), 1, f) == 1;
+			for(const MeshArray& array: arrays)
+				ok = ok && (array.Encoded() ? WriteStream(f, array.stream) : fwrite(array.raw, 1, array.rawSize, f) == array.rawSize);
+		}
+
+		fclose(f);
+		return ok;
+	}
+
+	/*
+	* Convex hull set: header, then per hull a record, its Float3 vertices and its triangle indices - uint8 for hulls up
+	* to 256 vertices, uint16 above - padded to 4 bytes.
+	*/
+	inline const char MagicHulls[4] = { 'B', 'X', 'H', 'L' };
+	inline constexpr uint32_t HullVersion = 5; // 5: 32 bit counts, hull sets written with the container Version before
+	inline constexpr uint32_t HullProxy = 1; // authored UCX_ proxy, otherwise generated from the object's mesh
+
+	struct HullSetHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t numHulls;
+	};
+
+	struct HullRecord
+	{
+		char name[64];		// object the hull was built from
+		char target[64];	// object the hull collides for, in its local space
+		uint32_t numVerts;
+		uint32_t numTris;	// up to 2 * numVerts - 4
+		uint32_t flags;
+	};
+
+	struct HullData
+	{
+		std::string name;
+		std::string target;
+		uint32_t flags;
+		ConvexHull hull;
+	};
+
+	inline bool WriteHulls(const std::filesystem::path& path, const std::vector<HullData>& hulls)
+	{
+		FILE* f = OpenFile(path, "wb");
+		if(f == nullptr)
+			return false;
+
+		HullSetHeader header{};
+		memcpy(header.magic, MagicHulls, 4);
+		header.version = HullVersion;
+		header.numHulls = uint32_t(hulls.size());
+
+		bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+
+		std::vector<uint8_t> packed;
+		for(const HullData& data: hulls)
+		{
+			const ConvexHull& hull = data.hull;
+
+			HullRecord record{};
+			CopyName(record.name, data.name);
+			CopyName(record.target, data.target);
+			record.numVerts = uint32_t(hull.vertices.size());
+			record.numTris = uint32_t(hull.indices.size() / 3);
+			record.flags = data.flags;
+			ok = ok && fwrite(&record, sizeof(record), 1, f) == 1;
+			ok = ok && fwrite(hull.vertices.data(), sizeof(blender::Float3), hull.vertices.size(), f) == hull.vertices.size();
+
+			const size_t indexSize = (hull.vertices.size() <= 256 ? 1 : 2);
+			packed.assign((hull.indices.size() * indexSize + 3) & ~size_t(3), 0);
+			for(size_t i=0; i<hull.indices.size(); ++i)
+			{
+				if(indexSize == 1)
+					packed[i] = uint8_t(hull.indices[i]);
+				else
+				{
+					const uint16_t index = uint16_t(hull.indices[i]);
+					memcpy(&packed[i * 2], &index, 2);
+				}
+			}
+
+			ok = ok && fwrite(packed.data(), 1, packed.size(), f) == packed.size();
+		}
+
+		fclose(f);
+		return ok;
+	}
+
+	// IEEE half, rounded to nearest even, overflow to infinity.
+	inline uint16_t FloatToHalf(float value)
+	{
+		const uint32_t bits = std::bit_cast<uint32_t>(value);
+		const uint16_t sign = uint16_t((bits >> 16) & 0x8000);
+		const uint32_t exponent = (bits >> 23) & 0xFF;
+		uint32_t mantissa = bits & 0x7FFFFF;
+
+		if(exponent == 0xFF)
+			return uint16_t(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0));
+
+		const int32_t e = int32_t(exponent) - 127 + 15;
+		if(e >= 31)
+			return uint16_t(sign | 0x7C00);
+
+		if(e <= 0)
+		{
+			if(e < -10)
+				return sign;
+
+			mantissa |= 0x800000;
+			const uint32_t shift = uint32_t(14 - e);
+			const uint32_t half = mantissa >> shift;
+			const uint32_t rest = mantissa & ((1u << shift) - 1);
+			const uint32_t midpoint = 1u << (shift - 1);
+			return uint16_t(sign | (half + (rest > midpoint || (rest == midpoint && (half & 1)) ? 1 : 0)));
+		}
+
+		uint32_t half = (uint32_t(e) << 10) | (mantissa >> 13);
+		const uint32_t rest = mantissa & 0x1FFF;
+		if(rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+			++half; // a carry into the exponent is still the correctly rounded value
+		return uint16_t(sign | half);
+	}
+
+	/*
+	* Vertex animation textures: header, position texels, normal texels, then Float2 uvRemap[numVerts] - the texel
+	* centre of each vertex in frame 0, frame f is f * rowsPerFrame rows below. The textures are width x
+	* (numFrames * rowsPerFrame), rows top to bottom. Positions are offsets from the rest position of the mesh.
+	*	Rgba16F: half x, y, z, 1.
+	*	Rgba8Rgbm: the offset remapped to [0, 1] by offsetMin/offsetMax, rgb / m and m in alpha.
+	*	Rgba8: normals as n * 0.5 + 0.5.
+	*/
+	inline const char MagicVat[4] = { 'B', 'X', 'V', 'A' };
+
+	enum class TexelFormat: uint32_t
+	{
+		Rgba16F,
+		Rgba8Rgbm,
+		Rgba8,
+		Rgba32F
+	};
+
+	struct VatHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t numVerts;
+		uint32_t numFrames;
+		uint32_t width;
+		uint32_t rowsPerFrame;
+		TexelFormat positionFormat;
+		TexelFormat normalFormat;
+		float frameStart;
+		float frameStep;
+		blender::Float3 offsetMin;
+		blender::Float3 offsetMax;
+	};
+
+	struct VatData
+	{
+		uint32_t numVerts{ 0 };
+		uint32_t numFrames{ 0 };
+		uint32_t width{ 0 };
+		float frameStart{ 0.0f };
+		float frameStep{ 1.0f };
+		std::vector<blender::Float3> offsets;	// [frame * numVerts + vertex]
+		std::vector<blender::Float3> normals;	// [frame * numVerts + vertex]
+	};
+
+	inline bool WriteVat(const std::filesystem::path& path, const VatData& vat, bool rgbm)
+	{
+		if(vat.numVerts == 0 || vat.width == 0 || vat.offsets.size() != size_t(vat.numVerts) * vat.numFrames || vat.normals.size() != vat.offsets.size())
+			return false;
+
+		FILE* f = OpenFile(path, "wb");
+		if(f == nullptr)
+			return false;
+
+		VatHeader header{};
+		memcpy(header.magic, MagicVat, 4);
+		header.version = Version;
+		header.numVerts = vat.numVerts;
+		header.numFrames = vat.numFrames;
+		header.width = vat.width;
+		header.rowsPerFrame = (vat.numVerts + vat.width - 1) / vat.width;
+		header.positionFormat = (rgbm ? TexelFormat::Rgba8Rgbm : TexelFormat::Rgba16F);
+		header.normalFormat = (rgbm ? TexelFormat::Rgba8 : TexelFormat::Rgba16F);
+		header.frameStart = vat.frameStart;
+		header.frameStep = vat.frameStep;
+
+		constexpr float Max = std::numeric_limits<float>::max();
+		header.offsetMin = blender::Float3{ Max, Max, Max };
+		header.offsetMax = blender::Float3{ -Max, -Max, -Max };
+		for(const blender::Float3& o: vat.offsets)
+		{
+			header.offsetMin = blender::Float3{ std::min(header.offsetMin.x, o.x), std::min(header.offsetMin.y, o.y), std::min(header.offsetMin.z, o.z) };
+			header.offsetMax = blender::Float3{ std::max(header.offsetMax.x, o.x), std::max(header.offsetMax.y, o.y), std::max(header.offsetMax.z, o.z) };
+		}
+
+		const size_t texelSize = (rgbm ? 4 : 8);
+		const size_t frameTexels = size_t(header.rowsPerFrame) * vat.width;
+		std::vector<uint8_t> positions(frameTexels * vat.numFrames * texelSize, 0);
+		std::vector<uint8_t> normals(positions.size(), 0);
+
+		const float range[3] = { std::max(header.offsetMax.x - header.offsetMin.x, 1e-20f), std::max(header.offsetMax.y - header.offsetMin.y, 1e-20f),
+								 std::max(header.offsetMax.z - header.offsetMin.z, 1e-20f) };
+		const auto Unorm8 = [](float v) { return uint8_t(std::lround(std::clamp(v, 0.0f, 1.0f) * 255.0f)); };
+
+		std::vector<uint32_t> frames(vat.numFrames);
+		std::iota(frames.begin(), frames.end(), 0);
+		std::for_each(std::execution::par, frames.begin(), frames.end(), [&](uint32_t frame)
+		{
+			for(uint32_t v=0; v<vat.numVerts; ++v)
+			{
+				const size_t element = size_t(frame) * vat.numVerts + v;
+				const size_t texel = (frame * frameTexels + v) * texelSize;
+				const blender::Float3& o = vat.offsets[element];
+				const blender::Float3& n = vat.normals[element];
+
+				if(!rgbm)
+				{
+					const uint16_t p[4] = { FloatToHalf(o.x), FloatToHalf(o.y), FloatToHalf(o.z), FloatToHalf(1.0f) };
+					const uint16_t q[4] = { FloatToHalf(n.x), FloatToHalf(n.y), FloatToHalf(n.z), FloatToHalf(1.0f) };
+					memcpy(&positions[texel], p, sizeof(p));
+					memcpy(&normals[texel], q, sizeof(q));
+					continue;
+				}
+
+				const float c[3] = { (o.x - header.offsetMin.x) / range[0], (o.y - header.offsetMin.y) / range[1], (o.z - header.offsetMin.z) / range[2] };
+				const float m = std::max(std::ceil(std::max({ c[0], c[1], c[2], 1e-6f }) * 255.0f), 1.0f) / 255.0f;
+				positions[texel] = Unorm8(c[0] / m);
+				positions[texel + 1] = Unorm8(c[1] / m);
+				positions[texel + 2] = Unorm8(c[2] / m);
+				positions[texel + 3] = Unorm8(m);
+
+				normals[texel] = Unorm8(n.x * 0.5f + 0.5f);
+				normals[texel + 1] = Unorm8(n.y * 0.5f + 0.5f);
+				normals[texel + 2] = Unorm8(n.z * 0.5f + 0.5f);
+				normals[texel + 3] = 255;
+			}
+		});
+
+		std::vector<blender::Float2> uvRemap(vat.numVerts);
+		const float height = float(size_t(header.rowsPerFrame) * vat.numFrames);
+		for(uint32_t v=0; v<vat.numVerts; ++v)
+			uvRemap[v] = blender::Float2{ (float(v % vat.width) + 0.5f) / float(vat.width), (float(v / vat.width) + 0.5f) / height };
+
+		bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+		ok = ok && fwrite(positions.data(), 1, positions.size(), f) == positions.size();
+		ok = ok && fwrite(normals.data(), 1, normals.size(), f) == normals.size();
+		ok = ok && fwrite(uvRemap.data(), sizeof(blender::Float2), uvRemap.size(), f) == uvRemap.size();
+
+		fclose(f);
+		return ok;
+	}
+
+	/*
+	* Bone matrix atlas for instanced skinning: header, BoneRecord[numBones], BoneClipRecord[numClips], then the texels.
+	* A frame is the 3x4 skinning matrices of all bones - 3 texels per bone, the rows of the matrix - laid out over
+	* rowsPerFrame rows of the atlas. The frames of a clip are consecutive, clips follow each other from firstRow.
+	* BoneAtlasRootMotion: the root motion of every clip follows, anim::RootMotionFrame[numFrames] per clip.
+	*/
+	inline const char MagicBoneAtlas[4] = { 'B', 'X', 'B', 'A' };
+	inline constexpr uint32_t BoneAtlasVersion = 4; // 4: flags, atlases written with the container Version before
+	inline constexpr uint32_t BoneAtlasRootMotion = 1; // root motion extracted from the root bone
+
+	struct BoneAtlasHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t numBones;
+		uint32_t numClips;
+		uint32_t width;
+		uint32_t height;
+		uint32_t rowsPerFrame;
+		TexelFormat format;	// Rgba16F or Rgba32F
+		uint32_t flags;
+	};
+
+	struct BoneRecord
+	{
+		char name[64];
+		int32_t parent; // parents come first
+	};
+
+	struct BoneClipRecord
+	{
+		char name[64];
+		uint32_t firstRow;
+		uint32_t numFrames;
+		float frameStart;
+		float frameStep;
+	};
+
+	struct BoneClipData
+	{
+		std::string name;
+		float frameStart{ 0.0f };
+		float frameStep{ 1.0f };
+		uint32_t numFrames{ 0 };
+		std::vector<blender::Float4x4> skin; // [frame * numBones + bone]
+		std::vector<anim::RootMotionFrame> rootMotion; // numFrames or empty
+	};
+
+	struct BoneAtlasData
+	{
+		std::vector<std::string> boneNames;
+		std::vector<int32_t> boneParents;
+		uint32_t width{ 0 };
+		std::vector<BoneClipData> clips;
+	};
+
+	inline bool WriteBoneAtlas(const std::filesystem::path& path, const BoneAtlasData& atlas, bool half)
+	{
+		const size_t numBones = atlas.boneNames.size();
+		if(numBones == 0 || atlas.width == 0 || atlas.boneParents.size() != numBones)
+			return false;
+
+		const bool rootMotion = !atlas.clips.empty() && !atlas.clips.front().rootMotion.empty();
+		for(const BoneClipData& clip: atlas.clips)
+		{
+			if(clip.skin.size() != size_t(clip.numFrames) * numBones || clip.rootMotion.size() != (rootMotion ? clip.numFrames : 0))
+				return false;
+		}
+
+		FILE* f = OpenFile(path, "wb");
+		if(f == nullptr)
+			return false;
+
+		BoneAtlasHeader header{};
+		memcpy(header.magic, MagicBoneAtlas, 4);
+		header.version = BoneAtlasVersion;
+		header.numBones = uint32_t(numBones);
+		header.numClips = uint32_t(atlas.clips.size());
+		header.width = atlas.width;
+		header.rowsPerFrame = uint32_t((numBones * 3 + atlas.width - 1) / atlas.width);
+		header.format = (half ? TexelFormat::Rgba16F : TexelFormat::Rgba32F);
+		header.flags = (rootMotion ? BoneAtlasRootMotion : 0);
+
+		std::vector<BoneClipRecord> clipRecords(atlas.clips.size());
+		for(size_t c=0; c<atlas.clips.size(); ++c)
+		{
+			CopyName(clipRecords[c].name, atlas.clips[c].name);
+			clipRecords[c].firstRow = header.height;
+			clipRecords[c].numFrames = atlas.clips[c].numFrames;
+			clipRecords[c].frameStart = atlas.clips[c].frameStart;
+			clipRecords[c].frameStep = atlas.clips[c].frameStep;
+			header.height += atlas.clips[c].numFrames * header.rowsPerFrame;
+		}
+
+		std::vector<BoneRecord> boneRecords(numBones);
+		for(size_t b=0; b<numBones; ++b)
+		{
+			CopyName(boneRecords[b].name, atlas.boneNames[b]);
+			boneRecords[b].parent = atlas.boneParents[b];
+		}
+
+		const size_t texelSize = (half ? 8 : 16);
+		const size_t frameTexels = size_t(header.rowsPerFrame) * atlas.width;
+		std::vector<uint8_t> texels(size_t(header.height) * atlas.width * texelSize, 0);
+		for(size_t c=0; c<atlas.clips.size(); ++c)
+		{
+			const BoneClipData& clip = atlas.clips[c];
+			uint8_t* const clipTexels = texels.data() + size_t(clipRecords[c].firstRow) * atlas.width * texelSize;
+
+			std::vector<uint32_t> frames(clip.numFrames);
+			std::iota(frames.begin(), frames.end(), 0);
+			std::for_each(std::execution::par_unseq, frames.begin(), frames.end(), [&](uint32_t frame)
+			{
+				for(size_t b=0; b<numBones; ++b)
+				{
+					const blender::Float4x4& m = clip.skin[frame * numBones + b];
+					for(int row=0; row<3; ++row)
+					{
+						const float values[4] = { m.m[0][row], m.m[1][row], m.m[2][row], m.m[3][row] };
+						uint8_t* const texel = clipTexels + (frame * frameTexels + b * 3 + row) * texelSize;
+						if(!half)
+						{
+							memcpy(texel, values, sizeof(values));
+							continue;
+						}
+
+						const uint16_t halves[4] = { FloatToHalf(values[0]), FloatToHalf(values[1]), FloatToHalf(values[2]), FloatToHalf(values[3]) };
+						memcpy(texel, halves, sizeof(halves));
+					}
+				}
+			});
+		}
+
+		bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+		ok = ok && fwrite(boneRecords.data(), sizeof(BoneRecord), boneRecords.size(), f) == boneRecords.size();
+		ok = ok && fwrite(clipRecords.data(), sizeof(BoneClipRecord), clipRecords.size(), f) == clipRecords.size();
+		ok = ok && fwrite(texels.data(), 1, texels.size(), f) == texels.size();
+		for(const BoneClipData& clip: atlas.clips)
+			ok = ok && fwrite(clip.rootMotion.data(), sizeof(anim::RootMotionFrame), clip.rootMotion.size(), f) == clip.rootMotion.size();
+
+		fclose(f);
+		return ok;
+	}
+}
+
+/*
+* Zero-copy handoff of extraction results to another process. The producer allocates the outputs straight into a shared
+* memory arena (memfd on Linux, shm_open elsewhere on POSIX, a pagefile backed file mapping on Windows), describes them in
+* the descriptor table at the start of the arena and publishes the entry through a ring in the arena header. The consumer
+* maps the same arena and reads the data in place. Waking the consumer: one byte over a Unix socket, which also carries the
+* arena's file descriptor (SCM_RIGHTS) on connect; a named event on Windows, where the arena is opened by name.
+*/
+namespace shm
+{
+	inline const char Magic[4] = { 'B', 'X', 'S', 'M' };
+	inline constexpr uint32_t Version = 2;
+	inline constexpr uint32_t MaxEntries = 4096;
+	inline constexpr uint32_t RingSize = 1024; // power of 2
+	inline constexpr uint64_t DataAlignment = 64;
+
+	enum class EntryKind: uint32_t
+	{
+		Positions,	// Float3[count]
+		Indices,	// uint32_t[count], 3 per triangle
+		BatchQueue,	// batch::QueueHeader + batch::FileSlot[count]
+	};
+
+	struct Entry
+	{
+		char name[64];
+		EntryKind kind;
+		uint32_t count;
+		uint64_t offset;	// from the start of the arena
+		uint64_t size;		// bytes
+	};
+
+	static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free, "atomics in shared memory have to be lock free");
+
+	struct ArenaHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t capacity;
+		std::atomic<uint64_t> allocated;	// bump allocator, bytes from the start of the arena
+		std::atomic<uint32_t> numEntries;	// entries added so far, entry n lives in slot n % MaxEntries
+		std::atomic<uint32_t> releasedEntries;	// entries the consumer is done with, their slots are reused
+		std::atomic<uint32_t> ringHead;		// advanced by the producer
+		std::atomic<uint32_t> ringTail;		// advanced by the consumer
+		std::atomic<uint32_t> closed;		// producer is done
+		uint32_t ring[RingSize];			// published entry indices
+		Entry entries[MaxEntries];
+	};
+
+	class sharedArena
+	{
+		public:
+			sharedArena() = default;
+			sharedArena(const sharedArena&) = delete;
+			sharedArena& operator=(const sharedArena&) = delete;
+
+			~sharedArena()
+			{
+				Close();
+			}
+
+			// Producer side. 'name' only matters on Windows, where the consumer opens the mapping by it.
+			bool Create(size_t capacity, const std::string& name)
+			{
+				Close();
+				capacity = std::max(capacity, sizeof(ArenaHeader) + size_t(DataAlignment));
+
+#if defined(_WIN32)
+				m_mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, DWORD(uint64_t(capacity) >> 32), DWORD(capacity & 0xFFFFFFFF), name.c_str());
+				if(m_mapping == nullptr)
+					return false;
+
+				m_base = static_cast<uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, capacity));
+#else
+#if defined(__linux__)
+				m_fd = memfd_create(name.c_str(), MFD_CLOEXEC);
+#else
+				const std::string shmName = "/" + name;
+				m_fd = shm_open(shmName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+				shm_unlink(shmName.c_str()); // lives on through the descriptors only
+#endif
+				if(m_fd < 0 || ftruncate(m_fd, off_t(capacity)) != 0)
+					return false;
+
+				void* base = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+				m_base = (base == MAP_FAILED ? nullptr : static_cast<uint8_t*>(base));
+#endif
+				if(m_base == nullptr)
+					return false;
+
+				m_capacity = capacity;
+
+				ArenaHeader* header = new(m_base) ArenaHeader{};
+				memcpy(header->magic, Magic, 4);
+				header->version = Version;
+				header->capacity = capacity;
+				header->allocated = AlignUp(sizeof(ArenaHeader));
+				return true;
+			}
+
+			// Consumer side.
+#if defined(_WIN32)
+			bool Open(const std::string& name)
+			{
+				Close();
+				m_mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+				if(m_mapping == nullptr)
+					return false;
+
+				m_base = static_cast<uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+				if(m_base == nullptr)
+					return false;
+
+				MEMORY_BASIC_INFORMATION info{};
+				VirtualQuery(m_base, &info, sizeof(info));
+				m_capacity = info.RegionSize;
+				return CheckHeader();
+			}
+#else
+			bool Open(int fd)
+			{
+				Close();
+
+				struct stat st{};
+				if(fd < 0 || fstat(fd, &st) != 0)
+					return false;
+
+				m_fd = fd;
+				void* base = mmap(nullptr, size_t(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				if(base == MAP_FAILED)
+					return false;
+
+				m_base = static_cast<uint8_t*>(base);
+				m_capacity = size_t(st.st_size);
+				return CheckHeader();
+			}
+
+			int Descriptor() const { return m_fd; }
+#endif
+
+			void Close()
+			{
+#if defined(_WIN32)
+				if(m_base != nullptr)
+					UnmapViewOfFile(m_base);
+				if(m_mapping != nullptr)
+					CloseHandle(m_mapping);
+				m_mapping = nullptr;
+#else
+				if(m_base != nullptr)
+					munmap(m_base, m_capacity);
+				if(m_fd >= 0)
+					close(m_fd);
+				m_fd = -1;
+#endif
+				m_base = nullptr;
+				m_capacity = 0;
+			}
+
+			ArenaHeader* Header() const { return reinterpret_cast<ArenaHeader*>(m_base); }
+			uint8_t* At(uint64_t offset) const { return m_base + offset; }
+
+			// Thread safe bump allocation, nullptr when the arena is full.
+			template<typename T>
+			T* Allocate(size_t count, uint64_t& offset)
+			{
+				const uint64_t bytes = AlignUp(count * sizeof(T));
+				offset = Header()->allocated.fetch_add(bytes);
+				if(offset + bytes > m_capacity)
+					return nullptr;
+
+				return reinterpret_cast<T*>(m_base + offset);
+			}
+
+			// Thread safe, returns the entry slot or MaxEntries when every slot holds an entry the consumer hasn't released yet.
+			uint32_t AddEntry(std::string_view name, EntryKind kind, uint32_t count, uint64_t offset, uint64_t size)
+			{
+				ArenaHeader* header = Header();
+				uint32_t index = header->numEntries.load(std::memory_order_relaxed);
+				do
+				{
+					if(index - header->releasedEntries.load(std::memory_order_acquire) >= MaxEntries)
+						return MaxEntries;
+				}
+				while(!header->numEntries.compare_exchange_weak(index, index + 1));
+
+				const uint32_t slot = index % MaxEntries;
+				Entry& entry = header->entries[slot];
+				memset(entry.name, 0, sizeof(entry.name));
+				memcpy(entry.name, name.data(), std::min(name.size(), sizeof(entry.name) - 1));
+				entry.kind = kind;
+				entry.count = count;
+				entry.offset = offset;
+				entry.size = size;
+				return slot;
+			}
+
+			// Single producer: room for 'n' more entries in the table and in the ring.
+			bool CanPublish(uint32_t n) const
+			{
+				const ArenaHeader* header = Header();
+				return header->numEntries.load(std::memory_order_relaxed) - header->releasedEntries.load(std::memory_order_acquire) + n <= MaxEntries &&
+					   header->ringHead.load(std::memory_order_relaxed) - header->ringTail.load(std::memory_order_acquire) + n <= RingSize;
+			}
+
+			// Single producer: false when the consumer is a whole ring behind.
+			bool Publish(uint32_t entryIndex)
+			{
+				ArenaHeader* header = Header();
+				const uint32_t head = header->ringHead.load(std::memory_order_relaxed);
+				if(head - header->ringTail.load(std::memory_order_acquire) >= RingSize)
+					return false;
+
+				header->ring[head & (RingSize - 1)] = entryIndex;
+				header->ringHead.store(head + 1, std::memory_order_release); // entry and its data are visible before the index
+				return true;
+			}
+
+			// Single consumer.
+			std::optional<uint32_t> NextPublished()
+			{
+				ArenaHeader* header = Header();
+				const uint32_t tail = header->ringTail.load(std::memory_order_relaxed);
+				if(tail == header->ringHead.load(std::memory_order_acquire))
+					return {};
+
+				const uint32_t entryIndex = header->ring[tail & (RingSize - 1)];
+				header->ringTail.store(tail + 1, std::memory_order_release);
+				return entryIndex;
+			}
+
+			// Single consumer: done with the oldest published entry, its slot can take a new one. The data stays in the arena.
+			void ReleaseEntry()
+			{
+				Header()->releasedEntries.fetch_add(1, std::memory_order_release);
+			}
+
+		private:
+			static uint64_t AlignUp(uint64_t bytes) { return (bytes + DataAlignment - 1) & ~(DataAlignment - 1); }
+
+			bool CheckHeader() const
+			{
+				return m_capacity >= sizeof(ArenaHeader) && memcmp(Header()->magic, Magic, 4) == 0 && Header()->version == Version;
+			}
+
+			uint8_t* m_base{ nullptr };
+			size_t m_capacity{ 0 };
+#if defined(_WIN32)
+			HANDLE m_mapping{ nullptr };
+#else
+			int m_fd{ -1 };
+#endif
+	};
+
+	/*
+	* Notification side channel: Ring() after publishing, Wait() on the consumer side.
+	* POSIX: Unix stream socket at 'name' (a path), the producer sends the arena descriptor to the consumer on Accept().
+	* Windows: auto-reset event 'name'.
+	*/
+	class doorbell
+	{
+		public:
+			doorbell() = default;
+			doorbell(const doorbell&) = delete;
+			doorbell& operator=(const doorbell&) = delete;
+
+			~doorbell()
+			{
+#if defined(_WIN32)
+				if(m_event != nullptr)
+					CloseHandle(m_event);
+#else
+				if(m_peer >= 0)
+					close(m_peer);
+				if(m_listen >= 0)
+				{
+					close(m_listen);
+					unlink(m_path.c_str());
+				}
+#endif
+			}
+
+#if defined(_WIN32)
+			bool Create(const std::string& name)
+			{
+				m_event = CreateEventA(nullptr, FALSE, FALSE, name.c_str());
+				return m_event != nullptr;
+			}
+
+			bool Connect(const std::string& name)
+			{
+				m_event = OpenEventA(EVENT_MODIFY_STATE | SYNCHRONIZE, FALSE, name.c_str());
+				return m_event != nullptr;
+			}
+
+			bool Ring() { return SetEvent(m_event) != FALSE; }
+			bool Wait() { return WaitForSingleObject(m_event, INFINITE) == WAIT_OBJECT_0; }
+#else
+			// Producer: listens at 'path', blocks until the consumer connects, then hands over 'arenaFd'.
+			bool Accept(const std::string& path, int arenaFd)
+			{
+				sockaddr_un addr{};
+				if(path.size() >= sizeof(addr.sun_path))
+					return false;
+
+				addr.sun_family = AF_UNIX;
+				memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+				unlink(path.c_str());
+
+				m_listen = socket(AF_UNIX, SOCK_STREAM, 0);
+				m_path = path;
+				if(m_listen < 0 || bind(m_listen, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(m_listen, 1) != 0)
+					return false;
+
+				m_peer = accept(m_listen, nullptr, nullptr);
+				return m_peer >= 0 && SendDescriptor(arenaFd);
+			}
+
+			// Consumer: connects to 'path' and receives the arena descriptor.
+			int Connect(const std::string& path)
+			{
+				sockaddr_un addr{};
+				if(path.size() >= sizeof(addr.sun_path))
+					return -1;
+
+				addr.sun_family = AF_UNIX;
+				memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+				m_peer = socket(AF_UNIX, SOCK_STREAM, 0);
+				if(m_peer >= 0 && connect(m_peer, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+				{
+					close(m_peer); // can be retried
+					m_peer = -1;
+				}
+
+				if(m_peer < 0)
+					return -1;
+
+				return ReceiveDescriptor();
+			}
+
+			bool Ring()
+			{
+				const uint8_t bell = 1;
+				return send(m_peer, &bell, 1, MSG_NOSIGNAL) == 1;
+			}
+
+			// false once the producer hung up
+			bool Wait()
+			{
+				uint8_t bells[64];
+				return recv(m_peer, bells, sizeof(bells), 0) > 0;
+			}
+
+		private:
+			bool SendDescriptor(int fd)
+			{
+				uint8_t payload = 0;
+				iovec iov{ &payload, 1 };
+				alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+
+				msghdr msg{};
+				msg.msg_iov = &iov;
+				msg.msg_iovlen = 1;
+				msg.msg_control = control;
+				msg.msg_controllen = sizeof(control);
+
+				cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+				cmsg->cmsg_level = SOL_SOCKET;
+				cmsg->cmsg_type = SCM_RIGHTS;
+				cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+				memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+				return sendmsg(m_peer, &msg, MSG_NOSIGNAL) == 1;
+			}
+
+			int ReceiveDescriptor()
+			{
+				uint8_t payload = 0;
+				iovec iov{ &payload, 1 };
+				alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+
+				msghdr msg{};
+				msg.msg_iov = &iov;
+				msg.msg_iovlen = 1;
+				msg.msg_control = control;
+				msg.msg_controllen = sizeof(control);
+
+				if(recvmsg(m_peer, &msg, 0) != 1)
+					return -1;
+
+				const cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+				if(cmsg == nullptr || cmsg->cmsg_type != SCM_RIGHTS)
+					return -1;
+
+				int fd = -1;
+				memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+				return fd;
+			}
+
+			int m_listen{ -1 };
+			int m_peer{ -1 };
+			std::string m_path;
+#endif
+
+#if defined(_WIN32)
+		private:
+			HANDLE m_event{ nullptr };
+#endif
+	};
+
+	/*
+	* Producer back-pressure: waits until 'ready' holds while the consumer drains, ringing so it doesn't sleep on a bell
+	* it already answered. False when the consumer hung up or consumed nothing for 'stallTimeout'.
+	*/
+	template<typename F>
+	bool WaitForConsumer(sharedArena& arena, doorbell& bell, F&& ready, std::chrono::milliseconds stallTimeout = std::chrono::seconds(30))
+	{
+		uint32_t tail = arena.Header()->ringTail.load(std::memory_order_acquire);
+		auto deadline = std::chrono::steady_clock::now() + stallTimeout;
+		while(!ready())
+		{
+			if(!bell.Ring())
+				return false;
+
+			const uint32_t newTail = arena.Header()->ringTail.load(std::memory_order_acquire);
+			if(newTail != tail)
+			{
+				tail = newTail;
+				deadline = std::chrono::steady_clock::now() + stallTimeout;
+			}
+			else if(std::chrono::steady_clock::now() > deadline)
+			{
+				return false;
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		return true;
+	}
+
+	// Single producer: adds and publishes an entry, waiting while the consumer is a whole table or ring behind.
+	inline bool PublishEntry(sharedArena& arena, doorbell& bell, std::string_view name, EntryKind kind, uint32_t count, uint64_t offset, uint64_t size)
+	{
+		if(!WaitForConsumer(arena, bell, [&]() { return arena.CanPublish(1); }))
+			return false;
+
+		const uint32_t slot = arena.AddEntry(name, kind, count, offset, size);
+		return slot < MaxEntries && arena.Publish(slot);
+	}
+
+	/*
+	* Consumer loop: calls onEntry(entry, data) for every published entry, in order, until the producer closes the arena.
+	* 'entry' is released (its slot reused) after onEntry returns, the data it points at stays valid while the arena is mapped.
+	*/
+	template<typename F>
+	void Consume(sharedArena& arena, doorbell& bell, F&& onEntry)
+	{
+		const auto drain = [&]()
+		{
+			while(const auto entryIndex = arena.NextPublished())
+			{
+				const Entry& entry = arena.Header()->entries[entryIndex.value()];
+				onEntry(entry, static_cast<const void*>(arena.At(entry.offset)));
+				arena.ReleaseEntry();
+			}
+		};
+
+		while(true)
+		{
+			// everything was published before 'closed' was set, so the drain after seeing it is the last one
+			const bool closed = arena.Header()->closed.load(std::memory_order_acquire) != 0;
+			drain();
+
+			if(closed)
+				break;
+
+			if(!bell.Wait())
+			{
+				drain();
+				break;
+			}
+		}
+	}
+}
+
+struct WorldPartitionOptions
+{
+	float cellSize{ 128.0f };	// cells are square on the XY plane
+	std::filesystem::path outputDir{ "world" };
+	bool encodeGeometry{ true };	// meshes as codec streams
+};
+
+enum class VatEncoding
+{
+	Half,	// RGBA16F positions and normals
+	Rgbm	// RGBM positions in the offset bounds, RGBA8 normals
+};
+
+struct VatOptions
+{
+	VatEncoding encoding{ VatEncoding::Half };
+	std::optional<float> frameStart;	// keyed range of the actions by default
+	std::optional<float> frameEnd;
+	float frameStep{ 1.0f };
+	uint32_t maxWidth{ 4096 };			// texture width, vertices wrap to further rows
+};
+
+struct BoneAtlasOptions
+{
+	bool halfFloat{ true };		// RGBA16F, otherwise RGBA32F
+	float frameStep{ 1.0f };	// clips are sampled over their keyed range
+	uint32_t maxWidth{ 4096 };	// atlas width, the bones of a frame wrap to further rows
+	bool extractRootMotion{ false };	// root bone planar translation and yaw moved to a track of their own
+	std::string retargetSource;			// character whose clips are retargeted, empty for the character's own
+	std::filesystem::path boneMap;		// optional "source=target" lines, other bones map by name
+};
+
+struct BlendFileInfo
+{
+	uint32_t version{ 0 };			// eg. 400 for 4.0
+	uint32_t subversion{ 0 };
+	uint32_t minVersion{ 0 };		// oldest Blender which can read the file
+	uint32_t minSubversion{ 0 };
+	bool largeBlockHeaders{ false };	// 5.0+ header
+	uint64_t buildCommitTimestamp{ 0 };
+	std::string buildHash;
+	uint32_t fileFlags{ 0 };		// FileGlobal.fileflags (G_FILE_*)
+	uint32_t globalFlags{ 0 };		// FileGlobal.globalf (G_FLAG_*)
+	std::string currentScene;
+
+	void Print() const
+	{
+		std::cout << "Blender " << version / 100 << '.' << version % 100 << " subversion " << subversion
+				  << " (min " << minVersion / 100 << '.' << minVersion % 100 << '.' << minSubversion << ")"
+				  << (largeBlockHeaders ? " 64bit block sizes" : "")
+				  << " build " << (buildHash.empty() ? "unknown" : buildHash)
+				  << " flags 0x" << std::hex << fileFlags << " global 0x" << globalFlags << std::dec
+				  << " scene '" << currentScene << "'\n";
+	}
+};
+
+struct SceneFrameRange
+{
+	std::string name;
+	int32_t frameStart;
+	int32_t frameEnd;
+};
+
+// ID -> ID references in compressed rows: the dependencies of node n are edges[offsets[n] .. offsets[n + 1]).
+struct IdDependencyGraph
+{
+	static constexpr uint32_t NoNode = std::numeric_limits<uint32_t>::max();
+
+	std::vector<size_t> idBlocks;	// node -> index of the ID block
+	std::vector<uint32_t> offsets;	// NumNodes() + 1 entries
+	std::vector<uint32_t> edges;	// node indices, sorted and unique per node
+
+	size_t NumNodes() const { return idBlocks.size(); }
+	size_t NumEdges() const { return edges.size(); }
+
+	template<typename F>
+	void ForEachDependency(uint32_t node, F&& onDependency) const
+	{
+		for(uint32_t e=offsets[node]; e<offsets[node + 1]; ++e)
+			onDependency(edges[e]);
+	}
+};
+
+struct UnreachableIdReport
+{
+	struct Entry
+	{
+		std::string name;	// with the ID code prefix
+		size_t blockId;
+		uint64_t bytes;		// ID block and its DATA blocks, headers included
+	};
+
+	std::vector<Entry> unreachable;	// largest first
+	uint64_t unreachableBytes{ 0 };
+	uint64_t fileBytes{ 0 };
+	size_t numIds{ 0 };
+
+	void Print() const
+	{
+		const double percent = (fileBytes > 0 ? 100.0 * double(unreachableBytes) / double(fileBytes) : 0.0);
+		std::cout << "Unreachable IDs: " << unreachable.size() << " of " << numIds << ", " << unreachableBytes << " of " << fileBytes << " bytes (" << percent << "% of the file to read and store)\n";
+		for(const Entry& entry: unreachable)
+			std::cout << "  " << entry.name << ' ' << entry.bytes << " bytes\n";
+	}
+};
+
+/*
+* Traverse:
+*	- Scene:
+*		- Time Markers (for animation identification eg. 'enemy_run' frames[20,50])
+*		- Master Collection:
+*			- Objects
+*				- Armature
+*					- Bones
+*						- BonePose
+*				- Mesh
+*					- Verts/Edges/Loops/Weights
+*				- Key (ShapeKeys for vertex animations)
+*/
+
+namespace selftest
+{
+	inline bool MissingFields(const std::string& file);
+}
+
+class blendExpl
+{
+	public:
+		~blendExpl()
+		{
+			Cleanup();
+		}
+
+		void Explore()
+		{
+			if(ParseFile(BLEND_FILE))
+			{
+				std::cout << '\n';
+
+				blendMesh mesh;
+				//ExploreMeshData(mesh);
+
+				//PrintStructByName("Object");
+				//ExploreNonDataBlocks();
+				//ExploreDataBlocks();
+				//ExploreObjectData();
+				//SetRenderVisibleOnly(true);
+				//ExploreScene();
+				//ExploreScenes();
+				//ExploreMeshValidation(MeshRepair::Drop);
+				//ExploreMeshChunking();
+				//ExportWorldPartition();
+				//ExportConvexHulls("hulls.bxh");
+				//BakeVertexAnimation("Cube", "cube.bxv", VatOptions{ VatEncoding::Half });
+				//BakeBoneAtlas("Armature", "armature.bxb");
+				//ValidatePose("Armature");
+				//ServeSharedMeshes("/tmp/blendexpl.sock", size_t(1) << 30);
+				//ExploreIdGraph();
+				//FindUnreachableIds(false).Print();
+				//WriteSubset("subset.blend", { "OBCube" });
+				//ExploreRegion(BoundingBox{ blender::Float3{ -10.0f, -10.0f, -10.0f }, blender::Float3{ 10.0f, 10.0f, 10.0f } });
+				ExploreArmature();
+			}
+		}
+
+		void ExploreNonDataBlocks()
+		{
+			for(const auto& block: m_blockArray)
+			{
+				if(Identify(block.desc.code, "DATA", 4))
+					continue;
+
+				PrintBlockSDNA(block);
+				PrintStructBySDNA(block.desc.sdnaIndex);
+			}
+		}
+
+		void ExploreDataBlocks()
+		{
+			size_t fcurves = 0;
+			size_t actiongrps = 0;
+			size_t beztriples = 0;
+
+			for(const auto& block: m_blockArray)
+			{
+				if(!Identify(block.desc.code, "DATA", 4))
+					continue;
+
+				if(IdentifyStruct(block.desc.sdnaIndex, "FCurve"))
+				{
+					const uint32_t totvert = PeekField<char>(block, GetFieldOffset("FCurve", "totvert"));
+					std::cout << "FCurve totvert: " << totvert << '\n';
+					fcurves++;
+				}
+				else if(IdentifyStruct(block.desc.sdnaIndex, "bActionGroup"))
+				{
+					const std::string name = ReadName(block, GetFieldOffset("bActionGroup", "name[64]"));
+					std::cout << "Action group name: " << name << '\n';
+
+					actiongrps++;
+				}
+				else if(IdentifyStruct(block.desc.sdnaIndex, "BezTriple"))
+				{
+					const size_t bezTripleSize = GetStructSizeByName("BezTriple");
+					const size_t offsetOfVec = GetFieldOffset("BezTriple", "vec[3][3]");
+					if(offsetOfVec == MissingField)
+						continue;
+
+					for(size_t i=0; i<2; ++i)
+					{
+						const auto vec = PeekField<std::array<float, 9>>(block, i * bezTripleSize + offsetOfVec);
+
+						std::cout << "Keyframe: " << std::nearbyint(vec[3]) << "  [";
+						for(size_t i=0; i<9; ++i)
+							std::cout << vec[i] << (i == 8 ? "]\n" : ",");
+
+						beztriples++;
+					}
+				}
+			}
+
+			std::cout << "FCurves: " << fcurves << '\n';
+			std::cout << "bActionGroups: " << actiongrps << '\n';
+			std::cout << "BezTriple: " << beztriples << '\n';
+		}
+
+		void ExploreObjectData()
+		{
+			const size_t offsetOfType = GetFieldOffset("Object", "type");
+			const size_t offsetOfData = GetFieldOffset("Object", "*data");
+
+			size_t prevFoundBlockId = -1;
+			bool hasMoreObject = true;
+
+			while(hasMoreObject)
+			{
+				const auto blockId = FindBlockByCode(blender::BlockOB, prevFoundBlockId + 1);
+				hasMoreObject = blockId.has_value();
+
+				if(hasMoreObject)
+				{
+					const size_t objectBlockId = blockId.value();
+					const auto& block = m_blockArray.at(objectBlockId);
+
+					std::cout << "Object name: " << GetBlockNameByID(block, true) << '\n';
+
+					const blender::OB_TYPE type = PeekField<blender::OB_TYPE>(block, offsetOfType);
+					std::cout << "  Type: " << static_cast<size_t>(type) << '\n';
+
+					const auto adtArmatureOb = PeekField<blender::PtrType>(block, GetFieldOffset("Object", "*adt"));
+					if(adtArmatureOb != 0)
+						std::cout << "Found animation data for object\n";
+
+					if(type == blender::OB_TYPE::OB_MESH)
+					{
+						//std::cout << "----\n";
+						//PrintBlockSDNA(block);
+						//PrintStrucyBySDNA(block.blockDesc.sdnaIndex);
+
+						size_t nextBlock = objectBlockId + 1;
+						while(nextBlock < m_blockArray.size())
+						{
+							const auto& dataFileBlock = m_blockArray.at(nextBlock);
+							if(!Identify(dataFileBlock.desc.code, "DATA", 4))
+								break;
+
+							const blender::BlockDesc& blockDesc = dataFileBlock.desc;
+
+							if(IdentifyStruct(blockDesc.sdnaIndex, "bDeformGroup"))
+							{
+								MemorySpan dgroupSpan = dataFileBlock.data;
+								const auto* defGroup = ReadTypePtr<blender::MDeformGroup>(dgroupSpan);
+								int d = 3;
+							}
+
+							nextBlock++;
+						}
+					}
+
+					prevFoundBlockId = blockId.value();
+				}
+			}
+		}
+
+		// Empty sceneName explores every scene.
+		void ExploreScene(std::string_view sceneName = {})
+		{
+			const auto activeScene = GetActiveSceneBlockId();
+
+			for(const auto& sceneBlock: m_blockArray)
+			{
+				if(!Identify(sceneBlock.desc.code, blender::BlockSC, 4))
+					continue;
+
+				if(!sceneName.empty() && GetBlockNameByID(sceneBlock, true) != sceneName)
+					continue;
+
+				const bool isActive = activeScene.has_value() && &m_blockArray.at(activeScene.value()) == &sceneBlock;
+				std::cout << "----\n";
+				std::cout << "Scene name: " << GetBlockNameByID(sceneBlock, true) << (isActive ? " (active)" : "") << '\n';
+
+				//PrintBlockSDNA(sceneBlock);
+				//PrintStrucyBySDNA(sceneBlock.blockDesc.sdnaIndex);
+
+				const auto renderDataOff = FindFieldOffset("Scene", "r");
+				const auto sfraOff = FindFieldOffset("RenderData", "sfra");
+				const auto efraOff = FindFieldOffset("RenderData", "efra");
+				if(renderDataOff.has_value() && sfraOff.has_value() && efraOff.has_value())
+				{
+					const auto sfra = PeekField<int32_t>(sceneBlock, renderDataOff.value() + sfraOff.value());
+					const auto efra = PeekField<int32_t>(sceneBlock, renderDataOff.value() + efraOff.value());
+					std::cout << "Frame range: " << sfra << '-' << efra << '\n';
+				}
+
+				const auto collectionAddr = PeekField<blender::PtrType>(sceneBlock, GetFieldOffset("Scene", "*master_collection"));
+
+				for(const auto& collectionBlock: sceneBlock.childBlocks)
+				{
+					if(collectionBlock.desc.oldMemoryAddress == collectionAddr)
+					{
+						TraverseCollections(collectionBlock);
+						break;
+					}
+				}
+
+				for(const auto& childBlock: sceneBlock.childBlocks)
+				{
+					if(IdentifyStruct(childBlock.desc.sdnaIndex, "TimeMarker"))
+					{
+						const auto frame = PeekField<int32_t>(childBlock, GetFieldOffset("TimeMarker", "frame"));
+						const std::string name = ReadName(childBlock, GetFieldOffset("TimeMarker", "name[64]"));
+						std::cout << "Found a time marker: " << name << " frame: " << frame << '\n';
+					}
+				}
+			}
+		}
+
+		struct SceneInfo
+		{
+			size_t blockId;
+			std::string name;
+			bool active;
+		};
+
+		std::vector<SceneInfo> EnumerateScenes() const
+		{
+			const auto activeScene = GetActiveSceneBlockId();
+
+			std::vector<SceneInfo> scenes;
+			for(size_t i=0; i<m_blockArray.size(); ++i)
+			{
+				if(Identify(m_blockArray.at(i).desc.code, blender::BlockSC, 4))
+					scenes.emplace_back(SceneInfo{ i, std::string(GetBlockNameByID(m_blockArray.at(i), true)), activeScene == i });
+			}
+
+			return scenes;
+		}
+
+		// FileGlobal.curscene of the GLOB block
+		std::optional<size_t> GetActiveSceneBlockId() const
+		{
+			const auto globBlockId = FindBlockByCode(blender::BlockGLOB, 0);
+			if(!globBlockId.has_value())
+				return {};
+
+			const auto curSceneOffset = FindFieldOffset("FileGlobal", "*curscene");
+			if(!curSceneOffset.has_value())
+				return {};
+
+			return FindBlockIdByOldAddr(PeekField<blender::PtrType>(m_blockArray.at(globBlockId.value()), curSceneOffset.value()));
+		}
+
+		struct SceneExtract
+		{
+			std::string name;
+			int32_t frameStart;
+			int32_t frameEnd;
+			std::vector<container::ObjectData> objects; // meshRef indexes SceneSetExtract::meshes
+		};
+
+		struct SceneSetExtract
+		{
+			std::vector<SceneExtract> scenes;
+			std::vector<container::MeshData> meshes; // shared by every scene
+		};
+
+		/*
+		* Extracts the objects of each scene's master collection tree (render visible only when the filter is on, evaluated
+		* per scene) and its frame range. Scenes are collected concurrently, every mesh used by any of them is extracted
+		* once, in parallel, and shared.
+		*/
+		SceneSetExtract ExtractScenes(const std::vector<size_t>& sceneBlockIds) const
+		{
+			const size_t offsetOfData = GetFieldOffset("Object", "*data");
+			const auto renderDataOff = FindFieldOffset("Scene", "r");
+			const auto sfraOff = FindFieldOffset("RenderData", "sfra");
+			const auto efraOff = FindFieldOffset("RenderData", "efra");
+			const bool hasFrameRange = renderDataOff.has_value() && sfraOff.has_value() && efraOff.has_value();
+			const size_t masterCollectionOff = GetFieldOffset("Scene", "*master_collection");
+
+			SceneSetExtract result;
+			result.scenes.resize(sceneBlockIds.size());
+			std::vector<std::vector<size_t>> sceneObjects(sceneBlockIds.size());
+
+			std::for_each(std::execution::par, sceneBlockIds.begin(), sceneBlockIds.end(), [&](const size_t& sceneBlockId)
+			{
+				const size_t s = &sceneBlockId - sceneBlockIds.data();
+				const auto& sceneBlock = m_blockArray.at(sceneBlockId);
+
+				SceneExtract& scene = result.scenes[s];
+				scene.name = GetBlockNameByID(sceneBlock, true);
+				if(hasFrameRange)
+				{
+					scene.frameStart = PeekField<int32_t>(sceneBlock, renderDataOff.value() + sfraOff.value());
+					scene.frameEnd = PeekField<int32_t>(sceneBlock, renderDataOff.value() + efraOff.value());
+				}
+
+				std::optional<RenderVisibility> visibility;
+				if(m_renderFilter.has_value())
+					visibility = EvaluateRenderVisibility(sceneBlock);
+
+				const auto masterCollectionId = FindBlockIdByOldAddr(PeekField<blender::PtrType>(sceneBlock, masterCollectionOff));
+				if(masterCollectionId.has_value())
+				{
+					std::unordered_set<blender::PtrType> visited;
+					CollectCollectionObjects(masterCollectionId.value(), visibility.has_value() ? &visibility.value() : nullptr, visited, sceneObjects[s]);
+				}
+			});
+
+			// meshes used by any scene, extracted once
+			std::vector<size_t> meshBlockIds;
+			for(const auto& objects: sceneObjects)
+			{
+				for(const size_t obBlockId: objects)
+				{
+					const auto dataBlockId = FindBlockIdByOldAddr(PeekField<blender::PtrType>(m_blockArray.at(obBlockId), offsetOfData));
+					if(dataBlockId.has_value() && Identify(m_blockArray.at(dataBlockId.value()).desc.code, blender::BlockME, 4))
+						meshBlockIds.emplace_back(dataBlockId.value());
+				}
+			}
+
+			std::sort(meshBlockIds.begin(), meshBlockIds.end());
+			meshBlockIds.erase(std::unique(meshBlockIds.begin(), meshBlockIds.end()), meshBlockIds.end());
+
+			result.meshes.resize(meshBlockIds.size());
+			std::transform(std::execution::par, meshBlockIds.begin(), meshBlockIds.end(), result.meshes.begin(), [this](size_t meshBlockId)
+			{
+				return ExtractContainerMesh(meshBlockId);
+			});
+
+			std::for_each(std::execution::par, result.scenes.begin(), result.scenes.end(), [&](SceneExtract& scene)
+			{
+				for(const size_t obBlockId: sceneObjects[&scene - result.scenes.data()])
+				{
+					const auto& obBlock = m_blockArray.at(obBlockId);
+
+					int32_t meshRef = container::NoMesh;
+					const auto dataBlockId = FindBlockIdByOldAddr(PeekField<blender::PtrType>(obBlock, offsetOfData));
+					const auto it = (dataBlockId.has_value() ? std::lower_bound(meshBlockIds.begin(), meshBlockIds.end(), dataBlockId.value()) : meshBlockIds.end());
+					if(it != meshBlockIds.end() && *it == dataBlockId.value())
+						meshRef = int32_t(it - meshBlockIds.begin());
+
+					scene.objects.emplace_back(container::ObjectData{ std::string(GetBlockNameByID(obBlock, true)), GetObjectWorldMatrix(obBlock).value_or(blender::Float4x4{}), meshRef });
+				}
+			});
+
+			return result;
+		}
+
+		void ExploreScenes()
+		{
+			const auto scenes = EnumerateScenes();
+
+			std::vector<size_t> sceneBlockIds;
+			for(const SceneInfo& scene: scenes)
+			{
+				std::cout << "Scene: " << scene.name << (scene.active ? " (active)" : "") << '\n';
+				sceneBlockIds.emplace_back(scene.blockId);
+			}
+
+			const SceneSetExtract extract = ExtractScenes(sceneBlockIds);
+			for(const SceneExtract& scene: extract.scenes)
+			{
+				std::cout << "Scene " << scene.name << " frames " << scene.frameStart << '-' << scene.frameEnd << " objects: " << scene.objects.size() << '\n';
+				for(const auto& object: scene.objects)
+					std::cout << "  " << object.name << (object.meshRef >= 0 ? " mesh: " + extract.meshes[object.meshRef].name : std::string()) << '\n';
+			}
+
+			std::cout << "Shared meshes: " << extract.meshes.size() << '\n';
+		}
+
+		void TraverseCollections(const blender::FileBlock& collectionBlock)
+		{
+			assert(IdentifyStruct(collectionBlock.desc.sdnaIndex, "Collection"));
+
+			if(!IsCollectionRenderVisible(collectionBlock.desc.oldMemoryAddress))
+				return;
+
+			//PrintBlockSDNA(collectionBlock);
+			//PrintStrucyBySDNA(collectionBlock.blockDesc.sdnaIndex);
+
+			std::cout << "Collection name: " << GetBlockNameByID(collectionBlock, true) << '\n';
+
+			const blender::PtrType gobjectAddr = PeekField<blender::ListBase>(collectionBlock, GetFieldOffset("Collection", "gobject")).first;
+
+			if(gobjectAddr != 0)
+				TraverseCollectionObjects(gobjectAddr);
+			
+			const auto children = PeekField<blender::ListBase>(collectionBlock, GetFieldOffset("Collection", "children"));
+			ForEachListItem(children.first, [this](const blender::FileBlock& collectionChild)
+			{
+				const auto collectionPtr = PeekField<blender::PtrType>(collectionChild, GetFieldOffset("CollectionChild", "*collection"));
+				const auto collectionId = FindBlockIdByOldAddr(collectionPtr);
+				if(collectionId.has_value())
+					TraverseCollections(m_blockArray.at(collectionId.value()));
+			});
+		}
+
+		void TraverseCollectionObjects(const blender::PtrType addr)
+		{
+			const auto collectionObjectOpt = FindFileBlockByOldAddr(addr);
+			if(!collectionObjectOpt.has_value())
+				return;
+
+			const blender::FileBlock& collectionObject = collectionObjectOpt.value();
+			assert(IdentifyStruct(collectionObject.desc.sdnaIndex, "CollectionObject"));
+
+			const auto obAddr = PeekField<blender::PtrType>(collectionObject, GetFieldOffset("CollectionObject", "*ob"));
+			const auto obOpt = FindFileBlockByOldAddr(obAddr);
+			if(obOpt.has_value() && IsObjectRenderVisible(obAddr))
+			{
+				const auto& ob = obOpt.value();
+				std::cout << "  Object name: " << GetBlockNameByID(ob, true) << '\n';
+			}
+
+			const blender::PtrType nextAddr = PeekField<blender::PtrType>(collectionObject, GetFieldOffset("CollectionObject", "*next"));
+			if(nextAddr != 0)
+				TraverseCollectionObjects(nextAddr);
+		}
+
+		struct RenderVisibility
+		{
+			std::unordered_set<blender::PtrType> collections;	// old addresses of the collections rendered by some view layer
+			std::unordered_set<blender::PtrType> objects;		// old addresses of the objects rendered by some view layer
+		};
+
+		/*
+		* Walks the LayerCollection tree of every render enabled ViewLayer of the scene: excluded layer collections and
+		* render hidden collections prune their whole subtree, objects of the remaining collections are kept unless render hidden.
+		* Only flags and list links are read, no object data.
+		*/
+		RenderVisibility EvaluateRenderVisibility(const blender::FileBlock& sceneBlock) const
+		{
+			RenderVisibility visibility;
+
+			const auto viewLayers = PeekField<blender::ListBase>(sceneBlock, GetFieldOffset("Scene", "view_layers"));
+			ForEachListItem(viewLayers.first, [&](const blender::FileBlock& viewLayer)
+			{
+				if((ReadFlagField(viewLayer, "ViewLayer", "flag") & blender::VIEW_LAYER_RENDER) == 0)
+					return;
+
+				const auto layerCollections = PeekField<blender::ListBase>(viewLayer, GetFieldOffset("ViewLayer", "layer_collections"));
+				ForEachListItem(layerCollections.first, [&](const blender::FileBlock& layerCollection)
+				{
+					CollectRenderVisible(layerCollection, visibility);
+				});
+			});
+
+			return visibility;
+		}
+
+		// Enables the render visibility filter for traversal and extraction: union of every scene's render visible content.
+		void SetRenderVisibleOnly(bool enable)
+		{
+			m_renderFilter.reset();
+			if(!enable)
+				return;
+
+			RenderVisibility visibility;
+			for(const auto& block: m_blockArray)
+			{
+				if(!Identify(block.desc.code, blender::BlockSC, 4))
+					continue;
+
+				RenderVisibility sceneVisibility = EvaluateRenderVisibility(block);
+				visibility.collections.merge(sceneVisibility.collections);
+				visibility.objects.merge(sceneVisibility.objects);
+			}
+
+			std::cout << "Render visible - collections: " << visibility.collections.size() << " objects: " << visibility.objects.size() << '\n';
+			m_renderFilter = std::move(visibility);
+		}
+
+		bool IsObjectRenderVisible(blender::PtrType obAddr) const
+		{
+			return !m_renderFilter.has_value() || m_renderFilter->objects.contains(obAddr);
+		}
+
+		bool IsCollectionRenderVisible(blender::PtrType collectionAddr) const
+		{
+			return !m_renderFilter.has_value() || m_renderFilter->collections.contains(collectionAddr);
+		}
+
+		void ExploreArmature()
+		{
+			const auto foundBlock = FindBlockByCode(blender::BlockAR, 0);
+			if(foundBlock.has_value())
+			{
+				const size_t armatureBlockId = foundBlock.value();
+				const auto& block = m_blockArray.at(armatureBlockId);
+
+				std::cout << "Found armature block!\n";
+
+				//PrintBlockSDNA(block);
+				//PrintStrucyBySDNA(block.blockDesc.sdnaIndex);
+
+				const auto parentObject = FindParentObject(block.desc.oldMemoryAddress);
+				if(parentObject.has_value())
+				{
+					const auto& obBlock = parentObject.value();
+					std::cout << "Parent object name: " << GetBlockNameByID(obBlock, true) << '\n';
+				
+					const auto adtArmatureObAddr = PeekField<blender::PtrType>(obBlock, GetFieldOffset("Object", "*adt"));
+					if(adtArmatureObAddr != 0)
+					{
+						const auto adtArmature = FindFileBlockByOldAddr(adtArmatureObAddr);
+						assert(adtArmature.has_value());
+						ExploreAnimationData(adtArmature.value());
+					}
+				}
+
+				size_t numBonesForArmature = 0;
+
+				size_t nextBlock = armatureBlockId + 1;
+				while(nextBlock < m_blockArray.size())
+				{
+					const auto& dataFileBlock = m_blockArray.at(nextBlock);
+					if(!Identify(dataFileBlock.desc.code, "DATA", 4))
+						break;
+
+					if(GetStructNameBySDNA(dataFileBlock.desc.sdnaIndex) == "Bone")
+					{
+						ExploreBone(dataFileBlock);
+						numBonesForArmature++;
+					}
+
+					nextBlock++;
+				}
+
+				std::cout << "Number of bones in armature: " << numBonesForArmature << '\n';
+
+				if(parentObject.has_value())
+				{
+					const auto& obBlock = parentObject.value();
+					const auto poseAddr = PeekField<blender::PtrType>(obBlock, GetFieldOffset("Object", "*pose"));
+					const auto poseBlockOpt = FindFileBlockByOldAddr(poseAddr);
+					if(poseBlockOpt.has_value())
+						ExplorePose(poseBlockOpt.value());
+				}
+			}
+		}
+
+		void ExploreAnimationData(const blender::FileBlock& adt)
+		{
+			const auto adtActionPtr = PeekField<blender::PtrType>(adt, GetFieldOffset("AnimData", "*action"));
+			const auto adtAction = FindFileBlockByOldAddr(adtActionPtr);
+			assert(adtAction.has_value());
+
+			// fcurves of bAnimation
+
+		}
+
+		void ExploreBone(const blender::FileBlock& boneBlock)
+		{
+			std::cout << "--------------\n";
+			std::cout << "Bone name: " << ReadName(boneBlock, GetFieldOffset("Bone", "name[64]")) << " parent: ";
+
+			const auto boneParentAddr = PeekField<blender::PtrType>(boneBlock, GetFieldOffset("Bone", "*parent"));
+			if(boneParentAddr != 0)
+			{
+				const auto parentBoneOpt = FindFileBlockByOldAddr(boneParentAddr);
+				assert(parentBoneOpt.has_value());
+
+				std::cout << ReadName(parentBoneOpt.value(), GetFieldOffset("Bone", "name[64]")) << '\n';
+			}
+			else
+			{
+				std::cout << "null\n";
+			}
+
+			if(false)
+			{
+				const auto armMat = PeekField<std::array<float, 16>>(boneBlock, GetFieldOffset("Bone", "arm_mat[4][4]"));
+				std::cout << "Bone armature matrix: [...]\n";
+
+				for(size_t i=0; i<16; ++i)
+					std::cout << armMat[i] << (i == 15 ? "]\n" : ", ");
+			}
+		}
+
+		void ExplorePose(const blender::FileBlock& poseBlock)
+		{
+			//bPose, bPoseChannel
+			const auto posechan = PeekField<blender::ListBase>(poseBlock, GetFieldOffset("bPose", "chanbase"));
+			if(posechan.first != 0)
+				TraversePoseChannels(posechan.first);
+		}
+
+		void TraversePoseChannels(const blender::PtrType poseChanAddr)
+		{
+			const auto optPoseChannel = FindFileBlockByOldAddr(poseChanAddr);
+			if(!optPoseChannel.has_value())
+				return;
+
+			const auto& poseChannel = optPoseChannel.value();
+			assert(IdentifyStruct(poseChannel.desc.sdnaIndex, "bPoseChannel"));
+
+			ExplorePoseChannel(poseChannel);
+
+			const blender::PtrType nextAddr = PeekField<blender::PtrType>(poseChannel, GetFieldOffset("bPoseChannel", "*next"));
+			if(nextAddr != 0)
+				TraversePoseChannels(nextAddr);
+		}
+
+		void ExplorePoseChannel(const blender::FileBlock& poseChannel)
+		{
+			std::cout << "--------------\n";
+			std::cout << "Found a bPoseChannel: " << ReadName(poseChannel, GetFieldOffset("bPoseChannel", "name[64]")) << '\n';
+
+			const auto chanBoneAddr = PeekField<blender::PtrType>(poseChannel, GetFieldOffset("bPoseChannel", "*bone"));
+			const auto chanBone = FindFileBlockByOldAddr(chanBoneAddr);
+			assert(chanBone.has_value());
+
+			std::cout << "Channel bone name: " << ReadName(chanBone.value(), GetFieldOffset("Bone", "name[64]")) << '\n';
+
+			if(true)
+			{
+				const auto chanMat = PeekField<std::array<float, 16>>(poseChannel, GetFieldOffset("bPoseChannel", "chan_mat[4][4]"));
+				std::cout << "Channel matrix: \n  [";
+
+				for(size_t i=0; i<16; ++i)
+					std::cout << chanMat[i] << (i == 15 ? "]\n" : ", ");
+			}
+		}
+
+		void ExploreMeshData(blendMesh& mesh)
+		{
+			const auto foundBlock = FindBlockByCode(blender::BlockME, 0);
+			if(foundBlock.has_value())
+			{
+				const size_t meshBlockId = foundBlock.value();
+				const auto& block = m_blockArray.at(meshBlockId);
+
+				std::cout << "Mesh name: " << GetBlockNameByID(block, true) << '\n';
+
+				const auto totvert = PeekField<uint32_t>(block, GetFieldOffset("Mesh", "totvert"));
+				const auto totpoly = PeekField<uint32_t>(block, GetFieldOffset("Mesh", "totpoly"));
+				const auto totloop = PeekField<uint32_t>(block, GetFieldOffset("Mesh", "totloop"));
+
+				std::cout << "Verts: " << totvert << " polys: " << totpoly << " loops: " << totloop << '\n';
+				std::cout << '\n';
+
+				const auto parentObject = FindParentObject(block.desc.oldMemoryAddress);
+				if(parentObject.has_value())
+				{
+					const auto& obBlock = parentObject.value();
+					std::cout << "Object name: " << GetBlockNameByID(obBlock, true) << '\n';
+
+					const auto loc = PeekField<blender::Float3>(obBlock, GetFieldOffset("Object", "loc[3]"));
+					const auto scale = PeekField<blender::Float3>(obBlock, GetFieldOffset("Object", "scale[3]"));
+					const auto quat = PeekField<blender::Float4>(obBlock, GetFieldOffset("Object", "quat[4]"));
+
+					std::cout << "Translation x: " << loc.x << " y: " << loc.y << " z: " << loc.z << '\n';
+					std::cout << "Scale x: " << scale.x << " y: " << scale.y << " z: " << scale.z << '\n';
+					std::cout << "Rotation (quat) w: " << quat.w << " x: "  << quat.x << " y: " << quat.y << " z: " << quat.z << '\n';
+
+					for(const auto& childBlock: obBlock.childBlocks)
+					{
+						if(IdentifyStruct(childBlock.desc.sdnaIndex, "ArmatureModifierData"))
+						{
+							const auto arModObject = PeekField<blender::PtrType>(childBlock, GetFieldOffset("ArmatureModifierData", "*object"));
+							const auto armatureParentObject = FindFileBlockByOldAddr(arModObject);
+							if(armatureParentObject.has_value())
+							{
+								const auto& armatureObBlock = armatureParentObject.value();
+								std::cout << "Armature object name: " << GetBlockNameByID(armatureObBlock, true) << '\n';
+							}
+						}
+					}
+
+					std::cout << '\n';
+				}
+
+				PrintBlockSDNA(block);
+				PrintStructBySDNA(block.desc.sdnaIndex);
+
+				size_t nextBlock = meshBlockId + 1;
+				while(nextBlock < m_blockArray.size())
+				{
+					const auto& dataFileBlock = m_blockArray.at(nextBlock);
+					if(!Identify(dataFileBlock.desc.code, "DATA", 4))
+						break;
+
+					if(false)
+					{
+						std::cout << "----\n";
+						PrintBlockSDNA(dataFileBlock);
+						PrintStructBySDNA(dataFileBlock.desc.sdnaIndex);
+					}
+					else
+					{
+						const blender::BlockDesc& blockDesc = dataFileBlock.desc;
+						const MemorySpan dataSpan = dataFileBlock.data;
+
+						if(IdentifyStruct(blockDesc.sdnaIndex, "MVert"))
+							mesh.Read_MVert(dataSpan, blockDesc.count);
+						else if(IdentifyStruct(blockDesc.sdnaIndex, "MDeformVert"))
+							mesh.Read_MDeformVert(dataSpan, blockDesc.count);
+						else if(IdentifyStruct(blockDesc.sdnaIndex, "MDeformWeight"))
+							mesh.Read_MDeformWeight(dataSpan, blockDesc.count);
+						else if(IdentifyStruct(blockDesc.sdnaIndex, "MLoop"))
+							mesh.Read_MLoop(dataSpan, blockDesc.count);
+						else if(IdentifyStruct(blockDesc.sdnaIndex, "MLoopUV"))
+							mesh.Read_MLoopUV(dataSpan, blockDesc.count);
+						else if(IdentifyStruct(blockDesc.sdnaIndex, "MLoopCol"))
+							mesh.Read_MLoopCol(dataSpan, blockDesc.count);
+						else if(IdentifyStruct(blockDesc.sdnaIndex, "MEdge"))
+							mesh.Read_MEdge(dataSpan, blockDesc.count);
+						else if(IdentifyStruct(blockDesc.sdnaIndex, "MPoly"))
+							mesh.Read_MPoly(dataSpan, blockDesc.count);
+					}
+
+					nextBlock++;
+				}
+			}		
+		}
+
+		// Copies the mesh arrays which follow the ME block into 'mesh', no printing.
+		void ExtractMeshData(size_t meshBlockId, blendMesh& mesh) const
+		{
+			size_t nextBlock = meshBlockId + 1;
+			while(nextBlock < m_blockArray.size())
+			{
+				const auto& dataFileBlock = m_blockArray.at(nextBlock);
+				if(!Identify(dataFileBlock.desc.code, "DATA", 4))
+					break;
+
+				const blender::BlockDesc& blockDesc = dataFileBlock.desc;
+
+				if(IdentifyStruct(blockDesc.sdnaIndex, "MVert"))
+					mesh.Load_MVert(GetStructView<blender::MVert>(dataFileBlock));
+				else if(IdentifyStruct(blockDesc.sdnaIndex, "MEdge"))
+					mesh.Load_MEdge(GetStructView<blender::MEdge>(dataFileBlock));
+				else if(IdentifyStruct(blockDesc.sdnaIndex, "MLoop"))
+					mesh.Load_MLoop(GetStructView<blender::MLoop>(dataFileBlock));
+				else if(IdentifyStruct(blockDesc.sdnaIndex, "MPoly"))
+					mesh.Load_MPoly(GetStructView<blender::MPoly>(dataFileBlock));
+				else if(IdentifyStruct(blockDesc.sdnaIndex, "MLoopUV"))
+					mesh.Load_MLoopUV(GetStructView<blender::MLoopUV>(dataFileBlock));
+
+				nextBlock++;
+			}
+
+			const auto& meshBlock = m_blockArray.at(meshBlockId);
+			const int64_t numVerts = ReadField<int32_t>(meshBlock, "Mesh", "verts_num").value_or(-1);
+			const int64_t numPolys = ReadField<int32_t>(meshBlock, "Mesh", "faces_num").value_or(-1);
+			mesh.SetDeclaredCounts(numVerts, numPolys);
+
+			if(mesh.verts.empty() && numVerts > 0)
+				ExtractMeshAttributes(meshBlock, mesh);
+		}
+
+		// 3.4+ layout: positions, edges and corners are named CustomData layers, the faces an int array of offsets into the corners.
+		void ExtractMeshAttributes(const blender::FileBlock& meshBlock, blendMesh& mesh) const
+		{
+			const size_t numVerts = size_t(std::max(ReadField<int32_t>(meshBlock, "Mesh", "verts_num").value_or(0), 0));
+			const size_t numEdges = size_t(std::max(ReadField<int32_t>(meshBlock, "Mesh", "edges_num").value_or(0), 0));
+			const size_t numLoops = size_t(std::max(ReadField<int32_t>(meshBlock, "Mesh", "corners_num").value_or(0), 0));
+			const size_t numPolys = size_t(std::max(ReadField<int32_t>(meshBlock, "Mesh", "faces_num").value_or(0), 0));
+
+			std::optional<size_t> positions, edgeVerts, cornerVerts, cornerEdges;
+			std::vector<size_t> uvLayers;
+			ForEachCustomDataLayer(meshBlock, "Mesh", "vdata", [&](std::string_view name, int32_t type, size_t dataBlockId)
+			{
+				if(name == "position" && type == blender::CD_PROP_FLOAT3)
+					positions = dataBlockId;
+			});
+			ForEachCustomDataLayer(meshBlock, "Mesh", "edata", [&](std::string_view name, int32_t type, size_t dataBlockId)
+			{
+				if(name == ".edge_verts" && type == blender::CD_PROP_INT32_2D)
+					edgeVerts = dataBlockId;
+			});
+			ForEachCustomDataLayer(meshBlock, "Mesh", "ldata", [&](std::string_view name, int32_t type, size_t dataBlockId)
+			{
+				if(name == ".corner_vert" && type == blender::CD_PROP_INT32)
+					cornerVerts = dataBlockId;
+				else if(name == ".corner_edge" && type == blender::CD_PROP_INT32)
+					cornerEdges = dataBlockId;
+				else if(type == blender::CD_PROP_FLOAT2 && !name.starts_with('.'))
+					uvLayers.emplace_back(dataBlockId); // any float2 corner attribute is a UV map, eg. "UVMap"
+			});
+
+			const auto dataOf = [this](const std::optional<size_t>& blockId) { return blockId.has_value() ? m_blockArray.at(blockId.value()).data : MemorySpan{}; };
+
+			if(positions.has_value())
+				mesh.Load_Positions(MakeStridedView<blender::Float3>(dataOf(positions), numVerts, sizeof(blender::Float3)));
+
+			if(edgeVerts.has_value())
+				mesh.Load_EdgeVerts(MakeStridedView<int32_t>(dataOf(edgeVerts), numEdges, 2 * sizeof(int32_t), 0),
+									MakeStridedView<int32_t>(dataOf(edgeVerts), numEdges, 2 * sizeof(int32_t), sizeof(int32_t)));
+
+			if(cornerVerts.has_value())
+				mesh.Load_Corners(MakeStridedView<int32_t>(dataOf(cornerVerts), numLoops, sizeof(int32_t)),
+								  MakeStridedView<int32_t>(dataOf(cornerEdges), numLoops, sizeof(int32_t)));
+
+			// files which still carry MLoopUV blocks got them loaded already
+			if(mesh.NumUvLayers() == 0)
+			{
+				for(const size_t uvLayer: uvLayers)
+					mesh.Load_UvLayer(MakeStridedView<blender::Float2>(dataOf(uvLayer), numLoops, sizeof(blender::Float2)));
+			}
+
+			const auto faceOffsets = FindBlockIdByOldAddr(ReadField<blender::PtrType>(meshBlock, "Mesh", "*face_offset_indices").value_or(0));
+			if(faceOffsets.has_value() && numPolys > 0)
+				mesh.Load_FaceOffsets(MakeStridedView<int32_t>(dataOf(faceOffsets), numPolys + 1, sizeof(int32_t)));
+		}
+
+		/*
+		* Positions and triangles of a mesh for the containers. The lightmap UVs are the second UV layer, meshes with
+		* less layers get generated ones.
+		*/
+		container::MeshData ExtractContainerMesh(size_t meshBlockId) const
+		{
+			blendMesh mesh;
+			ExtractMeshData(meshBlockId, mesh);
+			mesh.Validate(MeshRepair::Drop);
+
+			container::MeshData data{ std::string(GetBlockNameByID(m_blockArray.at(meshBlockId), true)), mesh.Positions(), mesh.Triangulate(), {} };
+			if(mesh.NumUvLayers() >= 2)
+				data.lightmapUvs = mesh.TriangulatedUvs(1);
+			else
+				data.lightmapUvs = lightmapUvGenerator(m_lightmapOptions).Generate(data.positions, data.indices).uvs;
+
+			return data;
+		}
+
+		void SetLightmapOptions(const LightmapOptions& options)
+		{
+			m_lightmapOptions = options;
+		}
+
+		// Local bounds of a mesh from the 'co' fields of its MVert arrays (the 'position' attribute of 3.4+ meshes), the rest of the mesh is not touched.
+		BoundingBox GetMeshBounds(size_t meshBlockId) const
+		{
+			BoundingBox bounds;
+			std::vector<float> lanes[3];
+
+			const auto extend = [&](const StridedView<blender::Float3>& coView)
+			{
+				if(coView.Empty())
+					return;
+
+				for(auto& lane: lanes)
+					lane.resize(coView.Size());
+
+				void* out[3] = { lanes[0].data(), lanes[1].data(), lanes[2].data() };
+				coView.GatherLanes(out, 0, coView.Size());
+
+				const auto [minX, maxX] = std::minmax_element(lanes[0].begin(), lanes[0].end());
+				const auto [minY, maxY] = std::minmax_element(lanes[1].begin(), lanes[1].end());
+				const auto [minZ, maxZ] = std::minmax_element(lanes[2].begin(), lanes[2].end());
+				bounds.Extend(blender::Float3{ *minX, *minY, *minZ });
+				bounds.Extend(blender::Float3{ *maxX, *maxY, *maxZ });
+			};
+
+			bool legacyVerts = false;
+			for(size_t nextBlock=meshBlockId + 1; nextBlock<m_blockArray.size(); ++nextBlock)
+			{
+				const auto& dataFileBlock = m_blockArray.at(nextBlock);
+				if(!Identify(dataFileBlock.desc.code, "DATA", 4))
+					break;
+
+				if(!IdentifyStruct(dataFileBlock.desc.sdnaIndex, "MVert"))
+					continue;
+
+				extend(GetFieldView<blender::Float3>(dataFileBlock, "MVert", "co[3]"));
+				legacyVerts = true;
+			}
+
+			if(!legacyVerts)
+			{
+				const auto& meshBlock = m_blockArray.at(meshBlockId);
+				const auto positions = FindCustomDataLayer(meshBlock, "Mesh", "vdata", "position", blender::CD_PROP_FLOAT3);
+				const size_t numVerts = size_t(std::max(ReadField<int32_t>(meshBlock, "Mesh", "verts_num").value_or(0), 0));
+				if(positions.has_value())
+					extend(MakeStridedView<blender::Float3>(m_blockArray.at(positions.value()).data, numVerts, sizeof(blender::Float3)));
+			}
+
+			return bounds;
+		}
+
+		std::optional<blender::Float4x4> GetObjectWorldMatrix(const blender::FileBlock& obBlock) const
+		{
+			// 'obmat' in the DNA, see DnaFieldRenames
+			const auto matOffset = FindFieldOffset("Object", "object_to_world[4][4]");
+			if(!matOffset.has_value())
+				return {};
+
+			return PeekField<blender::Float4x4>(obBlock, matOffset.value());
+		}
+
+		// Builds the object index from the OB blocks' world matrices and their meshes' bounds (each mesh bounded once, in parallel).
+		objectBvh BuildObjectIndex() const
+		{
+			const size_t offsetOfType = GetFieldOffset("Object", "type");
+			const size_t offsetOfData = GetFieldOffset("Object", "*data");
+
+			// objects filtered out by the render visibility filter don't get their meshes bounded at all
+			std::vector<size_t> objectBlocks;
+			std::vector<size_t> meshBlocks;
+			for(size_t i=0; i<m_blockArray.size(); ++i)
+			{
+				const auto& block = m_blockArray.at(i);
+				if(!Identify(block.desc.code, blender::BlockOB, 4) || !IsObjectRenderVisible(block.desc.oldMemoryAddress))
+					continue;
+
+				objectBlocks.emplace_back(i);
+
+				const auto dataBlockId = FindBlockIdByOldAddr(PeekField<blender::PtrType>(block, offsetOfData));
+				if(dataBlockId.has_value() && Identify(m_blockArray.at(dataBlockId.value()).desc.code, blender::BlockME, 4))
+					meshBlocks.emplace_back(dataBlockId.value());
+			}
+
+			std::sort(meshBlocks.begin(), meshBlocks.end());
+			meshBlocks.erase(std::unique(meshBlocks.begin(), meshBlocks.end()), meshBlocks.end());
+
+			std::vector<BoundingBox> meshBounds(meshBlocks.size());
+			std::transform(std::execution::par, meshBlocks.begin(), meshBlocks.end(), meshBounds.begin(), [this](size_t meshBlockId)
+			{
+				return GetMeshBounds(meshBlockId);
+			});
+
+			std::vector<objectBvh::Item> items(objectBlocks.size());
+			std::transform(std::execution::par, objectBlocks.begin(), objectBlocks.end(), items.begin(), [&](size_t obBlockId)
+			{
+				const auto& obBlock = m_blockArray.at(obBlockId);
+
+				BoundingBox local;
+				if(PeekField<blender::OB_TYPE>(obBlock, offsetOfType) == blender::OB_TYPE::OB_MESH)
+				{
+					const auto meshBlockId = FindBlockIdByOldAddr(PeekField<blender::PtrType>(obBlock, offsetOfData));
+					const auto it = (meshBlockId.has_value() ? std::lower_bound(meshBlocks.begin(), meshBlocks.end(), meshBlockId.value()) : meshBlocks.end());
+					if(it != meshBlocks.end() && *it == meshBlockId.value())
+						local = meshBounds[it - meshBlocks.begin()];
+				}
+
+				// objects without geometry (empties, lights, cameras, ...) are indexed by their origin
+				if(local.IsEmpty())
+					local.Extend(blender::Float3{ 0.0f, 0.0f, 0.0f });
+
+				const auto worldMat = GetObjectWorldMatrix(obBlock);
+				return objectBvh::Item{ worldMat.has_value() ? local.Transformed(worldMat.value().m) : local, obBlockId };
+			});
+
+			objectBvh index;
+			index.Build(std::move(items));
+			return index;
+		}
+
+		struct RegionQueryResult
+		{
+			std::vector<size_t> objectBlocks;	// OB blocks intersecting the region
+			std::vector<size_t> dataBlocks;		// their data ID blocks (ME, AR, ...) and all DATA blocks of both, sorted, no duplicates
+		};
+
+		RegionQueryResult QueryRegion(const objectBvh& index, const BoundingBox& region) const
+		{
+			const size_t offsetOfData = GetFieldOffset("Object", "*data");
+			RegionQueryResult result;
+
+			index.Query(region, [&](size_t obBlockId)
+			{
+				result.objectBlocks.emplace_back(obBlockId);
+				AppendBlockWithData(obBlockId, result.dataBlocks, false);
+
+				const auto dataBlockId = FindBlockIdByOldAddr(PeekField<blender::PtrType>(m_blockArray.at(obBlockId), offsetOfData));
+				if(dataBlockId.has_value())
+					AppendBlockWithData(dataBlockId.value(), result.dataBlocks, true);
+			});
+
+			std::sort(result.objectBlocks.begin(), result.objectBlocks.end());
+			std::sort(result.dataBlocks.begin(), result.dataBlocks.end());
+			result.dataBlocks.erase(std::unique(result.dataBlocks.begin(), result.dataBlocks.end()), result.dataBlocks.end());
+			return result;
+		}
+
+		void ExploreRegion(const BoundingBox& region)
+		{
+			const objectBvh index = BuildObjectIndex();
+			std::cout << "Object index - objects: " << index.NumItems() << " nodes: " << index.NumNodes() << '\n';
+
+			const RegionQueryResult result = QueryRegion(index, region);
+			for(const size_t obBlockId: result.objectBlocks)
+				std::cout << "  Object in region: " << GetBlockNameByID(m_blockArray.at(obBlockId), true) << '\n';
+
+			std::cout << "Objects: " << result.objectBlocks.size() << " data blocks: " << result.dataBlocks.size() << '\n';
+		}
+
+		/*
+		* Assigns every object to the XY grid cell of its world bounds' center and writes one container per cell.
+		* Meshes used by a single cell are embedded in that cell, meshes used by more cells go to 'shared.bxc' once.
+		* Meshes are extracted in parallel, cells are written concurrently.
+		*/
+		bool ExportWorldPartition(const WorldPartitionOptions& options = {})
+		{
+			const objectBvh index = BuildObjectIndex();
+			const size_t offsetOfData = GetFieldOffset("Object", "*data");
+
+			struct CellObject
+			{
+				size_t obBlockId;
+				std::optional<size_t> meshBlockId;
+				blender::Float4x4 world;
+				std::string name;
+			};
+
+			std::map<std::pair<int32_t, int32_t>, std::vector<CellObject>> cells;
+			std::map<size_t, std::vector<std::pair<int32_t, int32_t>>> meshCells; // mesh block -> cells using it
+
+			// file order, so the containers are deterministic
+			std::vector<objectBvh::Item> objectBounds = index.Items();
+			std::sort(objectBounds.begin(), objectBounds.end(), [](const auto& a, const auto& b) { return a.id < b.id; });
+
+			const auto meshOf = [&](const blender::FileBlock& obBlock) -> std::optional<size_t>
+			{
+				const auto dataBlockId = FindBlockIdByOldAddr(PeekField<blender::PtrType>(obBlock, offsetOfData));
+				if(dataBlockId.has_value() && Identify(m_blockArray.at(dataBlockId.value()).desc.code, blender::BlockME, 4))
+					return dataBlockId;
+
+				return {};
+			};
+
+			const auto addObject = [&](const BoundingBox& bounds, CellObject&& cellObject)
+			{
+				const blender::Float3 center = bounds.Center();
+				const std::pair<int32_t, int32_t> cell{ int32_t(std::floor(center.x / options.cellSize)), int32_t(std::floor(center.y / options.cellSize)) };
+
+				if(cellObject.meshBlockId.has_value())
+				{
+					auto& usedBy = meshCells[cellObject.meshBlockId.value()];
+					if(std::find(usedBy.begin(), usedBy.end(), cell) == usedBy.end())
+						usedBy.emplace_back(cell);
+				}
+
+				cells[cell].emplace_back(std::move(cellObject));
+			};
+
+			for(const auto& [bounds, obBlockId]: objectBounds)
+			{
+				const auto& obBlock = m_blockArray.at(obBlockId);
+				addObject(bounds, CellObject{ obBlockId, meshOf(obBlock), GetObjectWorldMatrix(obBlock).value_or(blender::Float4x4{}), std::string(GetBlockNameByID(obBlock, true)) });
+			}
+
+			// objects placed by collection instancing empties, each instance is an object of its own cell
+			std::map<size_t, BoundingBox> instanceMeshBounds;
+			std::vector<CollectionInstance> instances = CollectCollectionInstances();
+			const size_t numInstances = instances.size();
+			for(CollectionInstance& instance: instances)
+			{
+				const auto meshBlockId = meshOf(m_blockArray.at(instance.obBlockId));
+
+				BoundingBox local;
+				if(meshBlockId.has_value())
+				{
+					const auto [it, inserted] = instanceMeshBounds.emplace(meshBlockId.value(), BoundingBox{});
+					if(inserted)
+						it->second = GetMeshBounds(meshBlockId.value());
+					local = it->second;
+				}
+
+				if(local.IsEmpty())
+					local.Extend(blender::Float3{ 0.0f, 0.0f, 0.0f });
+
+				addObject(local.Transformed(instance.world.m), CellObject{ instance.obBlockId, meshBlockId, instance.world, std::move(instance.name) });
+			}
+
+			// extract every used mesh once
+			std::vector<size_t> meshBlockIds;
+			for(const auto& [meshBlockId, usedBy]: meshCells)
+				meshBlockIds.emplace_back(meshBlockId);
+
+			std::vector<container::MeshData> meshes(meshBlockIds.size());
+			std::transform(std::execution::par, meshBlockIds.begin(), meshBlockIds.end(), meshes.begin(), [this](size_t meshBlockId)
+			{
+				return ExtractContainerMesh(meshBlockId);
+			});
+
+			const auto meshIndex = [&](size_t meshBlockId) { return size_t(std::lower_bound(meshBlockIds.begin(), meshBlockIds.end(), meshBlockId) - meshBlockIds.begin()); };
+
+			// common package
+			std::vector<const container::MeshData*> sharedMeshes;
+			std::map<size_t, int32_t> sharedRef;
+			for(const auto& [meshBlockId, usedBy]: meshCells)
+			{
+				if(usedBy.size() > 1)
+				{
+					sharedRef[meshBlockId] = container::SharedMeshRef(sharedMeshes.size());
+					sharedMeshes.emplace_back(&meshes[meshIndex(meshBlockId)]);
+				}
+			}
+
+			std::error_code ec;
+			std::filesystem::create_directories(options.outputDir, ec);
+
+			bool ok = container::Write(options.outputDir / "shared.bxc", container::MagicShared, 0, 0, {}, sharedMeshes, options.encodeGeometry);
+
+			std::vector<std::pair<const std::pair<int32_t, int32_t>, std::vector<CellObject>>*> cellList;
+			for(auto& cell: cells)
+				cellList.emplace_back(&cell);
+
+			std::atomic<size_t> failedCells{ 0 };
+			std::for_each(std::execution::par, cellList.begin(), cellList.end(), [&](const auto* cell)
+			{
+				const auto& [coord, cellObjects] = *cell;
+
+				std::vector<container::ObjectData> objects;
+				std::vector<const container::MeshData*> localMeshes;
+				std::map<size_t, int32_t> localRef;
+
+				for(const CellObject& cellObject: cellObjects)
+				{
+					int32_t meshRef = container::NoMesh;
+					if(cellObject.meshBlockId.has_value())
+					{
+						const size_t meshBlockId = cellObject.meshBlockId.value();
+						const auto shared = sharedRef.find(meshBlockId);
+						if(shared != sharedRef.end())
+						{
+							meshRef = shared->second;
+						}
+						else
+						{
+							const auto [it, inserted] = localRef.emplace(meshBlockId, int32_t(localMeshes.size()));
+							if(inserted)
+								localMeshes.emplace_back(&meshes[meshIndex(meshBlockId)]);
+							meshRef = it->second;
+						}
+					}
+
+					objects.emplace_back(container::ObjectData{ cellObject.name, cellObject.world, meshRef });
+				}
+
+				const std::string fileName = "cell_" + std::to_string(coord.first) + "_" + std::to_string(coord.second) + ".bxc";
+				if(!container::Write(options.outputDir / fileName, container::MagicCell, coord.first, coord.second, objects, localMeshes, options.encodeGeometry))
+					failedCells++;
+			});
+
+			std::cout << "World partition - cells: " << cells.size() << " meshes: " << meshes.size() << " shared: " << sharedMeshes.size() << " instances: " << numInstances << '\n';
+			if(!ok || failedCells > 0)
+				std::cout << "ERROR - failed to write " << failedCells + (ok ? 0 : 1) << " container(s)!\n";
+
+			return ok && failedCells == 0;
+		}
+
+		struct CollectionInstance
+		{
+			size_t obBlockId;			// object of the instanced collection
+			blender::Float4x4 world;	// its world matrix placed by the instancing empty (empties, when nested)
+			std::string name;			// <empty>/<object>, nested instances joined the same way
+		};
+
+		/*
+		* Objects placed by the render visible collection instancing empties (Object.instance_collection with OB_DUPLICOLLECTION).
+		* An instance is the object's matrix moved by -Collection.instance_offset and then by the empty's matrix. Instancers inside
+		* an instanced collection are expanded too, up to 'maxDepth' levels (collections instancing themselves stop there).
+		*/
+		std::vector<CollectionInstance> CollectCollectionInstances(uint32_t maxDepth = 8) const
+		{
+			std::vector<CollectionInstance> instances;
+			if(!HasField("Object", "*instance_collection"))
+				return instances;
+
+			for(const auto& block: m_blockArray)
+			{
+				if(Identify(block.desc.code, blender::BlockOB, 4) && IsObjectRenderVisible(block.desc.oldMemoryAddress))
+					ExpandCollectionInstance(block, GetObjectWorldMatrix(block).value_or(blender::Identity()), std::string(GetBlockNameByID(block, true)), maxDepth, instances);
+			}
+
+			return instances;
+		}
+
+		/*
+		* Convex hulls for the physics proxies of the (render visible) mesh objects. Objects named UCX_<Target> or
+		* UCX_<Target>_NN are authored proxies: their hull is built from their own mesh, moved into the local space of the
+		* target. Every other mesh object without authored proxies gets a hull of its mesh. Meshes are extracted once in
+		* parallel, the hulls are built concurrently, the result is in file order.
+		*/
+		std::vector<container::HullData> BuildConvexHulls(const HullOptions& options = {}) const
+		{
+			const size_t offsetOfData = GetFieldOffset("Object", "*data");
+
+			struct HullJob
+			{
+				size_t obBlockId;
+				size_t meshBlockId;
+				std::optional<size_t> targetBlockId; // proxies only
+			};
+
+			std::map<std::string_view, size_t> objectsByName;
+			std::vector<HullJob> jobs;
+			for(size_t i=0; i<m_blockArray.size(); ++i)
+			{
+				const auto& block = m_blockArray.at(i);
+				if(!Identify(block.desc.code, blender::BlockOB, 4))
+					continue;
+
+				objectsByName.emplace(GetBlockNameByID(block, true), i);
+				if(!IsObjectRenderVisible(block.desc.oldMemoryAddress))
+					continue;
+
+				const auto dataBlockId = FindBlockIdByOldAddr(PeekField<blender::PtrType>(block, offsetOfData));
+				if(dataBlockId.has_value() && Identify(m_blockArray.at(dataBlockId.value()).desc.code, blender::BlockME, 4))
+					jobs.emplace_back(HullJob{ i, dataBlockId.value(), {} });
+			}
+
+			// resolve the proxies' targets, objects with authored proxies don't get a generated hull
+			std::unordered_set<size_t> hasProxy;
+			for(HullJob& job: jobs)
+			{
+				const std::string_view name = GetBlockNameByID(m_blockArray.at(job.obBlockId), true);
+				if(!name.starts_with(ProxyPrefix))
+					continue;
+
+				// UCX_<Target>, or UCX_<Target>_NN unless an object is named <Target>_NN itself
+				const std::string_view targetName = name.substr(ProxyPrefix.size());
+				auto target = objectsByName.find(targetName);
+				if(target == objectsByName.end())
+					target = objectsByName.find(StripProxyIndex(targetName));
+
+				if(target == objectsByName.end())
+				{
+					std::cout << "WARNING - no target object for collision proxy " << name << "!\n";
+					continue;
+				}
+
+				job.targetBlockId = target->second;
+				hasProxy.insert(target->second);
+			}
+
+			std::erase_if(jobs, [&](const HullJob& job)
+			{
+				const bool orphanProxy = !job.targetBlockId.has_value() && GetBlockNameByID(m_blockArray.at(job.obBlockId), true).starts_with(ProxyPrefix);
+				return orphanProxy || hasProxy.contains(job.obBlockId);
+			});
+
+			std::vector<size_t> meshBlockIds;
+			for(const HullJob& job: jobs)
+				meshBlockIds.emplace_back(job.meshBlockId);
+
+			std::sort(meshBlockIds.begin(), meshBlockIds.end());
+			meshBlockIds.erase(std::unique(meshBlockIds.begin(), meshBlockIds.end()), meshBlockIds.end());
+
+			std::vector<std::vector<blender::Float3>> meshPositions(meshBlockIds.size());
+			std::transform(std::execution::par, meshBlockIds.begin(), meshBlockIds.end(), meshPositions.begin(), [this](size_t meshBlockId)
+			{
+				blendMesh mesh;
+				ExtractMeshData(meshBlockId, mesh);
+				mesh.Validate(MeshRepair::Drop);
+				return mesh.Positions();
+			});
+
+			const convexHullBuilder builder(options);
+			std::vector<container::HullData> hulls(jobs.size());
+			std::transform(std::execution::par, jobs.begin(), jobs.end(), hulls.begin(), [&](const HullJob& job)
+			{
+				const auto& obBlock = m_blockArray.at(job.obBlockId);
+				const size_t meshIndex = std::lower_bound(meshBlockIds.begin(), meshBlockIds.end(), job.meshBlockId) - meshBlockIds.begin();
+
+				container::HullData data{ std::string(GetBlockNameByID(obBlock, true)), {}, 0, {} };
+				if(!job.targetBlockId.has_value())
+				{
+					data.target = data.name;
+					data.hull = builder.Build(meshPositions[meshIndex]);
+					return data;
+				}
+
+				const auto& targetBlock = m_blockArray.at(job.targetBlockId.value());
+				data.target = GetBlockNameByID(targetBlock, true);
+				data.flags = container::HullProxy;
+
+				// proxy local -> world -> target local
+				const auto proxyWorld = GetObjectWorldMatrix(obBlock);
+				const auto targetWorld = GetObjectWorldMatrix(targetBlock);
+				blender::Float4x4 targetInverse;
+				if(!proxyWorld.has_value() || !targetWorld.has_value() || !blender::InvertAffine(targetInverse, targetWorld.value()))
+				{
+					data.hull = builder.Build(meshPositions[meshIndex]);
+					return data;
+				}
+
+				std::vector<blender::Float3> points(meshPositions[meshIndex].size());
+				std::transform(meshPositions[meshIndex].begin(), meshPositions[meshIndex].end(), points.begin(), [&](const blender::Float3& p)
+				{
+					return blender::TransformPoint(targetInverse, blender::TransformPoint(proxyWorld.value(), p));
+				});
+
+				data.hull = builder.Build(points);
+				return data;
+			});
+
+			return hulls;
+		}
+
+		bool ExportConvexHulls(const std::filesystem::path& path, const HullOptions& options = {}) const
+		{
+			const auto hulls = BuildConvexHulls(options);
+
+			size_t proxies = 0, degenerate = 0;
+			for(const container::HullData& hull: hulls)
+			{
+				proxies += (hull.flags & container::HullProxy) != 0;
+				degenerate += hull.hull.vertices.empty();
+			}
+
+			std::cout << "Convex hulls: " << hulls.size() << " proxies: " << proxies << " flat or degenerate: " << degenerate << '\n';
+			if(!container::WriteHulls(path, hulls))
+			{
+				std::cout << "ERROR - failed to write " << path.string() << "!\n";
+				return false;
+			}
+
+			return true;
+		}
+
+		std::optional<size_t> FindObjectByName(std::string_view name) const
+		{
+			for(size_t i=0; i<m_blockArray.size(); ++i)
+			{
+				const auto& block = m_blockArray.at(i);
+				if(Identify(block.desc.code, blender::BlockOB, 4) && GetBlockNameByID(block, true) == name)
+					return { i };
+			}
+
+			return {};
+		}
+
+		std::optional<size_t> FindMeshByName(std::string_view name) const
+		{
+			for(size_t i=0; i<m_blockArray.size(); ++i)
+			{
+				const auto& block = m_blockArray.at(i);
+				if(Identify(block.desc.code, blender::BlockME, 4) && GetBlockNameByID(block, true) == name)
+					return { i };
+			}
+
+			return {};
+		}
+
+		/*
+		* Bones of the armature object's data (Bone DATA blocks after the AR block), parents first, with the values of the
+		* object's pose channels as saved.
+		*/
+		std::optional<anim::Skeleton> ExtractSkeleton(const blender::FileBlock& armatureObBlock) const
+		{
+			const auto armatureBlockId = FindBlockIdByOldAddr(PeekField<blender::PtrType>(armatureObBlock, GetFieldOffset("Object", "*data")));
+			if(!armatureBlockId.has_value() || !Identify(m_blockArray.at(armatureBlockId.value()).desc.code, blender::BlockAR, 4))
+				return {};
+
+			const size_t offsetOfName = GetFieldOffset("Bone", "name[64]");
+			const size_t offsetOfParent = GetFieldOffset("Bone", "*parent");
+			const size_t offsetOfArmMat = GetFieldOffset("Bone", "arm_mat[4][4]");
+
+			std::vector<anim::Bone> bones;
+			std::vector<blender::PtrType> boneAddrs, parentAddrs;
+			for(size_t nextBlock=armatureBlockId.value() + 1; nextBlock<m_blockArray.size(); ++nextBlock)
+			{
+				const auto& dataFileBlock = m_blockArray.at(nextBlock);
+				if(!Identify(dataFileBlock.desc.code, "DATA", 4))
+					break;
+
+				if(!IdentifyStruct(dataFileBlock.desc.sdnaIndex, "Bone"))
+					continue;
+
+				anim::Bone bone;
+				bone.name = ReadName(dataFileBlock, offsetOfName);
+				bone.rest = PeekField<blender::Float4x4>(dataFileBlock, offsetOfArmMat);
+				bone.length = ReadField<float>(dataFileBlock, "Bone", "length").value_or(0.0f);
+				bones.emplace_back(std::move(bone));
+				boneAddrs.emplace_back(dataFileBlock.desc.oldMemoryAddress);
+				parentAddrs.emplace_back(PeekField<blender::PtrType>(dataFileBlock, offsetOfParent));
+			}
+
+			// parents before children: order by depth
+			std::vector<int32_t> parents(bones.size(), -1);
+			std::vector<uint32_t> depths(bones.size(), 0);
+			for(size_t i=0; i<bones.size(); ++i)
+			{
+				const auto parent = std::find(boneAddrs.begin(), boneAddrs.end(), parentAddrs[i]);
+				if(parentAddrs[i] != 0 && parent != boneAddrs.end())
+					parents[i] = int32_t(parent - boneAddrs.begin());
+			}
+
+			for(size_t i=0; i<bones.size(); ++i)
+			{
+				for(int32_t p=parents[i]; p >= 0 && depths[i] <= bones.size(); p=parents[p])
+					depths[i]++;
+			}
+
+			std::vector<uint32_t> order(bones.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return depths[a] < depths[b]; });
+
+			std::vector<int32_t> newIndex(bones.size());
+			for(size_t i=0; i<order.size(); ++i)
+				newIndex[order[i]] = int32_t(i);
+
+			anim::Skeleton skeleton;
+			for(uint32_t oldIndex: order)
+			{
+				anim::Bone& bone = skeleton.bones.emplace_back(std::move(bones[oldIndex]));
+				bone.parent = (parents[oldIndex] >= 0 ? newIndex[parents[oldIndex]] : -1);
+				if(!blender::InvertAffine(bone.restInverse, bone.rest))
+				{
+					std::cout << "ERROR - bone " << bone.name << " has a singular rest matrix!\n";
+					return {};
+				}
+
+				bone.restRelative = (bone.parent >= 0 ? blender::Multiply(skeleton.bones[bone.parent].restInverse, bone.rest) : bone.rest);
+			}
+
+			// pose channels, by bone name
+			const auto poseBlock = FindFileBlockByOldAddr(PeekField<blender::PtrType>(armatureObBlock, GetFieldOffset("Object", "*pose")));
+			if(!poseBlock.has_value())
+				return skeleton;
+
+			const auto chanbase = PeekField<blender::ListBase>(*poseBlock, GetFieldOffset("bPose", "chanbase"));
+			ForEachListItem(chanbase.first, [&](const blender::FileBlock& channelBlock)
+			{
+				const auto bone = skeleton.Find(ReadName(channelBlock, GetFieldOffset("bPoseChannel", "name[64]")));
+				if(!bone.has_value())
+					return;
+
+				anim::ChannelValues& channel = skeleton.bones[bone.value()].channel;
+				ReadFieldArray(channelBlock, "bPoseChannel", "loc[3]", channel.location);
+				ReadFieldArray(channelBlock, "bPoseChannel", "scale[3]", channel.scale);
+				ReadFieldArray(channelBlock, "bPoseChannel", "quat[4]", channel.quaternion);
+				ReadFieldArray(channelBlock, "bPoseChannel", "eul[3]", channel.euler);
+				float axis[3] = { channel.axisAngle[1], channel.axisAngle[2], channel.axisAngle[3] };
+				ReadFieldArray(channelBlock, "bPoseChannel", "rotAxis[3]", axis);
+				std::copy(std::begin(axis), std::end(axis), channel.axisAngle + 1);
+				channel.axisAngle[0] = ReadField<float>(channelBlock, "bPoseChannel", "rotAngle").value_or(0.0f);
+				channel.rotationMode = ReadField<int16_t>(channelBlock, "bPoseChannel", "rotmode").value_or(anim::RotationQuaternion);
+				skeleton.bones[bone.value()].constraints = ExtractConstraints(channelBlock, armatureObBlock, skeleton);
+			});
+
+			return skeleton;
+		}
+
+		/*
+		* Constraints of a pose channel which anim::constraintSolver evaluates: IK (copy pose type), Copy Rotation, Damped
+		* Track and Child Of, in world or pose space, targeting bones of the same armature or objects (fixed at their saved
+		* matrix). Others are reported and skipped, muted and invalid ones skipped.
+		*/
+		std::vector<anim::Constraint> ExtractConstraints(const blender::FileBlock& channelBlock, const blender::FileBlock& armatureObBlock, const anim::Skeleton& skeleton) const
+		{
+			std::vector<anim::Constraint> constraints;
+			const auto list = ReadField<blender::ListBase>(channelBlock, "bPoseChannel", "constraints");
+			if(!list.has_value())
+				return constraints;
+
+			blender::Float4x4 armatureInverse = blender::Identity();
+			if(const auto armatureWorld = GetObjectWorldMatrix(armatureObBlock); armatureWorld.has_value())
+				blender::InvertAffine(armatureInverse, armatureWorld.value());
+
+			// a bone of this armature, or an object in armature space
+			const auto ResolveTarget = [&](const blender::FileBlock& data, std::string_view sname, std::string_view tarField, std::string_view subtargetField,
+										   int32_t& bone, blender::Float4x4& matrix)
+			{
+				const blender::PtrType tar = ReadField<blender::PtrType>(data, sname, tarField).value_or(0);
+				const auto subtarget = skeleton.Find(ReadName(data, FindFieldOffset(sname, subtargetField).value_or(MissingField)));
+				if(tar != 0 && tar == armatureObBlock.desc.oldMemoryAddress && subtarget.has_value())
+				{
+					bone = int32_t(subtarget.value());
+					return true;
+				}
+
+				const auto tarBlock = FindFileBlockByOldAddr(tar);
+				const auto world = (tarBlock.has_value() ? GetObjectWorldMatrix(tarBlock.value()) : std::optional<blender::Float4x4>{});
+				if(!world.has_value())
+					return false;
+
+				bone = -1;
+				matrix = blender::Multiply(armatureInverse, world.value());
+				return true;
+			};
+
+			const std::string channelName = ReadName(channelBlock, GetFieldOffset("bPoseChannel", "name[64]"));
+			ForEachListItem(list->first, [&](const blender::FileBlock& constraintBlock)
+			{
+				const int16_t type = ReadField<int16_t>(constraintBlock, "bConstraint", "type").value_or(0);
+				const std::string name = ReadName(constraintBlock, GetFieldOffset("bConstraint", "name[64]"));
+				if((ReadFlagField(constraintBlock, "bConstraint", "flag") & (blender::CONSTRAINT_DISABLE | blender::CONSTRAINT_OFF)) != 0)
+					return;
+
+				const auto dataBlock = FindFileBlockByOldAddr(ReadField<blender::PtrType>(constraintBlock, "bConstraint", "*data").value_or(0));
+				if(!dataBlock.has_value())
+					return;
+
+				const auto Skip = [&](std::string_view reason) { std::cout << "WARNING - constraint " << name << " of bone " << channelName << ' ' << reason << ", skipped!\n"; };
+				const uint64_t ownspace = ReadFlagField(constraintBlock, "bConstraint", "ownspace");
+				const uint64_t tarspace = ReadFlagField(constraintBlock, "bConstraint", "tarspace");
+				const bool armatureSpace = (ownspace == blender::CONSTRAINT_SPACE_WORLD || ownspace == blender::CONSTRAINT_SPACE_POSE) &&
+										   (tarspace == blender::CONSTRAINT_SPACE_WORLD || tarspace == blender::CONSTRAINT_SPACE_POSE);
+
+				anim::Constraint c{};
+				c.influence = ReadField<float>(constraintBlock, "bConstraint", "enforce").value_or(1.0f);
+				const blender::FileBlock& data = dataBlock.value();
+
+				switch(type)
+				{
+					case blender::CONSTRAINT_TYPE_KINEMATIC:
+					{
+						if(ReadField<int16_t>(data, "bKinematicConstraint", "type").value_or(blender::CONSTRAINT_IK_TYPE_COPYPOSE) != blender::CONSTRAINT_IK_TYPE_COPYPOSE)
+							return Skip("is a distance IK");
+
+						c.type = anim::ConstraintType::Ik;
+						if(!ResolveTarget(data, "bKinematicConstraint", "*tar", "subtarget[64]", c.target, c.targetMatrix))
+							return Skip("has no target");
+
+						c.chainLength = uint32_t(std::max<int16_t>(ReadField<int16_t>(data, "bKinematicConstraint", "rootbone").value_or(0), 0));
+						c.iterations = uint32_t(std::clamp<int16_t>(ReadField<int16_t>(data, "bKinematicConstraint", "iterations").value_or(64), 1, 256));
+						c.useTip = (ReadFlagField(data, "bKinematicConstraint", "flag") & blender::CONSTRAINT_IK_TIP) != 0;
+
+						int32_t pole = -1;
+						if(ReadField<blender::PtrType>(data, "bKinematicConstraint", "*poletar").value_or(0) != 0 &&
+						   ResolveTarget(data, "bKinematicConstraint", "*poletar", "polesubtarget[64]", pole, c.poleMatrix))
+							c.pole = pole;
+						break;
+					}
+					case blender::CONSTRAINT_TYPE_ROTLIKE:
+					{
+						c.type = anim::ConstraintType::CopyRotation;
+						if(!armatureSpace)
+							return Skip("is not in world or pose space");
+
+						if(!ResolveTarget(data, "bRotateLikeConstraint", "*tar", "subtarget[64]", c.target, c.targetMatrix))
+							return Skip("has no target");
+
+						const uint64_t flag = ReadFlagField(data, "bRotateLikeConstraint", "flag");
+						c.axes = uint8_t(flag & 7);
+						c.invert = uint8_t((flag >> 4) & 7);
+						// files before mix_mode have the Offset checkbox, Blender reads it as the legacy offset mode
+						const auto mixMode = ReadField<int8_t>(data, "bRotateLikeConstraint", "mix_mode");
+						const auto mix = (mixMode.has_value() ? anim::RotationMixFromDna(mixMode.value())
+															  : ((flag & blender::ROTLIKE_OFFSET) != 0 ? anim::RotationMix::Offset : anim::RotationMix::Replace));
+						if(!mix.has_value())
+							return Skip("has an unknown mix mode");
+
+						c.mix = mix.value();
+						break;
+					}
+					case blender::CONSTRAINT_TYPE_DAMPTRACK:
+					{
+						c.type = anim::ConstraintType::DampedTrack;
+						if(!ResolveTarget(data, "bDampTrackConstraint", "*tar", "subtarget[64]", c.target, c.targetMatrix))
+							return Skip("has no target");
+
+						c.trackAxis = uint8_t(std::clamp<int32_t>(ReadField<int32_t>(data, "bDampTrackConstraint", "trackflag").value_or(1), 0, 5));
+						break;
+					}
+					case blender::CONSTRAINT_TYPE_CHILDOF:
+					{
+						c.type = anim::ConstraintType::ChildOf;
+						if(!armatureSpace)
+							return Skip("is not in world or pose space");
+
+						if(!ResolveTarget(data, "bChildOfConstraint", "*tar", "subtarget[64]", c.target, c.targetMatrix))
+							return Skip("has no target");
+
+						c.inverse = ReadField<blender::Float4x4>(data, "bChildOfConstraint", "invmat[4][4]").value_or(blender::Identity());
+						break;
+					}
+					default:
+						return Skip("is of an unsupported type");
+				}
+
+				constraints.emplace_back(c);
+			});
+
+			return constraints;
+		}
+
+		// FCurves of a bAction with their BezTriple keys.
+		std::optional<anim::Action> ExtractAction(blender::PtrType actionAddr) const
+		{
+			const auto actionBlock = FindFileBlockByOldAddr(actionAddr);
+			if(!actionBlock.has_value() || !Identify(actionBlock->desc.code, blender::BlockAC, 4))
+				return {};
+
+			const size_t bezTripleSize = GetStructSizeByName("BezTriple");
+			const size_t offsetOfVec = GetFieldOffset("BezTriple", "vec[3][3]");
+			const size_t offsetOfIpo = GetFieldOffset("BezTriple", "ipo");
+
+			anim::Action action;
+			action.name = GetBlockNameByID(actionBlock.value(), true);
+			action.frameStart = std::numeric_limits<float>::max();
+			action.frameEnd = -std::numeric_limits<float>::max();
+
+			const auto curves = PeekField<blender::ListBase>(*actionBlock, GetFieldOffset("bAction", "curves"));
+			ForEachListItem(curves.first, [&](const blender::FileBlock& curveBlock)
+			{
+				anim::FCurve curve;
+				const auto pathBlock = FindFileBlockByOldAddr(PeekField<blender::PtrType>(curveBlock, GetFieldOffset("FCurve", "*rna_path")));
+				if(pathBlock.has_value())
+					curve.rnaPath = ReadName(pathBlock.value(), 0);
+
+				curve.arrayIndex = PeekField<int32_t>(curveBlock, GetFieldOffset("FCurve", "array_index"));
+
+				const auto keysBlock = FindFileBlockByOldAddr(PeekField<blender::PtrType>(curveBlock, GetFieldOffset("FCurve", "*bezt")));
+				const uint32_t totvert = PeekField<uint32_t>(curveBlock, GetFieldOffset("FCurve", "totvert"));
+				if(!keysBlock.has_value() || bezTripleSize == 0 || offsetOfVec == MissingField || offsetOfIpo == MissingField)
+					return;
+
+				const size_t numKeys = std::min<size_t>(totvert, keysBlock->data.Size() / bezTripleSize);
+				for(size_t k=0; k<numKeys; ++k)
+				{
+					float vec[3][3];
+					memcpy(vec, keysBlock->data.Data() + k * bezTripleSize + offsetOfVec, sizeof(vec));
+					const uint8_t ipo = PeekField<uint8_t>(*keysBlock, k * bezTripleSize + offsetOfIpo);
+					curve.keys.emplace_back(anim::BezKey{ vec[1][0], vec[1][1], { vec[0][0], vec[0][1] }, { vec[2][0], vec[2][1] }, ipo });
+				}
+
+				std::stable_sort(curve.keys.begin(), curve.keys.end(), [](const anim::BezKey& a, const anim::BezKey& b) { return a.frame < b.frame; });
+				if(!curve.keys.empty())
+				{
+					action.frameStart = std::min(action.frameStart, curve.keys.front().frame);
+					action.frameEnd = std::max(action.frameEnd, curve.keys.back().frame);
+				}
+
+				action.curves.emplace_back(std::move(curve));
+			});
+
+			if(action.frameStart > action.frameEnd)
+				action.frameStart = action.frameEnd = 0.0f;
+
+			return action;
+		}
+
+		// Action assigned to the AnimData of an ID block (Object, Key...).
+		std::optional<anim::Action> ExtractAssignedAction(const blender::FileBlock& idBlock, const std::string_view sname) const
+		{
+			const auto adtOffset = FindFieldOffset(sname, "*adt");
+			if(!adtOffset.has_value())
+				return {};
+
+			const auto adtBlock = FindFileBlockByOldAddr(PeekField<blender::PtrType>(idBlock, adtOffset.value()));
+			if(!adtBlock.has_value())
+				return {};
+
+			return ExtractAction(PeekField<blender::PtrType>(*adtBlock, GetFieldOffset("AnimData", "*action")));
+		}
+
+		// Armature object deforming a mesh object: its first armature modifier, otherwise an armature parent.
+		std::optional<blender::FileBlock> FindDeformingArmature(const blender::FileBlock& obBlock) const
+		{
+			std::optional<blender::FileBlock> armatureOb;
+			const auto modifiers = PeekField<blender::ListBase>(obBlock, GetFieldOffset("Object", "modifiers"));
+			ForEachListItem(modifiers.first, [&](const blender::FileBlock& modifierBlock)
+			{
+				if(!armatureOb.has_value() && IdentifyStruct(modifierBlock.desc.sdnaIndex, "ArmatureModifierData"))
+					armatureOb = FindFileBlockByOldAddr(PeekField<blender::PtrType>(modifierBlock, GetFieldOffset("ArmatureModifierData", "*object")));
+			});
+
+			if(armatureOb.has_value())
+				return armatureOb;
+
+			const auto parent = FindFileBlockByOldAddr(PeekField<blender::PtrType>(obBlock, GetFieldOffset("Object", "*parent")));
+			if(parent.has_value() && PeekField<blender::OB_TYPE>(*parent, GetFieldOffset("Object", "type")) == blender::OB_TYPE::OB_ARMATURE)
+				return parent;
+
+			return {};
+		}
+
+		/*
+		* Up to 4 bone influences per vertex from the mesh's MDeformVert array, vertex groups matched to bones by name
+		* (Mesh.vertex_group_names, Object.defbase before 3.0). Weights are normalized like the armature modifier does.
+		*/
+		std::vector<anim::SkinInfluence> ExtractSkinWeights(const blender::FileBlock& obBlock, size_t meshBlockId, const anim::Skeleton& skeleton, size_t numVerts) const
+		{
+			std::vector<anim::SkinInfluence> influences(numVerts, anim::SkinInfluence{});
+
+			const auto& meshBlock = m_blockArray.at(meshBlockId);
+			const auto groupNames = (HasField("Mesh", "vertex_group_names") ? PeekField<blender::ListBase>(meshBlock, GetFieldOffset("Mesh", "vertex_group_names"))
+																			  : PeekField<blender::ListBase>(obBlock, GetFieldOffset("Object", "defbase")));
+
+			std::vector<int32_t> groupBones;
+			ForEachListItem(groupNames.first, [&](const blender::FileBlock& groupBlock)
+			{
+				const auto bone = skeleton.Find(ReadName(groupBlock, GetFieldOffset("bDeformGroup", "name[64]")));
+				groupBones.emplace_back(bone.has_value() ? int32_t(bone.value()) : -1);
+			});
+
+			const size_t offsetOfDw = GetFieldOffset("MDeformVert", "*dw");
+			const size_t offsetOfTotweight = GetFieldOffset("MDeformVert", "totweight");
+			const size_t offsetOfDefNr = GetFieldOffset("MDeformWeight", "def_nr");
+			const size_t offsetOfWeight = GetFieldOffset("MDeformWeight", "weight");
+			const size_t deformVertSize = GetStructSizeByName("MDeformVert");
+			const size_t deformWeightSize = GetStructSizeByName("MDeformWeight");
+
+			for(size_t nextBlock=meshBlockId + 1; nextBlock<m_blockArray.size(); ++nextBlock)
+			{
+				const auto& dataFileBlock = m_blockArray.at(nextBlock);
+				if(!Identify(dataFileBlock.desc.code, "DATA", 4))
+					break;
+
+				if(!IdentifyStruct(dataFileBlock.desc.sdnaIndex, "MDeformVert") || deformVertSize == 0 || deformWeightSize == 0)
+					continue;
+
+				// the offsets are added to per element bases below, a missing one would wrap around
+				if(offsetOfDw == MissingField || offsetOfTotweight == MissingField || offsetOfDefNr == MissingField || offsetOfWeight == MissingField)
+					break;
+
+				const size_t count = std::min<size_t>({ dataFileBlock.desc.count, numVerts, dataFileBlock.data.Size() / deformVertSize });
+				std::vector<std::pair<float, int32_t>> weights;
+				for(size_t v=0; v<count; ++v)
+				{
+					const size_t base = v * deformVertSize;
+					const auto dwBlock = FindFileBlockByOldAddr(PeekField<blender::PtrType>(dataFileBlock, base + offsetOfDw));
+					if(!dwBlock.has_value())
+						continue;
+
+					const size_t totweight = std::min<size_t>(PeekField<int32_t>(dataFileBlock, base + offsetOfTotweight), dwBlock->data.Size() / deformWeightSize);
+					weights.clear();
+					for(size_t w=0; w<totweight; ++w)
+					{
+						const int32_t group = PeekField<int32_t>(*dwBlock, w * deformWeightSize + offsetOfDefNr);
+						const float weight = PeekField<float>(*dwBlock, w * deformWeightSize + offsetOfWeight);
+						if(group >= 0 && size_t(group) < groupBones.size() && groupBones[group] >= 0 && weight > 0.0f)
+							weights.emplace_back(weight, groupBones[group]);
+					}
+
+					std::sort(weights.begin(), weights.end(), std::greater<>());
+					weights.resize(std::min<size_t>(weights.size(), 4));
+
+					float sum = 0.0f;
+					for(const auto& [weight, bone]: weights)
+						sum += weight;
+
+					for(size_t i=0; i<weights.size(); ++i)
+					{
+						influences[v].bone[i] = uint16_t(weights[i].second);
+						influences[v].weight[i] = weights[i].first / sum;
+					}
+				}
+
+				break;
+			}
+
+			return influences;
+		}
+
+		// Shape keys of a mesh (Mesh.key), with the action of the Key ID driving their values.
+		std::optional<anim::ShapeKeys> ExtractShapeKeys(size_t meshBlockId) const
+		{
+			const auto keyBlock = FindFileBlockByOldAddr(PeekField<blender::PtrType>(m_blockArray.at(meshBlockId), GetFieldOffset("Mesh", "*key")));
+			if(!keyBlock.has_value() || !Identify(keyBlock->desc.code, blender::BlockKE, 4))
+				return {};
+
+			if(ReadField<int16_t>(keyBlock.value(), "Key", "type").value_or(blender::KEY_RELATIVE) != blender::KEY_RELATIVE)
+			{
+				std::cout << "WARNING - absolute shape keys of " << GetBlockNameByID(keyBlock.value(), true) << " are not supported!\n";
+				return {};
+			}
+
+			anim::ShapeKeys keys;
+			const auto blocks = PeekField<blender::ListBase>(*keyBlock, GetFieldOffset("Key", "block"));
+			ForEachListItem(blocks.first, [&](const blender::FileBlock& kb)
+			{
+				anim::ShapeKeys::Block block;
+				block.name = ReadName(kb, GetFieldOffset("KeyBlock", "name[64]"));
+				block.value = PeekField<float>(kb, GetFieldOffset("KeyBlock", "curval"));
+				block.relative = PeekField<int16_t>(kb, GetFieldOffset("KeyBlock", "relative"));
+				block.sliderMin = ReadField<float>(kb, "KeyBlock", "slidermin").value_or(0.0f);
+				block.sliderMax = ReadField<float>(kb, "KeyBlock", "slidermax").value_or(1.0f);
+
+				const auto dataBlock = FindFileBlockByOldAddr(PeekField<blender::PtrType>(kb, GetFieldOffset("KeyBlock", "*data")));
+				const size_t totelem = PeekField<int32_t>(kb, GetFieldOffset("KeyBlock", "totelem"));
+				if(dataBlock.has_value())
+				{
+					block.positions.resize(std::min(totelem, dataBlock->data.Size() / sizeof(blender::Float3)));
+					memcpy(block.positions.data(), dataBlock->data.Data(), block.positions.size() * sizeof(blender::Float3));
+				}
+
+				keys.blocks.emplace_back(std::move(block));
+			});
+
+			if(keys.blocks.empty())
+				return {};
+
+			if(auto action = ExtractAssignedAction(keyBlock.value(), "Key"); action.has_value())
+				keys.action = std::move(action.value());
+
+			keys.Bind();
+			return keys;
+		}
+
+		/*
+		* Bakes the deformation of a mesh object - shape keys, then its armature - for every frame into vertex animation
+		* textures (see container::WriteVat). Frames default to the keyed range of the armature and shape key actions,
+		* they are deformed in parallel.
+		*/
+		bool BakeVertexAnimation(std::string_view objectName, const std::filesystem::path& path, const VatOptions& options = {}) const
+		{
+			const auto obBlockId = FindObjectByName(objectName);
+			if(!obBlockId.has_value())
+			{
+				std::cout << "ERROR - no object named " << objectName << "!\n";
+				return false;
+			}
+
+			const auto& obBlock = m_blockArray.at(obBlockId.value());
+			const auto meshBlockId = FindBlockIdByOldAddr(PeekField<blender::PtrType>(obBlock, GetFieldOffset("Object", "*data")));
+			if(!meshBlockId.has_value() || !Identify(m_blockArray.at(meshBlockId.value()).desc.code, blender::BlockME, 4))
+			{
+				std::cout << "ERROR - object " << objectName << " has no mesh!\n";
+				return false;
+			}
+
+			blendMesh mesh;
+			ExtractMeshData(meshBlockId.value(), mesh);
+			mesh.Validate(MeshRepair::Drop);
+			const std::vector<blender::Float3> rest = mesh.Positions();
+			const std::vector<uint32_t> indices = mesh.Triangulate();
+			if(rest.empty())
+			{
+				std::cout << "ERROR - mesh of " << objectName << " has no vertex positions!\n";
+				return false;
+			}
+
+			auto shapeKeys = ExtractShapeKeys(meshBlockId.value());
+			if(shapeKeys.has_value() && shapeKeys->blocks.front().positions.size() != rest.size())
+			{
+				std::cout << "WARNING - shape keys of " << objectName << " don't match its vertices, ignored!\n";
+				shapeKeys.reset();
+			}
+
+			const auto armatureOb = FindDeformingArmature(obBlock);
+			std::optional<anim::Skeleton> skeleton;
+			std::optional<anim::Action> armatureAction;
+			std::vector<anim::SkinInfluence> influences;
+			blender::Float4x4 premat = blender::Identity(), postmat = blender::Identity();
+			if(armatureOb.has_value())
+			{
+				skeleton = ExtractSkeleton(armatureOb.value());
+				armatureAction = ExtractAssignedAction(armatureOb.value(), "Object");
+				if(skeleton.has_value())
+					influences = ExtractSkinWeights(obBlock, meshBlockId.value(), skeleton.value(), rest.size());
+
+				// mesh local -> armature local and back
+				const auto meshWorld = GetObjectWorldMatrix(obBlock);
+				const auto armatureWorld = GetObjectWorldMatrix(armatureOb.value());
+				blender::Float4x4 armatureInverse;
+				if(meshWorld.has_value() && armatureWorld.has_value() && blender::InvertAffine(armatureInverse, armatureWorld.value()))
+				{
+					premat = blender::Multiply(armatureInverse, meshWorld.value());
+					if(!blender::InvertAffine(postmat, premat))
+						premat = postmat = blender::Identity();
+				}
+			}
+
+			if(!skeleton.has_value() && !shapeKeys.has_value())
+			{
+				std::cout << "ERROR - object " << objectName << " has no armature or shape keys to bake!\n";
+				return false;
+			}
+
+			float frameStart = std::numeric_limits<float>::max(), frameEnd = -std::numeric_limits<float>::max();
+			for(const anim::Action* action: { armatureAction.has_value() ? &armatureAction.value() : nullptr, shapeKeys.has_value() ? &shapeKeys->action : nullptr })
+			{
+				if(action != nullptr && !action->curves.empty())
+				{
+					frameStart = std::min(frameStart, action->frameStart);
+					frameEnd = std::max(frameEnd, action->frameEnd);
+				}
+			}
+
+			if(frameStart > frameEnd)
+				frameStart = frameEnd = 0.0f;
+
+			frameStart = options.frameStart.value_or(frameStart);
+			frameEnd = options.frameEnd.value_or(frameEnd);
+
+			container::VatData vat;
+			vat.numVerts = uint32_t(rest.size());
+			vat.numFrames = anim::FrameCount(frameStart, frameEnd, options.frameStep);
+			vat.width = std::min<uint32_t>(vat.numVerts, std::max<uint32_t>(options.maxWidth, 1));
+			vat.frameStart = frameStart;
+			vat.frameStep = options.frameStep;
+			vat.offsets.resize(size_t(vat.numVerts) * vat.numFrames);
+			vat.normals.resize(vat.offsets.size());
+
+			anim::SampledClip clip;
+			if(skeleton.has_value())
+				clip = anim::SampleClip(skeleton.value(), armatureAction.value_or(anim::Action{}), frameStart, frameEnd, options.frameStep);
+
+			std::vector<uint32_t> frames(vat.numFrames);
+			std::iota(frames.begin(), frames.end(), 0);
+			std::for_each(std::execution::par, frames.begin(), frames.end(), [&](uint32_t f)
+			{
+				std::vector<blender::Float3> positions, normals;
+				if(shapeKeys.has_value())
+					shapeKeys->Evaluate(frameStart + f * options.frameStep, positions);
+				else
+					positions = rest;
+
+				if(skeleton.has_value())
+				{
+					std::vector<blender::Float4x4> skinMatrices(skeleton->bones.size());
+					skeleton->SkinMatrices(clip.Frame(f), skinMatrices.data());
+					for(blender::Float4x4& m: skinMatrices)
+						m = blender::Multiply(postmat, blender::Multiply(m, premat));
+
+					std::vector<blender::Float3> skinned;
+					anim::Skin(positions, influences, skinMatrices, skinned);
+					positions.swap(skinned);
+				}
+
+				anim::VertexNormals(positions, indices, normals);
+
+				const size_t base = size_t(f) * vat.numVerts;
+				for(size_t v=0; v<positions.size(); ++v)
+				{
+					vat.offsets[base + v] = blender::Float3{ positions[v].x - rest[v].x, positions[v].y - rest[v].y, positions[v].z - rest[v].z };
+					vat.normals[base + v] = normals[v];
+				}
+			});
+
+			std::cout << "Vertex animation " << objectName << ": " << vat.numVerts << " vertices, " << vat.numFrames << " frames from " << frameStart
+					  << (skeleton.has_value() ? ", " + std::to_string(skeleton->bones.size()) + " bones" : "")
+					  << (shapeKeys.has_value() ? ", " + std::to_string(shapeKeys->blocks.size() - 1) + " shape keys" : "") << '\n';
+
+			if(!container::WriteVat(path, vat, options.encoding == VatEncoding::Rgbm))
+			{
+				std::cout << "ERROR - failed to write " << path.string() << "!\n";
+				return false;
+			}
+
+			return true;
+		}
+
+		// Armature object of a character: the object itself, or the armature deforming a mesh object of that name.
+		std::optional<blender::FileBlock> FindCharacterArmature(std::string_view objectName) const
+		{
+			const auto obBlockId = FindObjectByName(objectName);
+			if(!obBlockId.has_value())
+				return {};
+
+			const auto& obBlock = m_blockArray.at(obBlockId.value());
+			if(PeekField<blender::OB_TYPE>(obBlock, GetFieldOffset("Object", "type")) == blender::OB_TYPE::OB_ARMATURE)
+				return { obBlock };
+
+			return FindDeformingArmature(obBlock);
+		}
+
+		std::optional<anim::Skeleton> ExtractCharacterSkeleton(std::string_view characterName) const
+		{
+			const auto armatureOb = FindCharacterArmature(characterName);
+			auto skeleton = (armatureOb.has_value() ? ExtractSkeleton(armatureOb.value()) : std::optional<anim::Skeleton>{});
+			if(skeleton.has_value() && skeleton->bones.empty())
+				return {};
+
+			return skeleton;
+		}
+
+		// Actions with FCurves driving bones of the skeleton, the clips of a character.
+		std::vector<anim::Action> FindSkeletonActions(const anim::Skeleton& skeleton) const
+		{
+			std::vector<anim::Action> actions;
+			for(const auto& block: m_blockArray)
+			{
+				if(!Identify(block.desc.code, blender::BlockAC, 4))
+					continue;
+
+				auto action = ExtractAction(block.desc.oldMemoryAddress);
+				if(action.has_value() && !anim::BindAction(skeleton, action.value()).empty())
+					actions.emplace_back(std::move(action.value()));
+			}
+
+			return actions;
+		}
+
+		/*
+		* Bakes every clip of a character into a bone matrix atlas (see container::WriteBoneAtlas): the armature space
+		* skinning matrices (pose * rest^-1) of each sampled frame. Clips are baked in parallel, their frames too. With
+		* extractRootMotion the root bone's planar motion is taken out of the clips, all of them in one batch. With a
+		* retargetSource the clips are those of the source character, retargeted onto this one (anim::Retarget).
+		*/
+		bool BakeBoneAtlas(std::string_view characterName, const std::filesystem::path& path, const BoneAtlasOptions& options = {}) const
+		{
+			const auto skeleton = ExtractCharacterSkeleton(characterName);
+			if(!skeleton.has_value())
+			{
+				std::cout << "ERROR - no armature for " << characterName << "!\n";
+				return false;
+			}
+
+			const bool retarget = !options.retargetSource.empty();
+			const std::string_view clipSource = (retarget ? std::string_view(options.retargetSource) : characterName);
+			const auto sourceSkeleton = (retarget ? ExtractCharacterSkeleton(clipSource) : skeleton);
+			if(!sourceSkeleton.has_value())
+			{
+				std::cout << "ERROR - no armature for " << clipSource << "!\n";
+				return false;
+			}
+
+			const std::vector<anim::Action> actions = FindSkeletonActions(sourceSkeleton.value());
+			if(actions.empty())
+			{
+				std::cout << "ERROR - no action animates the bones of " << clipSource << "!\n";
+				return false;
+			}
+
+			const size_t numBones = skeleton->bones.size();
+			container::BoneAtlasData atlas;
+			atlas.width = uint32_t(std::min<size_t>(numBones * 3, std::max<uint32_t>(options.maxWidth, 3)));
+			for(const anim::Bone& bone: skeleton->bones)
+			{
+				atlas.boneNames.emplace_back(bone.name);
+				atlas.boneParents.emplace_back(bone.parent);
+			}
+
+			std::vector<anim::SampledClip> sampled(actions.size());
+			std::transform(std::execution::par, actions.begin(), actions.end(), sampled.begin(), [&](const anim::Action& action)
+			{
+				return anim::SampleClip(sourceSkeleton.value(), action, action.frameStart, action.frameEnd, options.frameStep);
+			});
+
+			if(retarget)
+			{
+				std::vector<anim::BoneMapping> mappings;
+				if(!options.boneMap.empty())
+				{
+					auto fileMappings = anim::ReadBoneMap(options.boneMap);
+					if(!fileMappings.has_value())
+						return false;
+
+					mappings = std::move(fileMappings.value());
+				}
+
+				const anim::RetargetMap map = anim::BuildRetargetMap(sourceSkeleton.value(), skeleton.value(), mappings);
+				if(map.NumMapped() == 0)
+				{
+					std::cout << "ERROR - no bone of " << clipSource << " maps to a bone of " << characterName << "!\n";
+					return false;
+				}
+
+				std::cout << "Retargeting " << clipSource << " -> " << characterName << ": " << map.NumMapped() << " of " << skeleton->bones.size()
+						  << " bones mapped, height ratio " << map.heightRatio << '\n';
+				sampled = anim::Retarget(skeleton.value(), map, sampled);
+			}
+
+			std::vector<anim::RootMotionTrack> rootMotion;
+			if(options.extractRootMotion)
+				rootMotion = anim::ExtractRootMotion(skeleton.value(), anim::FindRootBone(skeleton.value()).value(), sampled);
+
+			atlas.clips.resize(sampled.size());
+			std::transform(std::execution::par, sampled.begin(), sampled.end(), atlas.clips.begin(), [&](const anim::SampledClip& clip)
+			{
+				container::BoneClipData data{ clip.name, clip.frameStart, clip.frameStep, clip.numFrames, {}, {} };
+				data.skin.resize(size_t(clip.numFrames) * numBones);
+
+				std::vector<uint32_t> frames(clip.numFrames);
+				std::iota(frames.begin(), frames.end(), 0);
+				std::for_each(std::execution::par, frames.begin(), frames.end(), [&](uint32_t f)
+				{
+					skeleton->SkinMatrices(clip.Frame(f), data.skin.data() + size_t(f) * numBones);
+				});
+
+				return data;
+			});
+
+			for(size_t c=0; c<rootMotion.size(); ++c)
+				atlas.clips[c].rootMotion = std::move(rootMotion[c].frames);
+
+			size_t frames = 0;
+			for(const container::BoneClipData& clip: atlas.clips)
+				frames += clip.numFrames;
+
+			std::cout << "Bone atlas " << characterName << ": " << numBones << " bones, " << atlas.clips.size() << " clips, " << frames << " frames\n";
+
+			if(!container::WriteBoneAtlas(path, atlas, options.halfFloat))
+			{
+				std::cout << "ERROR - failed to write " << path.string() << "!\n";
+				return false;
+			}
+
+			return true;
+		}
+
+		/*
+		* Checks the pose evaluation - action, hierarchy and constraints - against Blender: the character is posed at the
+		* active scene's current frame and compared to the pose matrices saved with its channels (bPoseChannel.pose_mat).
+		*/
+		bool ValidatePose(std::string_view characterName, float tolerance = 1e-3f) const
+		{
+			const auto armatureOb = FindCharacterArmature(characterName);
+			const auto skeleton = (armatureOb.has_value() ? ExtractSkeleton(armatureOb.value()) : std::optional<anim::Skeleton>{});
+			if(!skeleton.has_value() || skeleton->bones.empty())
+			{
+				std::cout << "ERROR - no armature for " << characterName << "!\n";
+				return false;
+			}
+
+			const auto poseBlock = FindFileBlockByOldAddr(PeekField<blender::PtrType>(*armatureOb, GetFieldOffset("Object", "*pose")));
+			const auto poseMatOffset = FindFieldOffset("bPoseChannel", "pose_mat[4][4]");
+			if(!poseBlock.has_value() || !poseMatOffset.has_value())
+			{
+				std::cout << "ERROR - " << characterName << " has no saved pose!\n";
+				return false;
+			}
+
+			float frame = 0.0f;
+			const auto sceneBlockId = GetActiveSceneBlockId();
+			const auto renderDataOffset = FindFieldOffset("Scene", "r");
+			const auto cfraOffset = FindFieldOffset("RenderData", "cfra");
+			if(sceneBlockId.has_value() && renderDataOffset.has_value() && cfraOffset.has_value())
+				frame = float(PeekField<int32_t>(m_blockArray.at(sceneBlockId.value()), renderDataOffset.value() + cfraOffset.value()));
+
+			const anim::Action action = ExtractAssignedAction(armatureOb.value(), "Object").value_or(anim::Action{});
+			std::vector<anim::BoneTransform> locals(skeleton->bones.size());
+			std::vector<blender::Float4x4> pose(skeleton->bones.size());
+			anim::EvaluatePose(skeleton.value(), action, anim::BindAction(skeleton.value(), action), frame, locals.data());
+			skeleton->PoseMatrices(locals.data(), pose.data());
+
+			size_t numConstraints = 0, numChecked = 0, numOff = 0;
+			float maxError = 0.0f;
+			for(const anim::Bone& bone: skeleton->bones)
+				numConstraints += bone.constraints.size();
+
+			const auto chanbase = PeekField<blender::ListBase>(*poseBlock, GetFieldOffset("bPose", "chanbase"));
+			ForEachListItem(chanbase.first, [&](const blender::FileBlock& channelBlock)
+			{
+				const std::string name = ReadName(channelBlock, GetFieldOffset("bPoseChannel", "name[64]"));
+				const auto bone = skeleton->Find(name);
+				if(!bone.has_value())
+					return;
+
+				const auto saved = PeekField<blender::Float4x4>(channelBlock, poseMatOffset.value());
+				float error = 0.0f;
+				for(int col=0; col<4; ++col)
+				{
+					for(int row=0; row<4; ++row)
+						error = std::max(error, std::abs(saved.m[col][row] - pose[bone.value()].m[col][row]));
+				}
+
+				numChecked++;
+				maxError = std::max(maxError, error);
+				if(error > tolerance)
+				{
+					std::cout << "  " << name << " off by " << error << (skeleton->bones[bone.value()].constraints.empty() ? "" : " (constrained)") << '\n';
+					numOff++;
+				}
+			});
+
+			std::cout << "Pose of " << characterName << " at frame " << frame << ": " << numChecked << " bones, " << numConstraints << " constraints, "
+					  << numOff << " off, max error " << maxError << '\n';
+			return numOff == 0;
+		}
+
+		/*
+		* Extracts every (render visible) mesh and writes its positions and triangles into the shared arena - one copy out
+		* of the extracted arrays, the consumer reads them in place - then publishes a Positions and an Indices entry per mesh.
+		*/
+		size_t PublishMeshes(shm::sharedArena& arena, shm::doorbell& bell) const
+		{
+			const size_t offsetOfData = GetFieldOffset("Object", "*data");
+
+			std::vector<size_t> meshBlockIds;
+			for(const auto& block: m_blockArray)
+			{
+				if(!Identify(block.desc.code, blender::BlockOB, 4) || !IsObjectRenderVisible(block.desc.oldMemoryAddress))
+					continue;
+
+				const auto dataBlockId = FindBlockIdByOldAddr(PeekField<blender::PtrType>(block, offsetOfData));
+				if(dataBlockId.has_value() && Identify(m_blockArray.at(dataBlockId.value()).desc.code, blender::BlockME, 4))
+					meshBlockIds.emplace_back(dataBlockId.value());
+			}
+
+			std::sort(meshBlockIds.begin(), meshBlockIds.end());
+			meshBlockIds.erase(std::unique(meshBlockIds.begin(), meshBlockIds.end()), meshBlockIds.end());
+
+			size_t published = 0;
+			for(const size_t meshBlockId: meshBlockIds)
+			{
+				blendMesh mesh;
+				ExtractMeshData(meshBlockId, mesh);
+				mesh.Validate(MeshRepair::Drop);
+
+				const std::string_view name = GetBlockNameByID(m_blockArray.at(meshBlockId), true);
+
+				uint64_t positionsOffset = 0;
+				blender::Float3* positions = arena.Allocate<blender::Float3>(mesh.Verts().size(), positionsOffset);
+
+				std::vector<size_t> firstTri;
+				const size_t numIndices = mesh.CountTriangles(firstTri) * 3;
+				uint64_t indicesOffset = 0;
+				uint32_t* indices = arena.Allocate<uint32_t>(numIndices, indicesOffset);
+
+				if(positions == nullptr || indices == nullptr)
+				{
+					std::cout << "ERROR - shared arena is full at mesh " << name << "!\n";
+					break;
+				}
+
+				mesh.WritePositions(positions);
+				mesh.WriteTriangles(firstTri, indices);
+
+				// a consumer a whole table or ring behind is waited for (back-pressure), only one that hung up or stalled stops the handoff
+				if(!shm::PublishEntry(arena, bell, name, shm::EntryKind::Positions, uint32_t(mesh.Verts().size()), positionsOffset, mesh.Verts().size() * sizeof(blender::Float3)) ||
+				   !shm::PublishEntry(arena, bell, name, shm::EntryKind::Indices, uint32_t(numIndices), indicesOffset, numIndices * sizeof(uint32_t)))
+				{
+					std::cout << "ERROR - shared memory consumer stopped taking entries at mesh " << name << "!\n";
+					break;
+				}
+
+				bell.Ring();
+				published++;
+			}
+
+			arena.Header()->closed.store(1, std::memory_order_release);
+			bell.Ring();
+			return published;
+		}
+
+		// Producer end of the handoff: 'channel' is the socket path on POSIX, the mapping/event name prefix on Windows.
+		bool ServeSharedMeshes(const std::string& channel, size_t arenaCapacity)
+		{
+			shm::sharedArena arena;
+			shm::doorbell bell;
+
+#if defined(_WIN32)
+			const bool ready = arena.Create(arenaCapacity, channel + "_arena") && bell.Create(channel + "_bell");
+#else
+			const bool ready = arena.Create(arenaCapacity, "blendexpl") && bell.Accept(channel, arena.Descriptor());
+#endif
+			if(!ready)
+			{
+				std::cout << "ERROR - could not set up the shared memory handoff!\n";
+				return false;
+			}
+
+			const size_t published = PublishMeshes(arena, bell);
+			std::cout << "Published meshes: " << published << " arena bytes: " << arena.Header()->allocated.load() << '\n';
+
+#if defined(_WIN32)
+			// the mapping goes away with its last handle: keep ours until the consumer has opened it and released every entry
+			const shm::ArenaHeader* header = arena.Header();
+			if(!shm::WaitForConsumer(arena, bell, [&]() { return header->releasedEntries.load(std::memory_order_acquire) == header->numEntries.load(std::memory_order_relaxed); }))
+			{
+				std::cout << "ERROR - no shared memory consumer took the meshes!\n";
+				return false;
+			}
+#endif
+			return true;
+		}
+
+		/*
+		* Version, build and current scene of a file without loading it: the file is mapped, only the block headers are
+		* walked (no SDNA) to reach GLOB, decoded with the fixed FileGlobalHead layout, and the current scene's SC block.
+		* A mapping costs a handful of syscalls, pages holding nothing but payload are never touched.
+		*/
+		static std::optional<BlendFileInfo> QueryFileInfo(const std::string& file)
+		{
+			fileMapping mapping;
+			if(!mapping.Open(file))
+				return {};
+
+			const MemorySpan fileSpan = mapping.Span();
+			MemorySpan memoryStream = fileSpan;
+
+			std::string_view error;
+			const auto format = ReadFileHeader(memoryStream, error);
+			if(!format.has_value())
+				return {};
+
+			BlendFileInfo info;
+			info.version = format->version;
+			info.largeBlockHeaders = (format->blockHeaderSize == sizeof(blender::FileBlockDescLarge64));
+
+			std::optional<blender::FileGlobalHead> global;
+			std::unordered_map<blender::PtrType, MemorySpan> scenes;
+
+			while(!memoryStream.Empty())
+			{
+				const auto desc = ReadBlockDesc(memoryStream, format.value());
+				if(!desc.has_value() || desc->size > memoryStream.Size() || memcmp(desc->code, blender::EOFMark, 4) == 0)
+					break;
+
+				const MemorySpan data{ memoryStream.begin, memoryStream.begin + desc->size };
+				if(memcmp(desc->code, blender::BlockGLOB, 4) == 0 && data.Size() >= sizeof(blender::FileGlobalHead))
+					global = PeekType<blender::FileGlobalHead>(data, 0);
+				else if(memcmp(desc->code, blender::BlockSC, 4) == 0)
+					scenes.emplace(desc->oldMemoryAddress, data);
+
+				memoryStream.Advance(desc->size);
+				memoryStream.Advance(std::min(AlignPadding(memoryStream.begin - fileSpan.begin, format.value()), memoryStream.Size()));
+			}
+
+			if(!global.has_value())
+				return info;
+
+			info.subversion = uint32_t(global->subversion);
+			info.minVersion = uint32_t(global->minversion);
+			info.minSubversion = uint32_t(global->minsubversion);
+			info.fileFlags = uint32_t(global->fileflags);
+			info.globalFlags = uint32_t(global->globalf);
+			info.buildCommitTimestamp = global->buildCommitTimestamp;
+			info.buildHash.assign(global->buildHash, strnlen(global->buildHash, sizeof(global->buildHash)));
+
+			// ID.name sits after a few pointers, how many depends on the version: find its "SC" code prefix. Its length
+			// comes from the version too, the SDNA isn't read.
+			const size_t nameLength = blender::IdNameLength(info.version);
+			const auto scene = scenes.find(global->curscene);
+			if(scene != scenes.end())
+			{
+				const MemorySpan& data = scene->second;
+				for(size_t offset=0; offset + nameLength <= data.Size() && offset <= 64; offset+=sizeof(blender::PtrType))
+				{
+					const char* name = reinterpret_cast<const char*>(data.Data() + offset);
+					if(name[0] == 'S' && name[1] == 'C')
+					{
+						info.currentScene.assign(name + 2, strnlen(name + 2, nameLength - 2));
+						break;
+					}
+				}
+			}
+
+			return info;
+		}
+
+		/*
+		* Scene names and frame ranges from the leading REND blocks only, read through a stdio buffer: usually a single
+		* read per file. Blender writes REND for the current scene and the scenes flagged to render in the background,
+		* other scenes need the full parse (see ExtractScenes). The name is whatever follows the frame range, 64 chars
+		* before 5.0 and 256 since.
+		*/
+		static std::optional<std::vector<SceneFrameRange>> QueryRenderInfo(const std::string& file)
+		{
+			FILE* f = OpenFile(file, "rb");
+			if(f == nullptr)
+				return {};
+
+			std::vector<SceneFrameRange> scenes;
+			bool ok = false;
+
+			uint8_t header[sizeof(blender::FileHeaderV1)];
+			if(fread(header, 1, sizeof(header), f) == sizeof(header))
+			{
+				MemorySpan headerSpan{ header, header + sizeof(header) };
+				std::string_view error;
+				const auto format = ReadFileHeader(headerSpan, error);
+
+				ok = format.has_value() && fseek(f, long(format->headerSize), SEEK_SET) == 0;
+				uint64_t fileOffset = (ok ? format->headerSize : 0);
+
+				while(ok)
+				{
+					uint8_t blockHeader[sizeof(blender::FileBlockDescLarge64)];
+					if(fread(blockHeader, 1, format->blockHeaderSize, f) != format->blockHeaderSize)
+						break;
+
+					MemorySpan blockSpan{ blockHeader, blockHeader + format->blockHeaderSize };
+					const auto desc = ReadBlockDesc(blockSpan, format.value());
+					if(!desc.has_value() || memcmp(desc->code, blender::BlockREND, 4) != 0)
+						break;
+
+					uint8_t renderInfo[sizeof(blender::RenderInfoHead) + blender::ID_NAME_LENGTH_V5 - 2];
+					const size_t readSize = size_t(std::min<uint64_t>(desc->size, sizeof(renderInfo)));
+					if(desc->size < sizeof(blender::RenderInfoHead) || fread(renderInfo, 1, readSize, f) != readSize)
+					{
+						ok = false;
+						break;
+					}
+
+					const auto head = PeekType<blender::RenderInfoHead>(MemorySpan{ renderInfo, renderInfo + readSize }, 0);
+					const char* sceneName = reinterpret_cast<const char*>(renderInfo + sizeof(head));
+					scenes.emplace_back(SceneFrameRange{ std::string(sceneName, strnlen(sceneName, readSize - sizeof(head))), head.sfra, head.efra });
+
+					fileOffset += format->blockHeaderSize + desc->size;
+					fileOffset += AlignPadding(fileOffset, format.value());
+					if(desc->size > readSize && fseek(f, long(fileOffset), SEEK_SET) != 0)
+						ok = false;
+				}
+			}
+
+			fclose(f);
+
+			if(!ok)
+				return {};
+
+			return scenes;
+		}
+
+		// Batch entry point: untrusted parse, then world partition export into 'outputDir'.
+		bool ConvertFile(const std::string& file, const std::filesystem::path& outputDir)
+		{
+			if(!ParseFile(file, AccessMode::Untrusted))
+				return false;
+
+			WorldPartitionOptions options;
+			options.outputDir = outputDir;
+			return ExportWorldPartition(options);
+		}
+
+		size_t NumBlocks() const { return m_blockArray.size(); }
+
+		/*
+		* Walks every pointer field (SDNA names starting with '*', embedded structs and arrays included) of every ID block
+		* and the DATA blocks owned by it, in parallel over the IDs. A pointer to another ID, or to a DATA block owned by
+		* another ID, is an edge. Linked IDs point to their Library (LI) through ID.lib, so library dependencies show up
+		* the same way. '**' fields (eg. Mesh.mat) are followed into their raw pointer array blocks.
+		*/
+		IdDependencyGraph BuildIdGraph() const
+		{
+			const auto pointerFields = CollectPointerFields();
+
+			IdDependencyGraph graph;
+			std::vector<uint32_t> blockNode(m_blockArray.size(), IdDependencyGraph::NoNode); // DATA blocks map to their owner ID
+			std::vector<size_t> nodeBlocksEnd;
+
+			uint32_t owner = IdDependencyGraph::NoNode;
+			for(size_t i=0; i<m_blockArray.size(); ++i)
+			{
+				const auto& block = m_blockArray.at(i);
+				if(Identify(block.desc.code, blender::BlockDATA, 4))
+				{
+					blockNode[i] = owner;
+					continue;
+				}
+
+				if(owner != IdDependencyGraph::NoNode)
+					nodeBlocksEnd.emplace_back(i);
+
+				owner = IdDependencyGraph::NoNode;
+				if(IsIdStruct(block.desc.sdnaIndex))
+				{
+					owner = uint32_t(graph.idBlocks.size());
+					graph.idBlocks.emplace_back(i);
+					blockNode[i] = owner;
+				}
+			}
+
+			if(owner != IdDependencyGraph::NoNode)
+				nodeBlocksEnd.emplace_back(m_blockArray.size());
+
+			std::vector<std::vector<uint32_t>> dependencies(graph.NumNodes());
+			std::for_each(std::execution::par, dependencies.begin(), dependencies.end(), [&](std::vector<uint32_t>& nodeDependencies)
+			{
+				const uint32_t node = uint32_t(&nodeDependencies - dependencies.data());
+
+				const auto addTarget = [&](blender::PtrType addr)
+				{
+					const auto target = FindBlockIdByOldAddr(addr);
+					if(!target.has_value())
+						return std::optional<size_t>{};
+
+					const uint32_t targetNode = blockNode[target.value()];
+					if(targetNode != IdDependencyGraph::NoNode && targetNode != node)
+						nodeDependencies.emplace_back(targetNode);
+
+					return target;
+				};
+
+				for(size_t b=graph.idBlocks[node]; b<nodeBlocksEnd[node]; ++b)
+				{
+					const auto& block = m_blockArray.at(b);
+					if(block.desc.sdnaIndex == 0 || block.desc.sdnaIndex >= pointerFields.size())
+						continue;
+
+					const size_t structSize = m_typeArray.at(m_structArray.at(block.desc.sdnaIndex).typeIndex).length;
+					for(size_t item=0; item<block.desc.count; ++item)
+					{
+						for(const PointerField& field: pointerFields[block.desc.sdnaIndex])
+						{
+							const size_t offset = item * structSize + field.offset;
+							if(offset + sizeof(blender::PtrType) > block.data.Size())
+								break;
+
+							const auto target = addTarget(PeekField<blender::PtrType>(block, offset));
+							if(!field.pointerArray || !target.has_value())
+								continue;
+
+							const auto& arrayBlock = m_blockArray.at(target.value());
+							if(Identify(arrayBlock.desc.code, blender::BlockDATA, 4) && arrayBlock.desc.sdnaIndex == 0)
+							{
+								for(size_t p=0; p + sizeof(blender::PtrType) <= arrayBlock.data.Size(); p+=sizeof(blender::PtrType))
+									addTarget(PeekField<blender::PtrType>(arrayBlock, p));
+							}
+						}
+					}
+				}
+
+				std::sort(nodeDependencies.begin(), nodeDependencies.end());
+				nodeDependencies.erase(std::unique(nodeDependencies.begin(), nodeDependencies.end()), nodeDependencies.end());
+			});
+
+			graph.offsets.resize(graph.NumNodes() + 1, 0);
+			for(size_t n=0; n<graph.NumNodes(); ++n)
+				graph.offsets[n + 1] = graph.offsets[n] + uint32_t(dependencies[n].size());
+
+			graph.edges.resize(graph.offsets.back());
+			std::for_each(std::execution::par, dependencies.begin(), dependencies.end(), [&](const std::vector<uint32_t>& nodeDependencies)
+			{
+				std::copy(nodeDependencies.begin(), nodeDependencies.end(), graph.edges.begin() + graph.offsets[&nodeDependencies - dependencies.data()]);
+			});
+
+			return graph;
+		}
+
+		// Adjacency list for build tools, one line per ID: "<ID name> <dependency ID names...>", names with their code prefix (eg. OBCube MECube).
+		bool WriteIdGraph(const std::filesystem::path& path, const IdDependencyGraph& graph) const
+		{
+			FILE* f = OpenFile(path, "w");
+			if(f == nullptr)
+				return false;
+
+			for(uint32_t n=0; n<graph.NumNodes(); ++n)
+			{
+				fprintf(f, "%s", std::string(GetBlockNameByID(m_blockArray.at(graph.idBlocks[n]), false)).c_str());
+				graph.ForEachDependency(n, [&](uint32_t dependency)
+				{
+					fprintf(f, " %s", std::string(GetBlockNameByID(m_blockArray.at(graph.idBlocks[dependency]), false)).c_str());
+				});
+				fprintf(f, "\n");
+			}
+
+			return fclose(f) == 0;
+		}
+
+		/*
+		* IDs not reachable over the dependency graph from any scene (nor from fake user IDs with 'fakeUserRoots'). Window
+		* manager, workspaces and screens are neither roots nor reported: the UI references everything it ever showed.
+		*/
+		UnreachableIdReport FindUnreachableIds(bool fakeUserRoots) const
+		{
+			const IdDependencyGraph graph = BuildIdGraph();
+			const size_t idFlagOffset = GetFieldOffset("ID", "flag");
+
+			const auto isUi = [this](const blender::FileBlock& block)
+			{
+				return Identify(block.desc.code, "WM", 2) || Identify(block.desc.code, "WS", 2) || Identify(block.desc.code, "SN", 2); // screens are written as SN
+			};
+
+			std::vector<uint8_t> reached(graph.NumNodes(), 0);
+			std::vector<uint32_t> stack;
+			for(uint32_t n=0; n<graph.NumNodes(); ++n)
+			{
+				const auto& block = m_blockArray.at(graph.idBlocks[n]);
+				const bool fakeUser = fakeUserRoots && (PeekField<int16_t>(block, idFlagOffset) & blender::LIB_FAKEUSER) != 0;
+				if(Identify(block.desc.code, blender::BlockSC, 4) || (fakeUser && !isUi(block)))
+				{
+					reached[n] = 1;
+					stack.emplace_back(n);
+				}
+			}
+
+			while(!stack.empty())
+			{
+				const uint32_t node = stack.back();
+				stack.pop_back();
+
+				graph.ForEachDependency(node, [&](uint32_t dependency)
+				{
+					if(reached[dependency] == 0)
+					{
+						reached[dependency] = 1;
+						stack.emplace_back(dependency);
+					}
+				});
+			}
+
+			UnreachableIdReport report;
+			report.fileBytes = m_fileSpan.Size();
+
+			for(uint32_t n=0; n<graph.NumNodes(); ++n)
+			{
+				const size_t blockId = graph.idBlocks[n];
+				const auto& block = m_blockArray.at(blockId);
+				if(isUi(block))
+					continue;
+
+				report.numIds++;
+				if(reached[n] != 0)
+					continue;
+
+				uint64_t bytes = m_fileFormat.blockHeaderSize + block.data.Size();
+				for(size_t nextBlock=blockId + 1; nextBlock<m_blockArray.size() && Identify(m_blockArray.at(nextBlock).desc.code, blender::BlockDATA, 4); ++nextBlock)
+					bytes += m_fileFormat.blockHeaderSize + m_blockArray.at(nextBlock).data.Size();
+
+				report.unreachable.emplace_back(UnreachableIdReport::Entry{ std::string(GetBlockNameByID(block, false)), blockId, bytes });
+				report.unreachableBytes += bytes;
+			}
+
+			std::sort(report.unreachable.begin(), report.unreachable.end(), [](const auto& a, const auto& b) { return a.bytes > b.bytes; });
+			return report;
+		}
+
+		/*
+		* Writes a .blend holding only the dependency closure of 'rootNames' (ID names with their code prefix, eg. "OBCube"),
+		* plus DNA1 and GLOB, in source order, and a closing ENDB. Blocks are not modified, so runs of kept blocks are spliced
+		* from the source file unchanged: copy_file_range on Linux (in kernel, reflinked where the filesystem can), a write
+		* from the loaded file elsewhere. The exception is GLOB.curscene when its scene is left out: it is pointed at the
+		* first kept scene, or nulled, together with GLOB.cur_view_layer (Blender then takes the scene's first view layer).
+		*/
+		bool WriteSubset(const std::filesystem::path& outPath, const std::vector<std::string>& rootNames) const
+		{
+			if(m_fileSpan.Empty())
+				return false;
+
+			const IdDependencyGraph graph = BuildIdGraph();
+
+			std::vector<uint8_t> kept(graph.NumNodes(), 0);
+			std::vector<uint32_t> stack;
+			for(uint32_t n=0; n<graph.NumNodes(); ++n)
+			{
+				const std::string_view name = GetBlockNameByID(m_blockArray.at(graph.idBlocks[n]), false);
+				if(std::find(rootNames.begin(), rootNames.end(), name) != rootNames.end())
+				{
+					kept[n] = 1;
+					stack.emplace_back(n);
+				}
+			}
+
+			if(stack.empty())
+			{
+				std::cout << "ERROR - none of the root IDs are in the file!\n";
+				return false;
+			}
+
+			while(!stack.empty())
+			{
+				const uint32_t node = stack.back();
+				stack.pop_back();
+
+				graph.ForEachDependency(node, [&](uint32_t dependency)
+				{
+					if(kept[dependency] == 0)
+					{
+						kept[dependency] = 1;
+						stack.emplace_back(dependency);
+					}
+				});
+			}
+
+			std::vector<size_t> blockIds;
+			for(uint32_t n=0; n<graph.NumNodes(); ++n)
+			{
+				if(kept[n] != 0)
+					AppendBlockWithData(graph.idBlocks[n], blockIds, true);
+			}
+
+			for(size_t i=0; i<m_blockArray.size(); ++i)
+			{
+				const auto& block = m_blockArray.at(i);
+				if(Identify(block.desc.code, blender::BlockSDNA, 4) || Identify(block.desc.code, blender::BlockGLOB, 4))
+					blockIds.emplace_back(i);
+			}
+
+			std::sort(blockIds.begin(), blockIds.end());
+
+			// file offset, replacement pointer
+			std::vector<std::pair<uint64_t, blender::PtrType>> patches;
+			const auto globBlockId = FindBlockByCode(blender::BlockGLOB, 0);
+			const auto activeScene = GetActiveSceneBlockId();
+			if(globBlockId.has_value() && !(activeScene.has_value() && std::binary_search(blockIds.begin(), blockIds.end(), activeScene.value())))
+			{
+				blender::PtrType scene = 0;
+				for(const size_t blockId: blockIds)
+				{
+					if(Identify(m_blockArray.at(blockId).desc.code, blender::BlockSC, 4))
+					{
+						scene = m_blockArray.at(blockId).desc.oldMemoryAddress;
+						break;
+					}
+				}
+
+				const auto& glob = m_blockArray.at(globBlockId.value());
+				const uint64_t globOffset = uint64_t(glob.data.begin - m_fileSpan.begin);
+				const auto curSceneOffset = FindFieldOffset("FileGlobal", "*curscene");
+				const auto viewLayerOffset = FindFieldOffset("FileGlobal", "*cur_view_layer");
+				if(curSceneOffset.has_value() && curSceneOffset.value() + sizeof(blender::PtrType) <= glob.data.Size())
+					patches.emplace_back(globOffset + curSceneOffset.value(), scene);
+				if(viewLayerOffset.has_value() && viewLayerOffset.value() + sizeof(blender::PtrType) <= glob.data.Size())
+					patches.emplace_back(globOffset + viewLayerOffset.value(), 0);
+			}
+
+			// file ranges: the header, then coalesced runs of kept blocks (header + 4 aligned payload)
+			std::vector<std::pair<uint64_t, uint64_t>> ranges{ { 0, m_fileFormat.headerSize } };
+			for(const size_t blockId: blockIds)
+			{
+				const auto& block = m_blockArray.at(blockId);
+				const uint64_t begin = uint64_t(block.fileOffset);
+				const uint64_t dataEnd = uint64_t(block.data.end - m_fileSpan.begin);
+				const uint64_t end = std::min<uint64_t>(dataEnd + AlignPadding(dataEnd, m_fileFormat), m_fileSpan.Size());
+
+				if(ranges.back().second == begin)
+					ranges.back().second = end;
+				else
+					ranges.emplace_back(begin, end);
+			}
+
+			// a patched pointer is a range of its own, written from 'patches' instead of the source
+			for(const auto& [offset, value]: patches)
+			{
+				const auto it = std::find_if(ranges.begin(), ranges.end(), [offset](const auto& range) { return range.first <= offset && offset + sizeof(blender::PtrType) <= range.second; });
+				if(it == ranges.end())
+					continue;
+
+				const auto [begin, end] = *it;
+				std::vector<std::pair<uint64_t, uint64_t>> pieces{ { begin, offset }, { offset, offset + sizeof(blender::PtrType) }, { offset + sizeof(blender::PtrType), end } };
+				std::erase_if(pieces, [](const auto& piece) { return piece.first == piece.second; });
+				ranges.insert(ranges.erase(it), pieces.begin(), pieces.end());
+			}
+
+			const auto patchAt = [&patches](uint64_t begin) -> const uint8_t*
+			{
+				const auto it = std::find_if(patches.begin(), patches.end(), [begin](const auto& patch) { return patch.first == begin; });
+				return it != patches.end() ? reinterpret_cast<const uint8_t*>(&it->second) : nullptr;
+			};
+
+			// ENDB in the block header generation of the source
+			uint8_t endBlock[sizeof(blender::FileBlockDescLarge64)]{};
+			memcpy(endBlock, blender::EOFMark, 4);
+			const size_t endBlockSize = m_fileFormat.blockHeaderSize;
+
+			uint64_t written = 0;
+			bool ok = false;
+#if defined(__linux__)
+			const int src = open(m_filePath.c_str(), O_RDONLY | O_CLOEXEC);
+			const int dst = open(outPath.string().c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+			if(dst >= 0)
+			{
+				ok = true;
+				for(const auto& [begin, end]: ranges)
+				{
+					const uint8_t* patched = patchAt(begin);
+					loff_t srcOffset = loff_t(begin);
+					uint64_t remaining = end - begin;
+					while(remaining > 0 && src >= 0 && patched == nullptr)
+					{
+						const ssize_t copied = copy_file_range(src, &srcOffset, dst, nullptr, remaining, 0);
+						if(copied <= 0)
+							break;
+
+						remaining -= uint64_t(copied);
+					}
+
+					// no in-kernel copy (other filesystem, old kernel): write the rest from the loaded file
+					const uint8_t* data = (patched != nullptr ? patched : m_fileSpan.begin + (end - remaining));
+					while(remaining > 0)
+					{
+						const ssize_t count = write(dst, data, remaining);
+						if(count <= 0)
+						{
+							ok = false;
+							break;
+						}
+
+						data += count;
+						remaining -= uint64_t(count);
+					}
+
+					written += end - begin;
+				}
+
+				ok = ok && write(dst, endBlock, endBlockSize) == ssize_t(endBlockSize);
+				ok = (close(dst) == 0) && ok;
+			}
+
+			if(src >= 0)
+				close(src);
+#else
+			FILE* f = OpenFile(outPath, "wb");
+			if(f != nullptr)
+			{
+				ok = true;
+				for(const auto& [begin, end]: ranges)
+				{
+					const uint8_t* patched = patchAt(begin);
+					ok = ok && fwrite(patched != nullptr ? patched : m_fileSpan.begin + begin, 1, size_t(end - begin), f) == size_t(end - begin);
+					written += end - begin;
+				}
+
+				ok = ok && fwrite(endBlock, endBlockSize, 1, f) == 1;
+				ok = (fclose(f) == 0) && ok;
+			}
+#endif
+			if(!ok)
+			{
+				std::cout << "ERROR - could not write " << outPath.string() << "!\n";
+				return false;
+			}
+
+			std::cout << "Subset - IDs: " << std::count(kept.begin(), kept.end(), 1) << " blocks: " << blockIds.size() << " ranges: " << ranges.size() << " bytes: " << written + endBlockSize << '\n';
+			return true;
+		}
+
+		void ExploreIdGraph()
+		{
+			const IdDependencyGraph graph = BuildIdGraph();
+			std::cout << "ID graph - nodes: " << graph.NumNodes() << " edges: " << graph.NumEdges() << '\n';
+
+			for(uint32_t n=0; n<graph.NumNodes(); ++n)
+			{
+				if(graph.offsets[n] == graph.offsets[n + 1])
+					continue;
+
+				std::cout << GetBlockNameByID(m_blockArray.at(graph.idBlocks[n]), false) << " ->";
+				graph.ForEachDependency(n, [&](uint32_t dependency)
+				{
+					std::cout << ' ' << GetBlockNameByID(m_blockArray.at(graph.idBlocks[dependency]), false);
+				});
+				std::cout << '\n';
+			}
+		}
+
+		void ExploreMeshChunking(const ChunkingOptions& options = {})
+		{
+			size_t prevFoundBlockId = -1;
+			while(true)
+			{
+				const auto blockId = FindBlockByCode(blender::BlockME, prevFoundBlockId + 1);
+				if(!blockId.has_value())
+					break;
+
+				const auto& block = m_blockArray.at(blockId.value());
+				std::cout << "Mesh name: " << GetBlockNameByID(block, true) << '\n';
+
+				blendMesh mesh;
+				ExtractMeshData(blockId.value(), mesh);
+				mesh.Validate(MeshRepair::Drop);
+
+				const auto chunks = meshPartitioner(options).Partition(mesh.Positions(), mesh.Triangulate());
+				std::cout << "Chunks: " << chunks.size() << '\n';
+
+				for(size_t c=0; c<chunks.size(); ++c)
+				{
+					const MeshChunk& chunk = chunks[c];
+					std::cout << "  Chunk#" << c << " verts: " << chunk.positions.size() << " tris per lod:";
+					for(const auto& lod: chunk.lods)
+						std::cout << ' ' << lod.size() / 3;
+					std::cout << " bounds (" << chunk.boundsMin.x << ", " << chunk.boundsMin.y << ", " << chunk.boundsMin.z << ")-("
+							  << chunk.boundsMax.x << ", " << chunk.boundsMax.y << ", " << chunk.boundsMax.z << ")\n";
+				}
+
+				prevFoundBlockId = blockId.value();
+			}
+		}
+
+		void ExploreMeshValidation(MeshRepair repair = MeshRepair::None)
+		{
+			size_t prevFoundBlockId = -1;
+			while(true)
+			{
+				const auto blockId = FindBlockByCode(blender::BlockME, prevFoundBlockId + 1);
+				if(!blockId.has_value())
+					break;
+
+				const auto& block = m_blockArray.at(blockId.value());
+				std::cout << "Mesh name: " << GetBlockNameByID(block, true) << '\n';
+
+				blendMesh mesh;
+				ExtractMeshData(blockId.value(), mesh);
+				std::cout << "Verts: " << mesh.Verts().size() << " edges: " << mesh.Edges().size() << " loops: " << mesh.Loops().size() << " polys: " << mesh.Polys().size() << '\n';
+
+				mesh.Validate(repair).Print();
+
+				prevFoundBlockId = blockId.value();
+			}
+		}
+
+		bool ParseFile(std::string_view file, AccessMode accessMode = AccessMode::Trusted)
+		{
+			Cleanup();
+			m_accessMode = accessMode;
+			m_filePath = file;
+
+			// blocks are spans of the mapping, so even multi GB arrays are never copied
+			if(!m_fileMapping.Open(m_filePath))
+			{
+				std::cout << "File not found!\n";
+				return false;
+			}
+
+			m_fileSpan = m_fileMapping.Span();
+
+			MemorySpan memoryStream = m_fileSpan;
+			if(!ParseFileHeader(memoryStream))
+				return false;
+
+			size_t blockCount = 0;
+			size_t parentId = -1;
+
+			m_blockReport = {};
+
+			while(!memoryStream.Empty())
+			{
+				const std::ptrdiff_t blockOffset = memoryStream.begin - m_fileSpan.begin;
+				const auto blendBlock = ReadBlockDesc(memoryStream, m_fileFormat);
+				if(!blendBlock.has_value() || blendBlock->size > memoryStream.Size())
+				{
+					std::cout << "ERROR - truncated block at offset 0x" << std::hex << blockOffset << std::dec << '\n';
+					m_blockReport.truncatedBlocks++;
+					break;
+				}
+
+				blender::FileBlock block;
+				block.desc = blendBlock.value();
+				block.data = MemorySpan{ memoryStream.begin, memoryStream.begin + blendBlock->size };
+				block.fileOffset = blockOffset;
+				m_blockArray.emplace_back(block);
+				m_addressMap.emplace(blendBlock->oldMemoryAddress, m_blockArray.size() - 1); // keeps the first block of an address
+
+				if(Identify(blendBlock->code, blender::BlockDATA, 4))
+				{
+					if(parentId != -1)
+						m_blockArray.at(parentId).childBlocks.emplace_back(block);
+					else
+						m_blockReport.orphanDataBlocks++;
+				}
+				else
+				{
+					if(Identify(blendBlock->code, blender::BlockSDNA, 4))
+					{
+						if(!ParseSDNA(blendBlock.value(), block.data))
+						{
+							std::cout << "ERROR - malformed DNA1 block!\n";
+							return false;
+						}
+
+						BuildFieldIndex();
+					}
+					else if(Identify(blendBlock->code, blender::EOBMark, 4))
+						break;
+
+					parentId = m_blockArray.size() - 1;
+				}
+
+				memoryStream.Advance(blendBlock->size);
+				memoryStream.Advance(AlignPadding(memoryStream.begin - m_fileSpan.begin, m_fileFormat));
+				blockCount++;
+			}
+
+			if(m_structArray.empty())
+			{
+				std::cout << "ERROR - file has no DNA1 block!\n";
+				return false;
+			}
+
+			ValidateBlockExtents();
+			m_blockReport.Print();
+
+			if(m_accessMode == AccessMode::Trusted && !m_blockReport.IsValid())
+				std::cout << "WARNING - blocks which failed validation are read bounds checked!\n";
+
+			std::cout << "End of parsing.\n";
+			return m_accessMode == AccessMode::Trusted || m_blockReport.IsValid();
+		}
+
+	private:
+		friend bool selftest::MissingFields(const std::string& file);
+
+		struct StructDesc;
+
+		static constexpr std::string_view ProxyPrefix{ "UCX_" };
+
+		// <Target>_NN -> <Target>, names without a numeric suffix are returned as they are
+		static std::string_view StripProxyIndex(std::string_view target)
+		{
+			const size_t separator = target.rfind('_');
+			if(separator != std::string_view::npos && separator + 1 < target.size() &&
+			   std::all_of(target.begin() + separator + 1, target.end(), [](char c) { return c >= '0' && c <= '9'; }))
+				target = target.substr(0, separator);
+
+			return target;
+		}
+
+		bool ParseFileHeader(MemorySpan& memoryStream)
+		{
+			std::string_view error;
+			const auto format = ReadFileHeader(memoryStream, error);
+			if(!format.has_value())
+			{
+				std::cout << "ERROR - " << error << "!\n";
+				return false;
+			}
+
+			m_fileFormat = format.value();
+			std::cout << "Blender version: " << m_fileFormat.version / 100 << '.' << m_fileFormat.version % 100 << " - ptr size 8, little-endian" << (m_fileFormat.blockHeaderSize == sizeof(blender::FileBlockDescLarge64) ? ", 64bit block sizes" : "") << ".\n";
+			return true;
+		}
+
+		// Both header generations: 'BLENDER-v400' (12 bytes, 24 byte block headers), 'BLENDER17-01v0500' (17 bytes, 32 byte block headers).
+		static std::optional<blender::FileFormat> ReadFileHeader(MemorySpan& memoryStream, std::string_view& error)
+		{
+			const auto digits = [](const uint8_t* text, size_t count)
+			{
+				uint32_t value = 0;
+				for(size_t i=0; i<count; ++i)
+				{
+					if(!isdigit(text[i]))
+						return std::optional<uint32_t>{};
+
+					value = value * 10 + (text[i] - '0');
+				}
+
+				return std::optional<uint32_t>{ value };
+			};
+
+			if(memoryStream.Size() < sizeof(blender::HeaderID) + 1 || memcmp(memoryStream.Data(), blender::HeaderID, sizeof(blender::HeaderID)) != 0)
+			{
+				error = "file header magic mismatch";
+				return {};
+			}
+
+			blender::FileFormat format;
+
+			// 'BLENDER' followed by the header size digits marks the 5.0+ header
+			if(isdigit(memoryStream.Data()[sizeof(blender::HeaderID)]))
+			{
+				const auto* blendHeader = ReadTypePtrChecked<blender::FileHeaderV1>(memoryStream);
+				if(blendHeader == nullptr)
+				{
+					error = "file is shorter than the header";
+					return {};
+				}
+
+				const auto headerSize = digits(blendHeader->headerSize, 2);
+				const auto fileFormat = digits(blendHeader->format, 2);
+				const auto version = digits(blendHeader->version, 4);
+				if(headerSize != sizeof(blender::FileHeaderV1) || blendHeader->separator != '-' || fileFormat != 1u || !version.has_value())
+				{
+					error = "unknown file header format";
+					return {};
+				}
+
+				if(blendHeader->endianness != 'v')
+				{
+					error = "this parser supports only 64bit, little endian blend files";
+					return {};
+				}
+
+				format.version = version.value();
+				format.headerSize = sizeof(blender::FileHeaderV1);
+				format.blockHeaderSize = sizeof(blender::FileBlockDescLarge64);
+			}
+			else
+			{
+				const auto* blendHeader = ReadTypePtrChecked<blender::FileHeader>(memoryStream);
+				if(blendHeader == nullptr)
+				{
+					error = "file is shorter than the header";
+					return {};
+				}
+
+				if(blendHeader->pointerSize != '-' && blendHeader->pointerSize != '_')
+				{
+					error = "unknown pointer size in file header";
+					return {};
+				}
+
+				const blender::PointerSize ptrSize = (blendHeader->pointerSize == '_' ? blender::PointerSize::PTR_4 : blender::PointerSize::PTR_8);
+				const blender::Endianness endian = (blendHeader->endianness == 'v' ? blender::Endianness::LittleEndian : blender::Endianness::BigEndian);
+
+				if(ptrSize != blender::PointerSize::PTR_8 || endian != blender::Endianness::LittleEndian)
+				{
+					error = "this parser supports only 64bit, little endian blend files";
+					return {};
+				}
+
+				const auto version = digits(blendHeader->version, 3);
+				if(!version.has_value())
+				{
+					error = "unknown file header format";
+					return {};
+				}
+
+				format.version = version.value();
+				format.headerSize = sizeof(blender::FileHeader);
+				format.blockHeaderSize = sizeof(blender::FileBlockDesc64);
+			}
+
+			return format;
+		}
+
+		// Blocks are 4 byte aligned relative to the end of the file header (17 bytes long in 5.0+ files).
+		static size_t AlignPadding(uint64_t fileOffset, const blender::FileFormat& format)
+		{
+			return size_t((4 - ((fileOffset - format.headerSize) & 3)) & 3);
+		}
+
+		static std::optional<blender::BlockDesc> ReadBlockDesc(MemorySpan& memoryStream, const blender::FileFormat& format)
+		{
+			blender::BlockDesc desc{};
+			if(format.blockHeaderSize == sizeof(blender::FileBlockDescLarge64))
+			{
+				if(memoryStream.Size() < sizeof(blender::FileBlockDescLarge64))
+					return {};
+
+				const auto large = ReadType<blender::FileBlockDescLarge64>(memoryStream);
+				memcpy(desc.code, large.code, 4);
+				desc.size = large.size;
+				desc.oldMemoryAddress = large.oldMemoryAddress;
+				desc.sdnaIndex = large.sdnaIndex;
+				desc.count = large.count;
+			}
+			else
+			{
+				if(memoryStream.Size() < sizeof(blender::FileBlockDesc64))
+					return {};
+
+				const auto small = ReadType<blender::FileBlockDesc64>(memoryStream);
+				memcpy(desc.code, small.code, 4);
+				desc.size = small.size;
+				desc.oldMemoryAddress = small.oldMemoryAddress;
+				desc.sdnaIndex = small.sdnaIndex;
+				desc.count = small.count;
+			}
+
+			return desc;
+		}
+
+		/*
+		* Resolves every struct and field name once, at SDNA load: offsets and sizes go into per struct maps keyed by the
+		* name in the file and by its renamed counterpart from DnaStructRenames/DnaFieldRenames (decorations kept, eg.
+		* 'size[3]' is also 'scale[3]'). Field lookups are then a map search, with no fallback searching at run time.
+		*/
+		void BuildFieldIndex()
+		{
+			m_structIndex.clear();
+
+			const auto renamedField = [](std::string_view structName, std::string_view fieldName) -> std::optional<std::string>
+			{
+				const size_t bareBegin = fieldName.find_first_not_of("*(");
+				if(bareBegin == std::string_view::npos)
+					return {};
+
+				const size_t bareEnd = std::min(fieldName.find_first_of("[)", bareBegin), fieldName.size());
+				const std::string_view bareName = fieldName.substr(bareBegin, bareEnd - bareBegin);
+
+				for(const auto& rename: blender::DnaFieldRenames)
+				{
+					if(rename.structName != structName)
+						continue;
+
+					const std::string_view other = (bareName == rename.staticName ? rename.runtimeName : (bareName == rename.runtimeName ? rename.staticName : std::string_view{}));
+					if(!other.empty())
+						return std::string(fieldName.substr(0, bareBegin)).append(other).append(fieldName.substr(bareEnd));
+				}
+
+				return {};
+			};
+
+			for(size_t i=0; i<m_structArray.size(); ++i)
+			{
+				StructDesc& structDesc = m_structArray.at(i);
+				structDesc.fieldIndex.clear();
+				if(structDesc.typeIndex >= m_typeArray.size())
+					continue;
+
+				// field renames are listed under the static struct name
+				std::string_view structName = m_typeArray.at(structDesc.typeIndex).type.AsString();
+				for(const auto& rename: blender::DnaStructRenames)
+				{
+					if(structName == rename.runtimeName)
+						structName = rename.staticName;
+				}
+
+				size_t offset = 0;
+				for(const auto& field: structDesc.fields)
+				{
+					if(field.typeIndex >= m_typeArray.size() || field.nameIndex >= m_nameArray.size())
+						break;
+
+					const std::string_view fieldName = m_nameArray.at(field.nameIndex).AsString();
+					const FieldInfo info{ offset, GetFieldSizeByName(fieldName, m_typeArray.at(field.typeIndex).length) };
+
+					structDesc.fieldIndex.emplace(std::string(fieldName), info);
+					offset += info.size;
+				}
+
+				// renamed names only where the file doesn't use them already
+				for(const auto& field: structDesc.fields)
+				{
+					if(field.nameIndex >= m_nameArray.size())
+						break;
+
+					const std::string_view fieldName = m_nameArray.at(field.nameIndex).AsString();
+					const auto renamed = renamedField(structName, fieldName);
+					if(renamed.has_value())
+						structDesc.fieldIndex.emplace(renamed.value(), structDesc.fieldIndex.find(fieldName)->second);
+				}
+
+				m_structIndex.emplace(std::string(m_typeArray.at(structDesc.typeIndex).type.AsString()), i);
+			}
+
+			for(const auto& rename: blender::DnaStructRenames)
+			{
+				for(const auto& [name, other]: { std::pair{ rename.staticName, rename.runtimeName }, std::pair{ rename.runtimeName, rename.staticName } })
+				{
+					const auto it = m_structIndex.find(name);
+					if(it != m_structIndex.end())
+						m_structIndex.emplace(std::string(other), it->second);
+				}
+			}
+		}
+
+		std::optional<size_t> FindStructIndex(const std::string_view sname) const
+		{
+			const auto it = m_structIndex.find(sname);
+			if(it != m_structIndex.end())
+				return { it->second };
+
+			return {};
+		}
+
+		// Missing fields are reported once per name.
+		void ReportMissingField(const std::string_view sname, const std::string_view fname) const
+		{
+			std::string name = std::string(sname).append(".").append(fname);
+
+			std::lock_guard<std::mutex> lock(m_missingFieldsMutex);
+			if(m_missingFields.insert(name).second)
+				std::cout << "ERROR - the file's SDNA has no field " << name << "!\n";
+		}
+
+		/*
+		* Load-time pass which makes the unchecked hot path safe: every SDNA struct has to hold its fields within
+		* its length, every block payload has to cover struct length * count. Blocks passing both get 'validated',
+		* so a field read at an offset coming from GetFieldOffset() needs no further check.
+		*/
+		void ValidateBlockExtents()
+		{
+			for(auto& structDesc: m_structArray)
+			{
+				structDesc.valid = false;
+				if(structDesc.typeIndex >= m_typeArray.size())
+				{
+					m_blockReport.invalidStructs++;
+					continue;
+				}
+
+				size_t structSize = 0;
+				bool fieldsValid = true;
+				for(const auto& field: structDesc.fields)
+				{
+					if(field.typeIndex >= m_typeArray.size() || field.nameIndex >= m_nameArray.size())
+					{
+						fieldsValid = false;
+						break;
+					}
+
+					structSize += GetFieldSizeByName(m_nameArray.at(field.nameIndex).AsString(), m_typeArray.at(field.typeIndex).length);
+				}
+
+				structDesc.valid = fieldsValid && structSize <= m_typeArray.at(structDesc.typeIndex).length;
+				if(!structDesc.valid)
+					m_blockReport.invalidStructs++;
+			}
+
+			for(auto& block: m_blockArray)
+			{
+				block.validated = ValidateBlockPayload(block, true);
+
+				// child blocks are copies of DATA blocks which are counted in m_blockArray already
+				for(auto& child: block.childBlocks)
+					child.validated = ValidateBlockPayload(child, false);
+			}
+		}
+
+		bool ValidateBlockPayload(const blender::FileBlock& block, bool report)
+		{
+			const blender::BlockDesc& desc = block.desc;
+
+			if(desc.sdnaIndex >= m_structArray.size())
+			{
+				m_blockReport.badSdnaIndex += (report ? 1 : 0);
+				return false;
+			}
+
+			// sdna 0 marks raw (untyped) data, only the block size itself applies
+			if(desc.sdnaIndex == 0)
+				return true;
+
+			const StructDesc& structDesc = m_structArray.at(desc.sdnaIndex);
+			if(!structDesc.valid)
+				return false;
+
+			// count is 64bit in 5.0+ files, divide instead of an overflowing multiply
+			const uint64_t structSize = m_typeArray.at(structDesc.typeIndex).length;
+			if(structSize > 0 && desc.count > block.data.Size() / structSize)
+			{
+				m_blockReport.payloadTooSmall += (report ? 1 : 0);
+				return false;
+			}
+
+			return true;
+		}
+
+		// View of the whole struct array of a block, stride is the SDNA length of the block's struct. Empty when the
+		// file's struct is smaller than T: its elements can't be read as T.
+		template<typename T>
+		StridedView<T> GetStructView(const blender::FileBlock& block) const
+		{
+			if(block.desc.sdnaIndex >= m_structArray.size())
+				return {};
+
+			const size_t structSize = m_typeArray.at(m_structArray.at(block.desc.sdnaIndex).typeIndex).length;
+			return MakeStridedView<T>(block.data, block.desc.count, structSize);
+		}
+
+		// View of one field across the struct array of a block, eg. GetFieldView<blender::Float3>(block, "MVert", "co[3]").
+		template<typename T>
+		StridedView<T> GetFieldView(const blender::FileBlock& block, const std::string_view sname, const std::string_view fname) const
+		{
+			return MakeStridedView<T>(block.data, block.desc.count, GetStructSizeByName(sname), GetFieldOffset(sname, fname));
+		}
+
+		/*
+		* Typed field read of the extractors. Struct blocks which passed validation in a trusted file are read unchecked,
+		* untrusted input, blocks which failed validation and raw (sdna 0) blocks are bounds checked: a read outside
+		* the block gives T{}. So does a missing field (GetFieldOffset gave MissingField), whatever the block.
+		*/
+		template<typename T>
+		T PeekField(const blender::FileBlock& block, size_t offset) const
+		{
+			if(m_accessMode == AccessMode::Trusted && block.validated && block.desc.sdnaIndex != 0 && offset != MissingField)
+				return PeekType<T>(block.data, offset);
+
+			if(offset > block.data.Size() || sizeof(T) > block.data.Size() - offset)
+				return T{};
+
+			return PeekType<T>(block.data, offset);
+		}
+
+		// blockSpan covers the DNA1 payload only, every read is checked since the SDNA is not validated yet
+		bool ParseSDNA(const blender::BlockDesc& block, MemorySpan blockSpan)
+		{
+			std::cout << "DNA1 block begin - size: " << block.size << '\n';
+
+			// chunks are aligned relative to the payload start, which is not 4 byte aligned in the file after a 17 byte header
+			const uint8_t* payloadBegin = blockSpan.begin;
+			const auto readChunkId = [&blockSpan, payloadBegin, this](const char* id)
+			{
+				const size_t misAlign = size_t(blockSpan.begin - payloadBegin) & 3;
+				if(misAlign != 0 && 4 - misAlign <= blockSpan.Size())
+					blockSpan.Advance(4 - misAlign);
+
+				const auto* chunkId = ReadTypePtrChecked<uint8_t>(blockSpan, 4);
+				return chunkId != nullptr && Identify(chunkId, id, 4);
+			};
+
+			const auto readStrings = [&blockSpan](size_t count, auto&& emplace)
+			{
+				for(size_t i=0; i<count; ++i)
+				{
+					MemorySpan stringSpan = { blockSpan.begin };
+
+					while(!blockSpan.Empty() && *blockSpan.Data() != 0)
+						blockSpan.Advance();
+
+					if(blockSpan.Empty())
+						return false;
+
+					blockSpan.Advance(); // string terminating 0
+					stringSpan.end = blockSpan.Data();
+
+					emplace(stringSpan);
+				}
+
+				return true;
+			};
+
+			//sdna block header
+			const auto* sdnaHeaderId = ReadTypePtrChecked<uint8_t>(blockSpan, 4); // 'SDNA'
+			if(sdnaHeaderId == nullptr || !Identify(sdnaHeaderId, "SDNA", 4))
+				return false;
+
+			//read names array
+			{
+				if(!readChunkId("NAME"))
+					return false;
+
+				const auto* nameCount = ReadTypePtrChecked<uint32_t>(blockSpan);
+				if(nameCount == nullptr || *nameCount > blockSpan.Size())
+					return false;
+
+				m_nameArray.reserve(*nameCount);
+				if(!readStrings(*nameCount, [this](MemorySpan nameSpan) { m_nameArray.emplace_back(nameSpan); }))
+					return false;
+			}
+
+			uint32_t typeCount = 0;
+
+			//read types array
+			{
+				if(!readChunkId("TYPE"))
+					return false;
+
+				const auto* typeCountPtr = ReadTypePtrChecked<uint32_t>(blockSpan);
+				if(typeCountPtr == nullptr || *typeCountPtr > blockSpan.Size())
+					return false;
+
+				typeCount = *typeCountPtr;
+				m_typeArray.reserve(typeCount);
+				if(!readStrings(typeCount, [this](MemorySpan typeSpan) { m_typeArray.emplace_back(TypeInfo{ typeSpan, 0 }); }))
+					return false;
+			}
+
+			//read lengths array
+			{
+				if(!readChunkId("TLEN"))
+					return false;
+
+				const auto* lengths = ReadTypePtrChecked<uint16_t>(blockSpan, typeCount);
+				if(lengths == nullptr)
+					return false;
+
+				for(size_t i=0; i<typeCount; ++i)
+					m_typeArray.at(i).length = lengths[i];
+			}
+
+			//read structures array
+			{
+				if(!readChunkId("STRC"))
+					return false;
+
+				const auto* structCount = ReadTypePtrChecked<uint32_t>(blockSpan);
+				if(structCount == nullptr || *structCount > blockSpan.Size() / 4)
+					return false;
+
+				m_structArray.resize(*structCount);
+
+				for(size_t i=0; i<*structCount; ++i)
+				{
+					const auto* structHeader = ReadTypePtrChecked<uint16_t>(blockSpan, 2); // type index, number of fields
+					if(structHeader == nullptr)
+						return false;
+
+					StructDesc& structDesc = m_structArray.at(i);
+					structDesc.typeIndex = structHeader[0];
+
+					const uint16_t numFields = structHeader[1];
+					const auto* fields = ReadTypePtrChecked<uint16_t>(blockSpan, 2 * size_t(numFields)); // type index, name index pairs
+					if(fields == nullptr)
+						return false;
+
+					structDesc.fields.reserve(numFields);
+
+					for(uint16_t f=0; f<numFields; ++f)
+						structDesc.fields.emplace_back(FieldDesc{ fields[2 * f], fields[2 * f + 1] });
+				}
+			}
+
+			std::cout << "DNA1 block end.\n";
+			return true;
+		}
+
+		std::string_view GetUserName(const std::string_view name)
+		{
+			const size_t offset = (name.starts_with("ME") ? 2 : 0);
+			const size_t firstZero = name.find_first_of('\0', offset);
+			return std::string_view(name.data() + offset, firstZero - offset);
+		}
+
+		std::optional<size_t> FindBlockByCode(const char* code, size_t offset) const
+		{
+			for(size_t i=offset; i<m_blockArray.size(); ++i)
+			{
+				if(Identify(m_blockArray.at(i).desc.code, code, 4))
+					return { i };
+			}
+
+			return {};
+		}
+
+		std::optional<blender::FileBlock> FindFileBlockByOldAddr(blender::PtrType oldAddressOfBlock) const
+		{
+			const auto blockId = FindBlockIdByOldAddr(oldAddressOfBlock);
+			if(blockId.has_value())
+				return { m_blockArray.at(blockId.value()) };
+
+			return {};
+		}
+
+		std::optional<size_t> FindBlockIdByOldAddr(blender::PtrType oldAddressOfBlock) const
+		{
+			if(oldAddressOfBlock != 0)
+			{
+				const auto it = m_addressMap.find(oldAddressOfBlock);
+				if(it != m_addressMap.end())
+					return { it->second };
+			}
+
+			return {};
+		}
+
+		void CollectRenderVisible(const blender::FileBlock& layerCollection, RenderVisibility& visibility) const
+		{
+			if((ReadFlagField(layerCollection, "LayerCollection", "flag") & blender::LAYER_COLLECTION_EXCLUDE) != 0)
+				return;
+
+			const auto collectionAddr = PeekField<blender::PtrType>(layerCollection, GetFieldOffset("LayerCollection", "*collection"));
+			const auto collectionId = FindBlockIdByOldAddr(collectionAddr);
+			if(!collectionId.has_value())
+				return;
+
+			const auto& collection = m_blockArray.at(collectionId.value());
+			if((ReadFlagField(collection, "Collection", "flag") & blender::COLLECTION_HIDE_RENDER) != 0)
+				return;
+
+			visibility.collections.insert(collectionAddr);
+
+			const auto gobject = PeekField<blender::ListBase>(collection, GetFieldOffset("Collection", "gobject"));
+			ForEachListItem(gobject.first, [&](const blender::FileBlock& collectionObject)
+			{
+				const auto obAddr = PeekField<blender::PtrType>(collectionObject, GetFieldOffset("CollectionObject", "*ob"));
+				const auto obId = FindBlockIdByOldAddr(obAddr);
+				if(!obId.has_value())
+					return;
+
+				const auto& ob = m_blockArray.at(obId.value());
+				const uint64_t obFlag = HasField("Object", "visibility_flag") ? ReadFlagField(ob, "Object", "visibility_flag") : ReadFlagField(ob, "Object", "restrictflag");
+				if((obFlag & blender::OB_HIDE_RENDER) == 0)
+					visibility.objects.insert(obAddr);
+			});
+
+			// LayerCollection children mirror the Collection children
+			const auto children = PeekField<blender::ListBase>(layerCollection, GetFieldOffset("LayerCollection", "layer_collections"));
+			ForEachListItem(children.first, [&](const blender::FileBlock& child)
+			{
+				CollectRenderVisible(child, visibility);
+			});
+		}
+
+		void ExpandCollectionInstance(const blender::FileBlock& instancer, const blender::Float4x4& instancerWorld, const std::string& prefix, uint32_t depthLeft, std::vector<CollectionInstance>& instances) const
+		{
+			if(depthLeft == 0 || (ReadFlagField(instancer, "Object", "transflag") & blender::OB_DUPLICOLLECTION) == 0)
+				return;
+
+			const auto collectionId = FindBlockIdByOldAddr(ReadField<blender::PtrType>(instancer, "Object", "*instance_collection").value_or(0));
+			if(!collectionId.has_value())
+				return;
+
+			float offset[3] = { 0.0f, 0.0f, 0.0f };
+			ReadFieldArray(m_blockArray.at(collectionId.value()), "Collection", "instance_offset[3]", offset);
+
+			blender::Float4x4 toInstancer = blender::Identity();
+			toInstancer.m[3][0] = -offset[0];
+			toInstancer.m[3][1] = -offset[1];
+			toInstancer.m[3][2] = -offset[2];
+			toInstancer = blender::Multiply(instancerWorld, toInstancer);
+
+			// everything in an instanced collection shows up, view layer exclusion doesn't apply to it
+			std::unordered_set<blender::PtrType> visited;
+			std::vector<size_t> obBlockIds;
+			CollectCollectionObjects(collectionId.value(), nullptr, visited, obBlockIds);
+
+			for(const size_t obBlockId: obBlockIds)
+			{
+				const auto& obBlock = m_blockArray.at(obBlockId);
+				const blender::Float4x4 world = blender::Multiply(toInstancer, GetObjectWorldMatrix(obBlock).value_or(blender::Identity()));
+				const std::string name = prefix + "/" + std::string(GetBlockNameByID(obBlock, true));
+
+				instances.emplace_back(CollectionInstance{ obBlockId, world, name });
+				ExpandCollectionInstance(obBlock, world, name, depthLeft - 1, instances);
+			}
+		}
+
+		// Object blocks of a collection tree, each once, in traversal order. Collections linked from more than one parent are visited once.
+		void CollectCollectionObjects(size_t collectionBlockId, const RenderVisibility* visibility, std::unordered_set<blender::PtrType>& visited, std::vector<size_t>& obBlockIds) const
+		{
+			const auto& collection = m_blockArray.at(collectionBlockId);
+			const blender::PtrType collectionAddr = collection.desc.oldMemoryAddress;
+
+			if(!visited.insert(collectionAddr).second)
+				return;
+
+			if(visibility != nullptr && !visibility->collections.contains(collectionAddr))
+				return;
+
+			const auto gobject = PeekField<blender::ListBase>(collection, GetFieldOffset("Collection", "gobject"));
+			ForEachListItem(gobject.first, [&](const blender::FileBlock& collectionObject)
+			{
+				const auto obAddr = PeekField<blender::PtrType>(collectionObject, GetFieldOffset("CollectionObject", "*ob"));
+				if(visibility != nullptr && !visibility->objects.contains(obAddr))
+					return;
+
+				const auto obId = FindBlockIdByOldAddr(obAddr);
+				if(obId.has_value() && visited.insert(obAddr).second)
+					obBlockIds.emplace_back(obId.value());
+			});
+
+			const auto children = PeekField<blender::ListBase>(collection, GetFieldOffset("Collection", "children"));
+			ForEachListItem(children.first, [&](const blender::FileBlock& collectionChild)
+			{
+				const auto childId = FindBlockIdByOldAddr(PeekField<blender::PtrType>(collectionChild, GetFieldOffset("CollectionChild", "*collection")));
+				if(childId.has_value())
+					CollectCollectionObjects(childId.value(), visibility, visited, obBlockIds);
+			});
+		}
+
+		// Calls onItem for every block of a ListBase, following Link::next (the first member of every list item).
+		template<typename F>
+		void ForEachListItem(blender::PtrType first, F&& onItem) const
+		{
+			size_t guard = m_blockArray.size(); // broken files may link in a circle
+			for(blender::PtrType addr=first; addr != 0 && guard > 0; --guard)
+			{
+				const auto blockId = FindBlockIdByOldAddr(addr);
+				if(!blockId.has_value())
+					break;
+
+				const auto& block = m_blockArray.at(blockId.value());
+				onItem(block);
+				addr = PeekField<blender::PtrType>(block, 0);
+			}
+		}
+
+		// Reads an integer field (char/short/int) zero extended, 0 if the field doesn't exist.
+		uint64_t ReadFlagField(const blender::FileBlock& block, const std::string_view sname, const std::string_view fname) const
+		{
+			const auto field = FindField(sname, fname);
+			if(!field.has_value() || field->size > sizeof(uint64_t) || field->offset + field->size > block.data.Size())
+				return 0;
+
+			uint64_t value = 0;
+			memcpy(&value, block.data.Data() + field->offset, field->size);
+			return value;
+		}
+
+		bool HasField(const std::string_view sname, const std::string_view fname) const
+		{
+			return FindField(sname, fname).has_value();
+		}
+
+		// Value of a field, empty if the struct has no such field or the block is too short.
+		template<typename T>
+		std::optional<T> ReadField(const blender::FileBlock& block, const std::string_view sname, const std::string_view fname) const
+		{
+			const auto field = FindField(sname, fname);
+			if(!field.has_value() || sizeof(T) > field->size || field->offset + sizeof(T) > block.data.Size())
+				return {};
+
+			return PeekType<T>(block.data, field->offset);
 		}
 
-		void ExploreObjectData()
+		// Copies an array field into 'out', which keeps its values if the field doesn't exist.
+		template<typename T, size_t N>
+		void ReadFieldArray(const blender::FileBlock& block, const std::string_view sname, const std::string_view fname, T (&out)[N]) const
 		{
-			const size_t offsetOfType = GetFieldOffset("Object", "type");
-			const size_t offsetOfData = GetFieldOffset("Object", "*data");
+			const auto field = FindField(sname, fname);
+			if(field.has_value() && field->size >= sizeof(out) && field->offset + sizeof(out) <= block.data.Size())
+				memcpy(out, block.data.Data() + field->offset, sizeof(out));
+		}
 
-			size_t prevFoundBlockId = -1;
-			bool hasMoreObject = true;
+		/*
+		* Calls onLayer(name, type, dataBlockId) for every layer of the CustomData 'customData' embedded in 'block' (a struct 'sname')
+		* whose data is in the file. Layers are read with the file's CustomDataLayer length, the name array grew from 64 to 68.
+		*/
+		template<typename F>
+		void ForEachCustomDataLayer(const blender::FileBlock& block, const std::string_view sname, const std::string_view customData, F&& onLayer) const
+		{
+			const auto customDataOffset = FindFieldOffset(sname, customData);
+			const auto layersOffset = FindFieldOffset("CustomData", "*layers");
+			const auto totLayerOffset = FindFieldOffset("CustomData", "totlayer");
+			const auto typeOffset = FindFieldOffset("CustomDataLayer", "type");
+			const auto nameField = FindArrayField("CustomDataLayer", "name");
+			const auto dataOffset = FindFieldOffset("CustomDataLayer", "*data");
+			const size_t layerSize = GetStructSizeByName("CustomDataLayer");
+			if(!customDataOffset || !layersOffset || !totLayerOffset || !typeOffset || !nameField || !dataOffset || layerSize == 0)
+				return;
 
-			while(hasMoreObject)
-			{
-				const auto blockId = FindBlockByCode(blender::BlockOB, prevFoundBlockId + 1);
-				hasMoreObject = blockId.has_value();
+			const auto layersPtr = PeekTypePtrChecked<blender::PtrType>(block.data, customDataOffset.value() + layersOffset.value());
+			const auto totLayer = PeekTypePtrChecked<int32_t>(block.data, customDataOffset.value() + totLayerOffset.value());
+			if(layersPtr == nullptr || totLayer == nullptr)
+				return;
 
-				if(hasMoreObject)
-				{
-					const size_t objectBlockId = blockId.value();
-					const auto& block = m_blockArray.at(objectBlockId);
+			const auto layersBlockId = FindBlockIdByOldAddr(*layersPtr);
+			if(!layersBlockId.has_value())
+				return;
 
-					std::cout << "Object name: " << GetBlockNameByID(block, true) << '\n';
+			const auto& layersBlock = m_blockArray.at(layersBlockId.value());
+			const size_t numLayers = std::min<size_t>(size_t(std::max(*totLayer, 0)), layersBlock.data.Size() / layerSize);
+			for(size_t i=0; i<numLayers; ++i)
+			{
+				const size_t layer = i * layerSize;
+				const auto dataBlockId = FindBlockIdByOldAddr(PeekField<blender::PtrType>(layersBlock, layer + dataOffset.value()));
+				if(!dataBlockId.has_value())
+					continue;
 
-					const blender::OB_TYPE type = *PeekTypePtr<blender::OB_TYPE>(block.data, offsetOfType);
-					std::cout << "  Type: " << static_cast<size_t>(type) << '\n';
+				const std::string name = ReadName(layersBlock, layer + nameField->offset);
+				onLayer(std::string_view(name).substr(0, nameField->size), PeekField<int32_t>(layersBlock, layer + typeOffset.value()), dataBlockId.value());
+			}
+		}
 
-					const auto adtArmatureOb = PeekTypePtr<blender::PtrType>(block.data, GetFieldOffset("Object", "*adt"));
-					if(adtArmatureOb != 0)
-						std::cout << "Found animation data for object\n";
+		// Data block of the layer 'name' of type 'type', see ForEachCustomDataLayer.
+		std::optional<size_t> FindCustomDataLayer(const blender::FileBlock& block, const std::string_view sname, const std::string_view customData,
+												  const std::string_view name, int32_t type) const
+		{
+			std::optional<size_t> found;
+			ForEachCustomDataLayer(block, sname, customData, [&](std::string_view layerName, int32_t layerType, size_t dataBlockId)
+			{
+				if(!found.has_value() && layerName == name && layerType == type)
+					found = dataBlockId;
+			});
 
-					if(type == blender::OB_TYPE::OB_MESH)
-					{
-						//std::cout << "----\n";
-						//PrintBlockSDNA(block);
-						//PrintStrucyBySDNA(block.blockDesc.sdnaIndex);
+			return found;
+		}
 
-						size_t nextBlock = objectBlockId + 1;
-						while(nextBlock < m_blockArray.size())
-						{
-							const auto& dataFileBlock = m_blockArray.at(nextBlock);
-							if(!Identify(dataFileBlock.desc.code, "DATA", 4))
-								break;
+		// Zero terminated string at 'offset', cut at the end of the block.
+		static std::string ReadName(const blender::FileBlock& block, size_t offset)
+		{
+			if(offset >= block.data.Size())
+				return {};
 
-							const blender::FileBlockDesc64& blockDesc = dataFileBlock.desc;
+			const char* name = reinterpret_cast<const char*>(block.data.Data()) + offset;
+			return std::string(name, strnlen(name, block.data.Size() - offset));
+		}
 
-							if(IdentifyStruct(blockDesc.sdnaIndex, "bDeformGroup"))
-							{
-								MemorySpan dgroupSpan = dataFileBlock.data;
-								const auto* defGroup = ReadTypePtr<blender::MDeformGroup>(dgroupSpan);
-								int d = 3;
-							}
+		// Appends a block (optionally) and the run of DATA blocks following it.
+		void AppendBlockWithData(size_t blockId, std::vector<size_t>& out, bool includeBlock) const
+		{
+			if(includeBlock)
+				out.emplace_back(blockId);
 
-							nextBlock++;
-						}
-					}
+			for(size_t nextBlock=blockId + 1; nextBlock<m_blockArray.size(); ++nextBlock)
+			{
+				if(!Identify(m_blockArray.at(nextBlock).desc.code, "DATA", 4))
+					break;
 
-					prevFoundBlockId = blockId.value();
-				}
+				out.emplace_back(nextBlock);
 			}
 		}
 
-		void ExploreScene()
+		struct PointerField
 		{
-			for(const auto& sceneBlock: m_blockArray)
+			uint32_t offset;
+			bool pointerArray;	// '**': the target is a block of pointers
+		};
+
+		// Pointer fields of every SDNA struct by sdna index, flattened through embedded structs and arrays. Function pointers are skipped.
+		std::vector<std::vector<PointerField>> CollectPointerFields() const
+		{
+			std::vector<int32_t> structOfType(m_typeArray.size(), -1);
+			for(size_t i=0; i<m_structArray.size(); ++i)
 			{
-				if(!Identify(sceneBlock.desc.code, blender::BlockSC, 4))
-					continue;
+				if(m_structArray.at(i).typeIndex < structOfType.size())
+					structOfType[m_structArray.at(i).typeIndex] = int32_t(i);
+			}
 
-				std::cout << "Scene name: " << GetBlockNameByID(sceneBlock, true) << '\n';
+			std::vector<std::vector<PointerField>> pointerFields(m_structArray.size());
+			std::for_each(std::execution::par, pointerFields.begin(), pointerFields.end(), [&](std::vector<PointerField>& fields)
+			{
+				const size_t sdnaIndex = &fields - pointerFields.data();
+				if(m_structArray.at(sdnaIndex).valid)
+					AppendPointerFields(sdnaIndex, 0, structOfType, fields, 0);
+			});
 
-				//PrintBlockSDNA(sceneBlock);
-				//PrintStrucyBySDNA(sceneBlock.blockDesc.sdnaIndex);
+			return pointerFields;
+		}
 
-				const auto renderDataOff = GetFieldOffset("Scene", "r");
-				const auto sfra = *PeekTypePtr<int32_t>(sceneBlock.data, renderDataOff + GetFieldOffset("RenderData", "sfra"));
-				const auto efra = *PeekTypePtr<int32_t>(sceneBlock.data, renderDataOff + GetFieldOffset("RenderData", "efra"));
-				
-				std::cout << "Frame range: " << sfra << '-' << efra << '\n';
+		void AppendPointerFields(size_t sdnaIndex, size_t baseOffset, const std::vector<int32_t>& structOfType, std::vector<PointerField>& out, uint32_t depth) const
+		{
+			if(depth > 32) // embedding can't recurse in valid DNA
+				return;
 
-				const auto collectionAddr = *PeekTypePtr<blender::PtrType>(sceneBlock.data, GetFieldOffset("Scene", "*master_collection"));
+			size_t offset = baseOffset;
+			for(const auto& field: m_structArray.at(sdnaIndex).fields)
+			{
+				const std::string_view fieldName = m_nameArray.at(field.nameIndex).AsString();
+				const size_t typeLength = m_typeArray.at(field.typeIndex).length;
+				const size_t fieldSize = GetFieldSizeByName(fieldName, typeLength);
 
-				for(const auto& collectionBlock: sceneBlock.childBlocks)
+				if(fieldName.starts_with('*'))
 				{
-					if(collectionBlock.desc.oldMemoryAddress == collectionAddr)
-					{
-						TraverseCollections(collectionBlock);
-						break;
-					}
+					for(size_t p=0; p<fieldSize; p+=sizeof(blender::PtrType))
+						out.emplace_back(PointerField{ uint32_t(offset + p), fieldName.starts_with("**") });
 				}
-
-				for(const auto& childBlock: sceneBlock.childBlocks)
+				else if(!fieldName.starts_with("(*") && structOfType[field.typeIndex] >= 0 && typeLength > 0)
 				{
-					if(IdentifyStruct(childBlock.desc.sdnaIndex, "TimeMarker"))
-					{
-						const auto frame = *PeekTypePtr<int32_t>(childBlock.data, GetFieldOffset("TimeMarker", "frame"));
-						std::string_view name(PeekTypePtr<char>(childBlock.data, GetFieldOffset("TimeMarker", "name[64]")));
-						std::cout << "Found a time marker: " << name << " frame: " << frame << '\n';
-					}
+					for(size_t item=0; item<fieldSize / typeLength; ++item)
+						AppendPointerFields(size_t(structOfType[field.typeIndex]), offset + item * typeLength, structOfType, out, depth + 1);
 				}
+
+				offset += fieldSize;
 			}
 		}
 
-		void TraverseCollections(const blender::FileBlock& collectionBlock)
+		// ID blocks hold a struct starting with an embedded ID (linked placeholders are a bare ID).
+		bool IsIdStruct(size_t sdnaIndex) const
 		{
-			assert(IdentifyStruct(collectionBlock.desc.sdnaIndex, "Collection"));
+			if(sdnaIndex == 0 || sdnaIndex >= m_structArray.size())
+				return false;
 
-			//PrintBlockSDNA(collectionBlock);
-			//PrintStrucyBySDNA(collectionBlock.blockDesc.sdnaIndex);
+			const StructDesc& structDesc = m_structArray.at(sdnaIndex);
+			if(m_typeArray.at(structDesc.typeIndex).type.AsString() == "ID")
+				return true;
 
-			std::cout << "Collection name: " << GetBlockNameByID(collectionBlock, true) << '\n';
+			return !structDesc.fields.empty() && m_typeArray.at(structDesc.fields.front().typeIndex).type.AsString() == "ID";
+		}
 
-			const auto* gobjectBase = PeekTypePtr<blender::ListBase>(collectionBlock.data, GetFieldOffset("Collection", "gobject"));
-			blender::PtrType gobjectAddr = gobjectBase->first;
+		static constexpr size_t MissingField = std::numeric_limits<size_t>::max();
 
-			if(gobjectAddr != 0)
-				TraverseCollectionObjects(gobjectAddr);
-			
-			const auto* nextChild = PeekTypePtr<blender::ListBase>(collectionBlock.data, GetFieldOffset("Collection", "children"));
-			if(nextChild->first != 0)
-			{
-				const auto optCollectionChild = FindFileBlockByOldAddr(nextChild->first);
-				if(optCollectionChild.has_value())
-				{
-					const auto& collectionChild = optCollectionChild.value();
-					const auto collectionPtr = *PeekTypePtr<blender::PtrType>(collectionChild.data, GetFieldOffset("CollectionChild", "*collection"));
-					const auto& optCollection = FindFileBlockByOldAddr(collectionPtr);
-					if(optCollection.has_value())
-						TraverseCollections(optCollection.value());
-				}
-			}
+		struct FieldInfo
+		{
+			size_t offset;
+			size_t size;	// whole field, arrays included
+		};
+
+		// Like GetFieldOffset, without reporting a missing field.
+		std::optional<FieldInfo> FindField(const std::string_view sname, const std::string_view fname) const
+		{
+			const auto structIndex = FindStructIndex(sname);
+			if(!structIndex.has_value())
+				return {};
+
+			const auto& fieldIndex = m_structArray.at(structIndex.value()).fieldIndex;
+			const auto it = fieldIndex.find(fname);
+			if(it != fieldIndex.end())
+				return { it->second };
+
+			return {};
 		}
 
-		void TraverseCollectionObjects(const blender::PtrType addr)
+		// Array field by its bare name, for arrays whose length changed between versions: "name" matches 'name[64]' as well as 'name[68]'.
+		std::optional<FieldInfo> FindArrayField(const std::string_view sname, const std::string_view baseName) const
 		{
-			const auto collectionObjectOpt = FindFileBlockByOldAddr(addr);
-			if(!collectionObjectOpt.has_value())
-				return;
+			const auto structIndex = FindStructIndex(sname);
+			if(!structIndex.has_value())
+				return {};
 
-			const blender::FileBlock& collectionObject = collectionObjectOpt.value();
-			assert(IdentifyStruct(collectionObject.desc.sdnaIndex, "CollectionObject"));
+			const std::string prefix = std::string(baseName) + '[';
+			const auto& fieldIndex = m_structArray.at(structIndex.value()).fieldIndex;
+			const auto it = fieldIndex.lower_bound(prefix);
+			if(it != fieldIndex.end() && it->first.starts_with(prefix))
+				return { it->second };
 
-			const auto obAddr = *PeekTypePtr<blender::PtrType>(collectionObject.data, GetFieldOffset("CollectionObject", "*ob"));
-			const auto obOpt = FindFileBlockByOldAddr(obAddr);
-			if(obOpt.has_value())
+			return {};
+		}
+
+		std::optional<size_t> FindFieldOffset(const std::string_view sname, const std::string_view fname) const
+		{
+			const auto field = FindField(sname, fname);
+			if(field.has_value())
+				return { field->offset };
+
+			return {};
+		}
+
+		// MissingField (reported) when neither the struct nor a rename has the field, callers prepared for that use FindFieldOffset.
+		size_t GetFieldOffset(const std::string_view sname, const std::string_view fname) const
+		{
+			const auto field = FindField(sname, fname);
+			if(field.has_value())
+				return field->offset;
+
+			ReportMissingField(sname, fname);
+			return MissingField;
+		}
+
+		std::optional<blender::FileBlock> FindParentObject(blender::PtrType oldAddressOfBlock) const
+		{
+			for(const auto& block: m_blockArray)
 			{
-				const auto& ob = obOpt.value();
-				std::cout << "  Object name: " << GetBlockNameByID(ob, true) << '\n';
+				if(!Identify(block.desc.code, blender::BlockOB, 4))
+					continue;
+
+				const size_t offsetOfDataPtr = GetFieldOffset("Object", "*data");
+				const blender::PtrType dataPtr = PeekField<blender::PtrType>(block, offsetOfDataPtr);
+
+				if(dataPtr == oldAddressOfBlock)
+					return { block };
 			}
 
-			const blender::PtrType nextAddr = *PeekTypePtr<blender::PtrType>(collectionObject.data, GetFieldOffset("CollectionObject", "*next"));
-			if(nextAddr != 0)
-				TraverseCollectionObjects(nextAddr);
+			return {};
 		}
 
-		void ExploreArmature()
+		size_t GetStructSizeByName(const std::string_view structName) const
 		{
-			const auto foundBlock = FindBlockByCode(blender::BlockAR, 0);
-			if(foundBlock.has_value())
-			{
-				const size_t armatureBlockId = foundBlock.value();
-				const auto& block = m_blockArray.at(armatureBlockId);
+			const auto structIndex = FindStructIndex(structName);
+			if(structIndex.has_value())
+				return m_typeArray.at(m_structArray.at(structIndex.value()).typeIndex).length;
 
-				std::cout << "Found armature block!\n";
+			return 0;
+		}
 
-				//PrintBlockSDNA(block);
-				//PrintStrucyBySDNA(block.blockDesc.sdnaIndex);
+		size_t GetFieldSizeByName(const std::string_view fieldName, const size_t fieldLen) const
+		{
+			const size_t length = (fieldName.starts_with('*') || fieldName.starts_with("(*") ? sizeof(blender::PtrType) : fieldLen);
+			size_t count = 1;
 
-				const auto parentObject = FindParentObject(block.desc.oldMemoryAddress);
-				if(parentObject.has_value())
+			const size_t idxOfArray = fieldName.find_first_of('[');
+			if(idxOfArray != std::string::npos)
+			{
+				MemorySpan filedNameSpan = { (uint8_t*)fieldName.data() + idxOfArray, (uint8_t*)fieldName.data() + fieldName.length() };
+				while(filedNameSpan.Size() > 0)
 				{
-					const auto& obBlock = parentObject.value();
-					std::cout << "Parent object name: " << GetBlockNameByID(obBlock, true) << '\n';
-				
-					const auto adtArmatureObAddr = *PeekTypePtr<blender::PtrType>(obBlock.data, GetFieldOffset("Object", "*adt"));
-					if(adtArmatureObAddr != 0)
+					if(*filedNameSpan.Data() == '[')
 					{
-						const auto adtArmature = FindFileBlockByOldAddr(adtArmatureObAddr);
-						assert(adtArmature.has_value());
-						ExploreAnimationData(adtArmature.value());
-					}
-				}
-
-				size_t numBonesForArmature = 0;
+						filedNameSpan.Advance();
+						size_t num = 0;
 
-				size_t nextBlock = armatureBlockId + 1;
-				while(nextBlock < m_blockArray.size())
-				{
-					const auto& dataFileBlock = m_blockArray.at(nextBlock);
-					if(!Identify(dataFileBlock.desc.code, "DATA", 4))
-						break;
+						while(isdigit(*filedNameSpan.Data()))
+						{
+							const uint8_t digit = *filedNameSpan.Data();
+							num = num * 10 + (digit - '0');
+							filedNameSpan.Advance();
+						}
 
-					if(GetStructNameBySDNA(dataFileBlock.desc.sdnaIndex) == "Bone")
+						count *= num;
+						filedNameSpan.Advance(); // ']'
+					}
+					else if(*filedNameSpan.Data() == '\0')
 					{
-						ExploreBone(dataFileBlock);
-						numBonesForArmature++;
+						break;
 					}
-
-					nextBlock++;
-				}
-
-				std::cout << "Number of bones in armature: " << numBonesForArmature << '\n';
-
-				if(parentObject.has_value())
-				{
-					const auto& obBlock = parentObject.value();
-					const auto poseAddr = *PeekTypePtr<blender::PtrType>(obBlock.data, GetFieldOffset("Object", "*pose"));
-					const auto poseBlockOpt = FindFileBlockByOldAddr(poseAddr);
-					if(poseBlockOpt.has_value())
-						ExplorePose(poseBlockOpt.value());
 				}
 			}
+
+			return length * count;
 		}
 
-		void ExploreAnimationData(const blender::FileBlock& adt)
+		bool IdentifyStruct(size_t id, const std::string_view name) const
 		{
-			const auto adtActionPtr = *PeekTypePtr<blender::PtrType>(adt.data, GetFieldOffset("AnimData", "*action"));
-			const auto adtAction = FindFileBlockByOldAddr(adtActionPtr);
-			assert(adtAction.has_value());
-
-			// fcurves of bAnimation
+			assert(id < m_structArray.size());
+			return FindStructIndex(name) == id;
+		}
 
+		bool Identify(const uint8_t* bytes, const char* id, uint32_t n) const
+		{
+			return memcmp(bytes, id, sizeof(uint8_t) * n) == 0;
 		}
 
-		void ExploreBone(const blender::FileBlock& boneBlock)
+		/*DEBUG*/
+		// ID.name is 'name[66]' up to 4.x, 'name[258]' since 5.0.
+		std::string_view GetBlockNameByID(const blender::FileBlock& block, bool offsetBy2) const
 		{
-			std::cout << "--------------\n";
-			const std::string_view nameView(PeekTypePtr<char>(boneBlock.data, GetFieldOffset("Bone", "name[64]")));
-			std::cout << "Bone name: " << nameView << " parent: ";
+			const auto nameField = FindArrayField("ID", "name");
+			if(!nameField.has_value() || nameField->offset >= block.data.Size())
+				return {};
 
-			const auto boneParentAddr = *PeekTypePtr<blender::PtrType>(boneBlock.data, GetFieldOffset("Bone", "*parent"));
-			if(boneParentAddr != 0)
-			{
-				const auto parentBoneOpt = FindFileBlockByOldAddr(boneParentAddr);
-				assert(parentBoneOpt.has_value());
+			const char* name = reinterpret_cast<const char*>(block.data.Data()) + nameField->offset;
+			const std::string_view nameView(name, strnlen(name, std::min(nameField->size, block.data.Size() - nameField->offset)));
+			return (offsetBy2 ? nameView.substr(std::min<size_t>(2, nameView.size())) : nameView);
+		}
 
-				const std::string_view nameView(PeekTypePtr<char>(parentBoneOpt.value().data, GetFieldOffset("Bone", "name[64]")));
-				std::cout << nameView << '\n';
-			}
-			else
-			{
-				std::cout << "null\n";
-			}
+		/*DEBUG*/
+		std::string_view GetStructNameBySDNA(const size_t sdnaIndex) const
+		{
+			assert(sdnaIndex < m_structArray.size());
+			const auto typeIndex = m_structArray.at(sdnaIndex).typeIndex;
+			return m_typeArray.at(typeIndex).type.AsString();
+		}
 
-			if(false)
-			{
-				const auto* armMatBase = PeekTypePtr<float>(boneBlock.data, GetFieldOffset("Bone", "arm_mat[4][4]"));
-				std::cout << "Bone armature matrix: [...]\n";
-			
-				for(size_t i=0; i<16; ++i)
-					std::cout << armMatBase[i] << (i == 15 ? "]\n" : ", ");
-			}
+		/*DEBUG*/
+		void PrintBlockSDNA(const blender::FileBlock& block)
+		{
+			const blender::BlockDesc& desc = block.desc;
+			std::cout << "block code: '" << std::string_view(reinterpret_cast<const char*>(desc.code), 4) << 
+						 "', sdna: " << desc.sdnaIndex << 
+						 ", count: " << desc.count << 
+						 ", size: " << block.data.Size() << 
+						 ", offset: 0x" << std::hex << block.fileOffset << '\n';
 		}
 
-		void ExplorePose(const blender::FileBlock& poseBlock)
+		/*DEBUG*/
+		void PrintStructBySDNA(const size_t sdnaIndex, bool fields = true)
 		{
-			//bPose, bPoseChannel
-			const auto* posechan = PeekTypePtr<blender::ListBase>(poseBlock.data, GetFieldOffset("bPose", "chanbase"));
-			if(posechan->first != 0)
-				TraversePoseChannels(posechan->first);
+			assert(sdnaIndex < m_structArray.size());
+			PrintStruct(m_structArray.at(sdnaIndex), fields);
 		}
 
-		void TraversePoseChannels(const blender::PtrType poseChanAddr)
+		/*DEBUG*/
+		void PrintStructByName(const std::string_view name, bool fields = true)
 		{
-			const auto optPoseChannel = FindFileBlockByOldAddr(poseChanAddr);
-			if(!optPoseChannel.has_value())
-				return;
-
-			const auto& poseChannel = optPoseChannel.value();
-			assert(IdentifyStruct(poseChannel.desc.sdnaIndex, "bPoseChannel"));
-
-			ExplorePoseChannel(poseChannel);
+			for(const auto& structDesc: m_structArray)
+			{
+				const TypeInfo& structTypeInfo = m_typeArray.at(structDesc.typeIndex);
 
-			const blender::PtrType nextAddr = *PeekTypePtr<blender::PtrType>(poseChannel.data, GetFieldOffset("bPoseChannel", "*next"));
-			if(nextAddr != 0)
-				TraversePoseChannels(nextAddr);
+				if(name == structTypeInfo.type.AsString())
+				{
+					PrintStruct(structDesc, fields);
+					return;
+				}
+			}
 		}
 
-		void ExplorePoseChannel(const blender::FileBlock& poseChannel)
+		/*DEBUG*/
+		void PrintStruct(const StructDesc& structDesc, bool fields = true)
 		{
-			std::cout << "--------------\n";
-			const std::string_view chanNameView(PeekTypePtr<char>(poseChannel.data, GetFieldOffset("bPoseChannel", "name[64]")));
-			std::cout << "Found a bPoseChannel: " << chanNameView << '\n';
+			const TypeInfo& structTypeInfo = m_typeArray.at(structDesc.typeIndex);
 
-			const auto chanBoneAddr = *PeekTypePtr<blender::PtrType>(poseChannel.data, GetFieldOffset("bPoseChannel", "*bone"));
-			const auto chanBone = FindFileBlockByOldAddr(chanBoneAddr);
-			assert(chanBone.has_value());
+			std::cout << "struct " << structTypeInfo.type.Data() << " (length: " << structTypeInfo.length << ")\n";
+			size_t offset = 0;
+
+			if(!fields)
+				return;
 
-			const std::string_view boneNameView(PeekTypePtr<char>(chanBone.value().data, GetFieldOffset("Bone", "name[64]")));
-			std::cout << "Channel bone name: " << boneNameView << '\n';
+			std::cout << "{\n";
 
-			if(true)
+			for(const auto& field: structDesc.fields)
 			{
-				const auto* chanMatBase = PeekTypePtr<float>(poseChannel.data, GetFieldOffset("bPoseChannel", "chan_mat[4][4]"));
-				std::cout << "Channel matrix: \n  [";
-			
-				for(size_t i=0; i<16; ++i)
-					std::cout << chanMatBase[i] << (i == 15 ? "]\n" : ", ");
+				const std::string_view fieldName = m_nameArray.at(field.nameIndex).AsString();
+				std::cout << '\t' << m_typeArray.at(field.typeIndex).type.AsString() << ' ' << fieldName << ";\t\t// " << std::dec << offset << '\n';
+
+				offset += GetFieldSizeByName(fieldName, m_typeArray.at(field.typeIndex).length);
 			}
+			std::cout << "};\n";
 		}
 
-		void ExploreMeshData(blendMesh& mesh)
+		void Cleanup()
 		{
-			const auto foundBlock = FindBlockByCode(blender::BlockME, 0);
-			if(foundBlock.has_value())
-			{
-				const size_t meshBlockId = foundBlock.value();
-				const auto& block = m_blockArray.at(meshBlockId);
+			m_blockArray.clear();
+			m_addressMap.clear();
+			m_renderFilter.reset();
+			m_nameArray.clear();
+			m_typeArray.clear();
+			m_structArray.clear();
+			m_structIndex.clear();
+			m_missingFields.clear();
 
-				std::cout << "Mesh name: " << GetBlockNameByID(block, true) << '\n';
+			m_fileMapping.Close();
+			m_fileSpan = {};
+			m_fileFormat = {};
+			m_filePath.clear();
+		}
 
-				const auto totvert = *PeekTypePtr<uint32_t>(block.data, GetFieldOffset("Mesh", "totvert"));
-				const auto totpoly = *PeekTypePtr<uint32_t>(block.data, GetFieldOffset("Mesh", "totpoly"));
-				const auto totloop = *PeekTypePtr<uint32_t>(block.data, GetFieldOffset("Mesh", "totloop"));
+		MemorySpan m_fileSpan;
+		std::string m_filePath;
+		fileMapping m_fileMapping;
+		blender::FileFormat m_fileFormat;
+		AccessMode m_accessMode{ AccessMode::Trusted };
+		BlockValidationReport m_blockReport;
 
-				std::cout << "Verts: " << totvert << " polys: " << totpoly << " loops: " << totloop << '\n';
-				std::cout << '\n';
+		std::vector<blender::FileBlock> m_blockArray;
+		std::unordered_map<blender::PtrType, size_t> m_addressMap; // old memory address -> index in m_blockArray
+		std::optional<RenderVisibility> m_renderFilter; // set by SetRenderVisibleOnly
+		LightmapOptions m_lightmapOptions;
 
-				const auto parentObject = FindParentObject(block.desc.oldMemoryAddress);
-				if(parentObject.has_value())
-				{
-					const auto& obBlock = parentObject.value();
-					std::cout << "Object name: " << GetBlockNameByID(obBlock, true) << '\n';
+		struct TypeInfo
+		{
+			MemorySpan type;
+			uint16_t length;
+		};
 
-					const auto loc = *PeekTypePtr<blender::Float3>(obBlock.data, GetFieldOffset("Object", "loc[3]"));
-					const auto scale = *PeekTypePtr<blender::Float3>(obBlock.data, GetFieldOffset("Object", "size[3]"));
-					const auto quat = *PeekTypePtr<blender::Float4>(obBlock.data, GetFieldOffset("Object", "quat[4]"));
+		std::vector<MemorySpan> m_nameArray;
+		std::vector<TypeInfo> m_typeArray;
 
-					std::cout << "Translation x: " << loc.x << " y: " << loc.y << " z: " << loc.z << '\n';
-					std::cout << "Scale x: " << scale.x << " y: " << scale.y << " z: " << scale.z << '\n';
-					std::cout << "Rotation (quat) w: " << quat.w << " x: "  << quat.x << " y: " << quat.y << " z: " << quat.z << '\n';
+		struct FieldDesc
+		{
+			uint16_t typeIndex;
+			uint16_t nameIndex;
+		};
 
-					for(const auto& childBlock: obBlock.childBlocks)
-					{
-						if(IdentifyStruct(childBlock.desc.sdnaIndex, "ArmatureModifierData"))
-						{
-							const auto arModObject = *PeekTypePtr<blender::PtrType>(childBlock.data, GetFieldOffset("ArmatureModifierData", "*object"));
-							const auto armatureParentObject = FindFileBlockByOldAddr(arModObject);
-							if(armatureParentObject.has_value())
-							{
-								const auto& armatureObBlock = armatureParentObject.value();
-								std::cout << "Armature object name: " << GetBlockNameByID(armatureObBlock, true) << '\n';
-							}
-						}
-					}
+		struct StructDesc
+		{
+			uint16_t typeIndex;
+			std::vector<FieldDesc> fields;
+			std::map<std::string, FieldInfo, std::less<>> fieldIndex; // file and renamed field names, set by BuildFieldIndex
+			bool valid{ false }; // set by ValidateBlockExtents
+		};
 
-					std::cout << '\n';
-				}
+		std::vector<StructDesc> m_structArray;
+		std::map<std::string, size_t, std::less<>> m_structIndex; // file and renamed struct names -> sdna index
 
-				PrintBlockSDNA(block);
-				PrintStructBySDNA(block.desc.sdnaIndex);
+		mutable std::mutex m_missingFieldsMutex;
+		mutable std::set<std::string, std::less<>> m_missingFields;
+};
 
-				size_t nextBlock = meshBlockId + 1;
-				while(nextBlock < m_blockArray.size())
-				{
-					const auto& dataFileBlock = m_blockArray.at(nextBlock);
-					if(!Identify(dataFileBlock.desc.code, "DATA", 4))
-						break;
+/*
+* Batch conversion in a pool of worker processes: a crash (or abort) inside the parser only takes down its worker, the
+* file it was working on is quarantined and a new worker picks up the rest of the queue.
+* The queue lives in a shm::sharedArena: workers claim files with an atomic counter, so throughput stays close to a
+* thread pool. POSIX forks the workers (before the parent touches the parallel algorithms' thread pool), Windows starts
+* this executable again with WorkerSwitch and the arena's mapping name.
+*/
+namespace batch
+{
+	inline constexpr uint32_t MaxPath = 1024;
+	inline constexpr uint32_t MaxWorkers = 64;
+	inline constexpr int64_t Idle = -1;
+	inline constexpr std::string_view WorkerSwitch = "--batch-worker";
 
-					if(false)
-					{
-						std::cout << "----\n";
-						PrintBlockSDNA(dataFileBlock);
-						PrintStructBySDNA(dataFileBlock.desc.sdnaIndex);
-					}
-					else
-					{
-						const blender::FileBlockDesc64& blockDesc = dataFileBlock.desc;
-						const MemorySpan dataSpan = dataFileBlock.data;
+	enum class FileState: uint32_t
+	{
+		Pending,
+		Running,
+		Done,
+		Failed,			// rejected by the parser or the export
+		Quarantined,	// its worker crashed on it
+		TimedOut,		// its worker was killed after BatchOptions::fileTimeout
+	};
 
-						if(IdentifyStruct(blockDesc.sdnaIndex, "MVert"))
-							mesh.Read_MVert(dataSpan, blockDesc.count);
-						else if(IdentifyStruct(blockDesc.sdnaIndex, "MDeformVert"))
-							mesh.Read_MDeformVert(dataSpan, blockDesc.count);
-						else if(IdentifyStruct(blockDesc.sdnaIndex, "MDeformWeight"))
-							mesh.Read_MDeformWeight(dataSpan, blockDesc.count);
-						else if(IdentifyStruct(blockDesc.sdnaIndex, "MLoop"))
-							mesh.Read_MLoop(dataSpan, blockDesc.count);
-						else if(IdentifyStruct(blockDesc.sdnaIndex, "MLoopUV"))
-							mesh.Read_MLoopUV(dataSpan, blockDesc.count);
-						else if(IdentifyStruct(blockDesc.sdnaIndex, "MLoopCol"))
-							mesh.Read_MLoopCol(dataSpan, blockDesc.count);
-						else if(IdentifyStruct(blockDesc.sdnaIndex, "MEdge"))
-							mesh.Read_MEdge(dataSpan, blockDesc.count);
-						else if(IdentifyStruct(blockDesc.sdnaIndex, "MPoly"))
-							mesh.Read_MPoly(dataSpan, blockDesc.count);
-					}
+	inline constexpr uint32_t MaxError = 256;
 
-					nextBlock++;
-				}
-			}		
-		}
+	struct FileSlot
+	{
+		char path[MaxPath];
+		std::atomic<uint32_t> state;
+		std::atomic<int64_t> startedAt;	// steady clock milliseconds, the clock is system wide on both platforms
+		uint32_t numBlocks;
+		uint32_t milliseconds;
+		int32_t exitCode;	// of the crashed worker, negative signal number on POSIX
+		char error[MaxError];
+	};
 
-	private:
-		struct StructDesc;
+	// Per file outcome returned by Run, 'error' is empty for converted files.
+	struct FileResult
+	{
+		std::string path;
+		FileState state;
+		uint32_t numBlocks;
+		uint32_t milliseconds;
+		int32_t exitCode;
+		std::string error;
+	};
 
-		bool ParseFile(std::string_view file)
-		{
-			Cleanup();
+	struct QueueHeader
+	{
+		uint32_t numFiles;
+		uint32_t numWorkers;
+		std::atomic<uint32_t> next;					// next file to hand out
+		std::atomic<int64_t> current[MaxWorkers];	// file the worker is on, Idle between files
+		char outputDir[MaxPath];
+	};
 
-			FILE* f = nullptr;
-			if(fopen_s(&f, file.data(), "rb") == 0 && f != nullptr)
-			{
-				fseek(f, 0, SEEK_END);
-				const size_t fileLen = ftell(f);
-				uint8_t* fileContent = new uint8_t[fileLen];
+	struct BatchOptions
+	{
+		std::filesystem::path outputDir{ "batch" };
+		uint32_t numWorkers{ 0 };	// 0: hardware concurrency
+		std::chrono::seconds fileTimeout{ 600 };	// a worker on one file for longer is killed, 0: no limit
+	};
 
-				fseek(f, 0, SEEK_SET);
-				if(fread(fileContent, sizeof(uint8_t), fileLen, f) == fileLen)
-					m_fileSpan = MemorySpan{ fileContent, fileContent + fileLen };
+	template<size_t N>
+	inline bool CopyPath(char (&dst)[N], const std::string& src)
+	{
+		memset(dst, 0, N);
+		if(src.size() >= N)
+			return false;
 
-				fclose(f);
-			}
+		memcpy(dst, src.data(), src.size());
+		return true;
+	}
 
-			if(m_fileSpan.Empty())
-			{
-				std::cout << "File not found!\n";
-				return false;
-			}
+	// Truncates, the message is for the report only.
+	inline void SetError(FileSlot& slot, const std::string& error)
+	{
+		CopyPath(slot.error, error.substr(0, MaxError - 1));
+	}
 
-			MemorySpan memoryStream = m_fileSpan;
-			const auto* blendHeader = ReadTypePtr<blender::FileHeader>(memoryStream);
+	inline int64_t NowMilliseconds()
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
 
-			if(memcmp(blendHeader->id, blender::HeaderID, sizeof(blender::HeaderID)) != 0)
-			{
-				std::cout << "ERROR - file header magic mismatch!\n";
-				return false;
-			}
+	// Last "ERROR - ...!" line the export printed, the parser and exporter report through std::cout.
+	inline std::string LastError(const std::string& log)
+	{
+		const size_t pos = log.rfind("ERROR - ");
+		if(pos == std::string::npos)
+			return "conversion failed";
 
-			assert(blendHeader->pointerSize == '-' || blendHeader->pointerSize == '_');
-			const blender::PointerSize ptrSize = (blendHeader->pointerSize == '_' ? blender::PointerSize::PTR_4 : blender::PointerSize::PTR_8);
-			const blender::Endianness endian = (blendHeader->endianness == 'v' ? blender::Endianness::LittleEndian : blender::Endianness::BigEndian);
+		const size_t end = log.find('\n', pos);
+		return log.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+	}
 
-			if(ptrSize != blender::PointerSize::PTR_8 || endian != blender::Endianness::LittleEndian)
-			{
-				std::cout << "ERROR - this parser supports only 64bit, little endian blend files!\n";
-				return false;
-			}
+	// The queue is the arena's first entry, a Windows worker finds it by that after opening the mapping.
+	inline QueueHeader* Queue(const shm::sharedArena& arena)
+	{
+		const shm::Entry& entry = arena.Header()->entries[0];
+		return entry.kind == shm::EntryKind::BatchQueue ? reinterpret_cast<QueueHeader*>(arena.At(entry.offset)) : nullptr;
+	}
+
+	inline FileSlot* Files(QueueHeader* queue)
+	{
+		return reinterpret_cast<FileSlot*>(reinterpret_cast<uint8_t*>(queue) + sizeof(QueueHeader));
+	}
 
-			std::cout << "Blender version: " << std::string_view(reinterpret_cast<const char*>(blendHeader->version), 3) << " - ptr size 8, little-endian.\n";
+	inline int RunWorker(const shm::sharedArena& arena, uint32_t worker)
+	{
+		QueueHeader* queue = Queue(arena);
+		if(queue == nullptr || worker >= queue->numWorkers)
+			return 1;
 
-			size_t blockCount = 0;
-			size_t parentId = -1;
+		FileSlot* files = Files(queue);
 
-			while(!memoryStream.Empty())
-			{
-				auto* blendBlock = ReadTypePtr<blender::FileBlockDesc64>(memoryStream);
+		// The parent reports, a file's output is only kept for its error message.
+		std::ostringstream log;
+		std::streambuf* const coutBuffer = std::cout.rdbuf(log.rdbuf());
 
-				blender::FileBlock block;
-				block.desc = *blendBlock;
-				block.data = MemorySpan{ memoryStream.begin, memoryStream.begin + blendBlock->size };
-				block.fileOffset = reinterpret_cast<uint8_t*>(blendBlock) - m_fileSpan.begin;
-				m_blockArray.emplace_back(block);
+		while(true)
+		{
+			const uint32_t f = queue->next.fetch_add(1);
+			if(f >= queue->numFiles)
+				break;
+
+			// Published before the slot is claimed, so a crash in between still leaves the parent a file to settle.
+			FileSlot& slot = files[f];
+			const int64_t start = NowMilliseconds();
+			slot.startedAt.store(start);
+			queue->current[worker].store(f);
+
+			// Slots the parent already failed (eg. path too long) are skipped.
+			uint32_t expected = uint32_t(FileState::Pending);
+			if(!slot.state.compare_exchange_strong(expected, uint32_t(FileState::Running)))
+			{
+				queue->current[worker].store(Idle);
+				continue;
+			}
 
-				if(Identify(blendBlock->code, blender::BlockDATA, 4))
-				{
-					assert(parentId != -1);
-					m_blockArray.at(parentId).childBlocks.emplace_back(block);
-				}
-				else
-				{
-					if(Identify(blendBlock->code, blender::BlockSDNA, 4))
-						ParseSDNA(blendBlock, memoryStream);
-					else if(Identify(blendBlock->code, blender::EOBMark, 4))
-						break;
+			log.str({});
+			blendExpl blend;
+			const bool ok = blend.ConvertFile(slot.path, std::filesystem::path(queue->outputDir) / std::filesystem::path(slot.path).stem());
 
-					parentId = m_blockArray.size() - 1;
-				}
+			slot.numBlocks = uint32_t(blend.NumBlocks());
+			slot.milliseconds = uint32_t(NowMilliseconds() - start);
+			if(!ok)
+				SetError(slot, LastError(log.str()));
 
-				memoryStream.Advance(blendBlock->size);
-				memoryStream.Align4();
-				blockCount++;
-			}
+			// The parent timed the file out and is about to kill this worker, stay off the next file.
+			expected = uint32_t(FileState::Running);
+			if(!slot.state.compare_exchange_strong(expected, uint32_t(ok ? FileState::Done : FileState::Failed)))
+				break;
 
-			std::cout << "End of parsing.\n";
-			return true;
+			queue->current[worker].store(Idle);
 		}
 
-		void ParseSDNA(blender::FileBlockDesc64* block, MemorySpan blockSpan)
-		{
-			const size_t sdnaDataSize = block->size;
-			std::cout << "DNA1 block begin - size: " << block->size << '\n';
+		std::cout.rdbuf(coutBuffer);
+		return 0;
+	}
 
-			//sdna block header
-			const auto* sdnaHeaderId = ReadTypePtr<uint8_t>(blockSpan, 4); // 'SDNA'
-			assert(Identify(sdnaHeaderId, "SDNA", 4));
+#if defined(_WIN32)
+	inline int RunWorkerProcess(const std::string& arenaName, uint32_t worker)
+	{
+		shm::sharedArena arena;
+		return arena.Open(arenaName) ? RunWorker(arena, worker) : 1;
+	}
+#endif
 
-			//read names array
+	class workerPool
+	{
+		public:
+			explicit workerPool(shm::sharedArena& arena, const std::string& arenaName):
+				m_arena(arena), m_arenaName(arenaName)
 			{
-				const auto* sdnaName = ReadTypePtr<uint8_t>(blockSpan, 4); // 'NAME'
-				assert(Identify(sdnaName, "NAME", 4));
-				const uint32_t nameCount = *ReadTypePtr<uint32_t>(blockSpan);
-
-				m_nameArray.reserve(nameCount);
+			}
 
-				for(size_t i=0; i<nameCount; ++i)
+			~workerPool()
+			{
+#if defined(_WIN32)
+				for(HANDLE process: m_processes)
 				{
-					MemorySpan nameSpan = { blockSpan.begin };
+					if(process != nullptr)
+						CloseHandle(process);
+				}
+#endif
+			}
 
-					while(!blockSpan.Empty() && *blockSpan.Data() != 0)
-						blockSpan.Advance();
+			bool Spawn(uint32_t worker)
+			{
+#if defined(_WIN32)
+				char exePath[MAX_PATH]{};
+				GetModuleFileNameA(nullptr, exePath, MAX_PATH);
+
+				std::string cmdLine = "\"" + std::string(exePath) + "\" " + std::string(WorkerSwitch) + " " + m_arenaName + " " + std::to_string(worker);
+
+				STARTUPINFOA startupInfo{};
+				startupInfo.cb = sizeof(startupInfo);
+				PROCESS_INFORMATION processInfo{};
+				if(!CreateProcessA(nullptr, cmdLine.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startupInfo, &processInfo))
+					return false;
+
+				CloseHandle(processInfo.hThread);
+				m_processes.resize(std::max<size_t>(m_processes.size(), worker + 1), nullptr);
+				m_processes[worker] = processInfo.hProcess;
+#else
+				std::cout.flush();
+				fflush(stdout);
+
+				const pid_t pid = fork();
+				if(pid < 0)
+					return false;
+
+				if(pid == 0)
+					_exit(RunWorker(m_arena, worker));
+
+				m_processes.resize(std::max<size_t>(m_processes.size(), worker + 1), -1);
+				m_processes[worker] = pid;
+#endif
+				m_live++;
+				return true;
+			}
 
-					blockSpan.Advance(); //string terminating 0
-					nameSpan.end = blockSpan.Data();
+			struct Exit
+			{
+				uint32_t worker;
+				int32_t exitCode;
+				bool crashed;
+			};
 
-					m_nameArray.emplace_back(nameSpan);
-				}
-			}
+			uint32_t Live() const { return m_live; }
 
-			uint32_t typeCount = 0;
+			void Kill(uint32_t worker)
+			{
+#if defined(_WIN32)
+				if(worker < m_processes.size() && m_processes[worker] != nullptr)
+					TerminateProcess(m_processes[worker], 1);
+#else
+				if(worker < m_processes.size() && m_processes[worker] > 0)
+					kill(m_processes[worker], SIGKILL);
+#endif
+			}
 
-			//read types array
+			// Waits up to 'timeout' for a worker to exit; empty on timeout or when none is left (all killed if waiting fails).
+			std::optional<Exit> WaitAny(std::chrono::milliseconds timeout)
 			{
-				blockSpan.Align4();
-				const auto* sdnaTypes = ReadTypePtr<uint8_t>(blockSpan, 4); // 'TYPE'
-				assert(Identify(sdnaTypes, "TYPE", 4));
-				typeCount = *ReadTypePtr<uint32_t>(blockSpan);
+				if(m_live == 0)
+					return {};
 
-				m_typeArray.reserve(typeCount);
+				Exit exit{};
 
-				for(size_t i=0; i<typeCount; ++i)
+#if defined(_WIN32)
+				std::vector<HANDLE> handles;
+				std::vector<uint32_t> workers;
+				for(uint32_t w=0; w<m_processes.size(); ++w)
 				{
-					MemorySpan typeSpan = { blockSpan.begin };
+					if(m_processes[w] != nullptr)
+					{
+						handles.emplace_back(m_processes[w]);
+						workers.emplace_back(w);
+					}
+				}
 
-					while(!blockSpan.Empty() && *blockSpan.Data() != 0)
-						blockSpan.Advance();
+				const DWORD result = WaitForMultipleObjects(DWORD(handles.size()), handles.data(), FALSE, DWORD(timeout.count()));
+				if(result == WAIT_FAILED)
+				{
+					// the workers can't be waited for any more, stop them so the caller sees none left
+					std::cout << "ERROR - waiting for the batch workers failed with error " << GetLastError() << "!\n";
+					for(uint32_t w=0; w<m_processes.size(); ++w)
+					{
+						if(m_processes[w] == nullptr)
+							continue;
 
-					blockSpan.Advance(); // string terminating 0
-					typeSpan.end = blockSpan.Data();
+						TerminateProcess(m_processes[w], 1);
+						CloseHandle(m_processes[w]);
+						m_processes[w] = nullptr;
+					}
 
-					m_typeArray.emplace_back(TypeInfo{ typeSpan, 0 });
+					m_live = 0;
+					return {};
 				}
-			}
 
-			//read lengths array
-			{
-				blockSpan.Align4();
-				const auto* sdnaLengths = ReadTypePtr<uint8_t>(blockSpan, 4); // 'TLEN'
-				assert(Identify(sdnaLengths, "TLEN", 4));
+				if(result < WAIT_OBJECT_0 || result >= WAIT_OBJECT_0 + handles.size())
+					return {};
+
+				exit.worker = workers[result - WAIT_OBJECT_0];
+
+				DWORD code = 0;
+				GetExitCodeProcess(m_processes[exit.worker], &code);
+				CloseHandle(m_processes[exit.worker]);
+				m_processes[exit.worker] = nullptr;
 
-				for(size_t i=0; i<typeCount; ++i)
+				exit.exitCode = int32_t(code);
+#else
+				// waitpid has no timeout, poll.
+				const auto deadline = std::chrono::steady_clock::now() + timeout;
+				int status = 0;
+				pid_t pid;
+				while(true)
 				{
-					const uint16_t len = *ReadTypePtr<uint16_t>(blockSpan);
-					m_typeArray.at(i).length = len;
+					pid = waitpid(-1, &status, WNOHANG);
+					if(pid > 0 || (pid < 0 && errno != EINTR))
+						break;
+
+					if(pid == 0 && std::chrono::steady_clock::now() >= deadline)
+						return {};
+
+					if(pid == 0)
+						std::this_thread::sleep_for(std::chrono::milliseconds(5));
 				}
-			}
 
-			//read structures array
-			{
-				blockSpan.Align4();
-				const auto* sdnaStructs = ReadTypePtr<uint8_t>(blockSpan, 4); // 'STRC'
-				assert(Identify(sdnaStructs, "STRC", 4));
-				const uint32_t structCount = *ReadTypePtr<uint32_t>(blockSpan);
-				
-				m_structArray.resize(structCount);
+				// ECHILD: nothing left to wait for.
+				if(pid < 0)
+					m_live = 0;
 
-				for(size_t i=0; i<structCount; ++i)
-				{
-					StructDesc& structDesc = m_structArray.at(i);
-					structDesc.typeIndex = *ReadTypePtr<uint16_t>(blockSpan);
-					
-					const uint16_t numFields = *ReadTypePtr<uint16_t>(blockSpan);
-					structDesc.fields.reserve(numFields);
+				const auto it = std::find(m_processes.begin(), m_processes.end(), pid);
+				if(pid < 0 || it == m_processes.end())
+					return {};
 
-					for(uint16_t f=0; f<numFields; ++f)
-					{
-						const uint16_t fieldTypeIdx = *ReadTypePtr<uint16_t>(blockSpan);
-						const uint16_t fieldNameIdx = *ReadTypePtr<uint16_t>(blockSpan);
-						structDesc.fields.emplace_back(FieldDesc{ fieldTypeIdx, fieldNameIdx });
-					}
-				}
+				exit.worker = uint32_t(it - m_processes.begin());
+				*it = -1;
+
+				exit.exitCode = (WIFSIGNALED(status) ? -WTERMSIG(status) : WEXITSTATUS(status));
+#endif
+				exit.crashed = (exit.exitCode != 0);
+				m_live--;
+				return exit;
 			}
 
-			std::cout << "DNA1 block end.\n";
-		}
+		private:
+			shm::sharedArena& m_arena;
+			std::string m_arenaName;
+			uint32_t m_live{ 0 };
+#if defined(_WIN32)
+			std::vector<HANDLE> m_processes;
+#else
+			std::vector<pid_t> m_processes;
+#endif
+	};
 
-		std::string_view GetUserName(const std::string_view name)
-		{
-			const size_t offset = (name.starts_with("ME") ? 2 : 0);
-			const size_t firstZero = name.find_first_of('\0', offset);
-			return std::string_view(name.data() + offset, firstZero - offset);
-		}
+	// Kills the workers which are on one file for longer than 'timeout', their file is marked TimedOut.
+	inline void KillHungWorkers(QueueHeader* queue, workerPool& pool, std::chrono::seconds timeout)
+	{
+		if(timeout.count() == 0)
+			return;
 
-		std::optional<size_t> FindBlockByCode(const char* code, size_t offset) const
+		FileSlot* slots = Files(queue);
+		const int64_t now = NowMilliseconds();
+		for(uint32_t w=0; w<queue->numWorkers; ++w)
 		{
-			for(size_t i=offset; i<m_blockArray.size(); ++i)
+			const int64_t f = queue->current[w].load();
+			if(f == Idle || now - slots[f].startedAt.load() < std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count())
+				continue;
+
+			// Losing the exchange means the worker finished the file meanwhile.
+			uint32_t expected = uint32_t(FileState::Running);
+			if(slots[f].state.compare_exchange_strong(expected, uint32_t(FileState::TimedOut)))
 			{
-				if(Identify(m_blockArray.at(i).desc.code, code, 4))
-					return { i };
+				SetError(slots[f], "no result after " + std::to_string(timeout.count()) + " s");
+				pool.Kill(w);
 			}
+		}
+	}
 
+	/*
+	* Converts every file in 'files' to world partition containers under outputDir/<file stem>. Files the workers crash
+	* or hang on are copied to outputDir/quarantine and listed in outputDir/quarantine.txt, every file's outcome is
+	* written to outputDir/results.txt. Returns the outcome per file, in the order of 'files'.
+	*/
+	inline std::vector<FileResult> Run(const std::vector<std::string>& files, const BatchOptions& options = {})
+	{
+		const uint32_t numFiles = uint32_t(files.size());
+		const uint32_t numWorkers = std::clamp<uint32_t>(options.numWorkers > 0 ? options.numWorkers : std::thread::hardware_concurrency(), 1, std::min(MaxWorkers, std::max(numFiles, 1u)));
+
+#if defined(_WIN32)
+		const std::string arenaName = "blendexpl_batch_" + std::to_string(GetCurrentProcessId());
+#else
+		const std::string arenaName = "blendexpl_batch";
+#endif
+		const size_t queueBytes = sizeof(QueueHeader) + sizeof(FileSlot) * numFiles;
+
+		shm::sharedArena arena;
+		uint64_t queueOffset = 0;
+		uint8_t* queueMem = nullptr;
+		if(!arena.Create(sizeof(shm::ArenaHeader) + queueBytes + 2 * shm::DataAlignment, arenaName) || (queueMem = arena.Allocate<uint8_t>(queueBytes, queueOffset)) == nullptr)
+		{
+			std::cout << "ERROR - could not set up the batch queue!\n";
 			return {};
 		}
 
-		std::optional<blender::FileBlock> FindFileBlockByOldAddr(blender::PtrType oldAddressOfBlock) const
-		{
-			if(oldAddressOfBlock != 0)
-			{
-				for(const auto& block: m_blockArray)
-				{
-					if(block.desc.oldMemoryAddress == oldAddressOfBlock)
-						return { block };
-				}
-			}
+		QueueHeader* queue = new(queueMem) QueueHeader{};
+		queue->numFiles = numFiles;
+		queue->numWorkers = numWorkers;
+		for(auto& current: queue->current)
+			current = Idle;
 
+		if(!CopyPath(queue->outputDir, options.outputDir.string()))
+		{
+			std::cout << "ERROR - output path is too long!\n";
 			return {};
 		}
 
-		size_t GetFieldOffset(const std::string_view sname, const std::string_view fname) const
+		FileSlot* slots = Files(queue);
+		for(uint32_t f=0; f<numFiles; ++f)
 		{
-			size_t offset = 0;
-			for(size_t i=0; i<m_structArray.size(); ++i)
+			FileSlot* slot = new(&slots[f]) FileSlot{};
+			if(!CopyPath(slot->path, files[f]))
 			{
-				const StructDesc& structDesc = m_structArray.at(i);
-				const TypeInfo& structTypeInfo = m_typeArray.at(structDesc.typeIndex);
-				if(sname == structTypeInfo.type.AsString())
-				{
-					for(const auto& field: structDesc.fields)
-					{
-						const std::string_view fieldName = m_nameArray.at(field.nameIndex).AsString();
-						if(fname == fieldName)
-							break;
+				slot->state = uint32_t(FileState::Failed);
+				SetError(*slot, "path is too long");
+			}
+		}
 
-						offset += GetFieldSizeByName(fieldName, m_typeArray.at(field.typeIndex).length);
-					}
+		arena.AddEntry("batch", shm::EntryKind::BatchQueue, numFiles, queueOffset, queueBytes);
 
-					break;
-				}
-			}
+		std::error_code ec;
+		std::filesystem::create_directories(options.outputDir, ec);
 
-			return offset;
+		workerPool pool(arena, arenaName);
+		for(uint32_t w=0; w<numWorkers; ++w)
+		{
+			if(!pool.Spawn(w))
+				std::cout << "ERROR - could not start worker " << w << "!\n";
 		}
 
-		std::optional<blender::FileBlock> FindParentObject(blender::PtrType oldAddressOfBlock) const
+		while(pool.Live() > 0)
 		{
-			for(const auto& block: m_blockArray)
+			const auto exit = pool.WaitAny(std::chrono::milliseconds(100));
+			if(!exit.has_value())
 			{
-				if(!Identify(block.desc.code, blender::BlockOB, 4))
-					continue;
+				KillHungWorkers(queue, pool, options.fileTimeout);
+				continue;
+			}
 
-				const size_t offsetOfDataPtr = GetFieldOffset("Object", "*data");
-				const blender::PtrType dataPtr = *PeekTypePtr<blender::PtrType>(block.data, offsetOfDataPtr);
+			// A worker only leaves a file behind when it crashed or was killed.
+			const int64_t f = queue->current[exit->worker].exchange(Idle);
+			if(f == Idle)
+				continue;
 
-				if(dataPtr == oldAddressOfBlock)
-					return { block };
-			}
+			uint32_t expected = uint32_t(FileState::Running);
+			if(slots[f].state.compare_exchange_strong(expected, uint32_t(FileState::Quarantined)))
+				SetError(slots[f], "worker crashed");
+			else if(expected == uint32_t(FileState::Pending) && slots[f].state.compare_exchange_strong(expected, uint32_t(FileState::Failed)))
+				SetError(slots[f], "worker crashed before starting the file");
 
-			return {};
+			slots[f].exitCode = exit->exitCode;
+
+			if(queue->next.load() < numFiles && !pool.Spawn(exit->worker))
+				std::cout << "ERROR - could not restart worker " << exit->worker << "!\n";
 		}
 
-		size_t GetStructSizeByName(const std::string_view structName) const
+		// No worker is left: Pending files were never handed out, Running ones lost their worker with the wait.
+		for(uint32_t f=0; f<numFiles; ++f)
 		{
-			for(const auto& structDesc: m_structArray)
-			{
-				const TypeInfo& structTypeInfo = m_typeArray.at(structDesc.typeIndex);
+			uint32_t expected = uint32_t(FileState::Pending);
+			if(slots[f].state.compare_exchange_strong(expected, uint32_t(FileState::Failed)))
+				SetError(slots[f], "worker spawn failed");
+			else if(expected == uint32_t(FileState::Running) && slots[f].state.compare_exchange_strong(expected, uint32_t(FileState::Failed)))
+				SetError(slots[f], "worker lost");
+		}
 
-				if(structName == structTypeInfo.type.AsString())
-					return structTypeInfo.length;
+		std::vector<FileResult> results;
+		results.reserve(numFiles);
+		size_t converted = 0;
+		size_t quarantined = 0;
+		for(uint32_t f=0; f<numFiles; ++f)
+		{
+			const FileSlot& slot = slots[f];
+			const FileResult& result = results.emplace_back(FileResult{ files[f], FileState(slot.state.load()), slot.numBlocks, slot.milliseconds, slot.exitCode, slot.error });
+			switch(result.state)
+			{
+				case FileState::Done:
+					std::cout << "OK          " << result.path << " blocks: " << result.numBlocks << " (" << result.milliseconds << " ms)\n";
+					converted++;
+					break;
+				case FileState::Quarantined:
+					std::cout << "QUARANTINED " << result.path << " worker exit code: " << result.exitCode << '\n';
+					quarantined++;
+					break;
+				case FileState::TimedOut:
+					std::cout << "TIMED OUT   " << result.path << " - " << result.error << '\n';
+					quarantined++;
+					break;
+				default:
+					std::cout << "FAILED      " << result.path << " - " << result.error << '\n';
+					break;
 			}
-
-			return 0;
 		}
 
-		size_t GetFieldSizeByName(const std::string_view fieldName, const size_t fieldLen) const
+		std::ofstream list(options.outputDir / "results.txt");
+		constexpr const char* StateNames[] = { "pending", "running", "done", "failed", "quarantined", "timed out" };
+		for(const FileResult& result: results)
+			list << result.path << '\t' << StateNames[uint32_t(result.state)] << '\t' << result.numBlocks << '\t' << result.milliseconds << '\t' << result.exitCode << '\t' << result.error << '\n';
+
+		if(quarantined > 0)
 		{
-			const size_t length = (fieldName.starts_with('*') || fieldName.starts_with("(*") ? sizeof(blender::PtrType) : fieldLen);
-			size_t count = 1;
+			const std::filesystem::path quarantineDir = options.outputDir / "quarantine";
+			std::filesystem::create_directories(quarantineDir, ec);
 
-			const size_t idxOfArray = fieldName.find_first_of('[');
-			if(idxOfArray != std::string::npos)
+			std::ofstream quarantineList(options.outputDir / "quarantine.txt");
+			for(const FileResult& result: results)
 			{
-				MemorySpan filedNameSpan = { (uint8_t*)fieldName.data() + idxOfArray, (uint8_t*)fieldName.data() + fieldName.length() };
-				while(filedNameSpan.Size() > 0)
-				{
-					if(*filedNameSpan.Data() == '[')
-					{
-						filedNameSpan.Advance();
-						size_t num = 0;
-
-						while(isdigit(*filedNameSpan.Data()))
-						{
-							const uint8_t digit = *filedNameSpan.Data();
-							num = num * 10 + (digit - '0');
-							filedNameSpan.Advance();
-						}
+				if(result.state != FileState::Quarantined && result.state != FileState::TimedOut)
+					continue;
 
-						count *= num;
-						filedNameSpan.Advance(); // ']'
-					}
-					else if(*filedNameSpan.Data() == '\0')
-					{
-						break;
-					}
-				}
+				std::filesystem::copy_file(result.path, quarantineDir / std::filesystem::path(result.path).filename(), std::filesystem::copy_options::overwrite_existing, ec);
+				quarantineList << result.path << '\t' << result.exitCode << '\t' << result.error << '\n';
 			}
-
-			return length * count;
 		}
 
-		bool IdentifyStruct(size_t id, const std::string_view name) const
-		{
-			assert(id < m_structArray.size());
-			const StructDesc& structDesc = m_structArray.at(id);
-			const TypeInfo& structTypeInfo = m_typeArray.at(structDesc.typeIndex);
+		std::cout << "Batch - files: " << numFiles << " converted: " << converted << " quarantined: " << quarantined << " workers: " << numWorkers << '\n';
+		return results;
+	}
+}
 
-			return (name == structTypeInfo.type.AsString());
-		}
+/*
+* Self checks of the paths a sample file can't cover on its own, run with --selftest <file>. Every check prints one
+* line and returns false on a failure.
+*/
+namespace selftest
+{
+	inline bool Report(std::string_view name, bool ok)
+	{
+		std::cout << "Self test " << name << ": " << (ok ? "OK" : "FAILED") << '\n';
+		return ok;
+	}
 
-		bool Identify(const uint8_t* bytes, const char* id, uint32_t n) const
+	/*
+	* Producer and consumer ends of a shared memory handoff in one process: produce(arena, bell) runs on a thread of
+	* its own, consume(arena, bell) on the calling one. False when the two ends couldn't be connected.
+	*/
+	template<typename P, typename C>
+	bool RunHandoff(size_t capacity, P&& produce, C&& consume)
+	{
+		shm::sharedArena producerArena, consumerArena;
+		shm::doorbell producerBell, consumerBell;
+
+#if defined(_WIN32)
+		const std::string channel = "blendexpl_selftest_" + std::to_string(GetCurrentProcessId());
+		if(!producerArena.Create(capacity, channel + "_arena") || !producerBell.Create(channel + "_bell") ||
+		   !consumerArena.Open(channel + "_arena") || !consumerBell.Connect(channel + "_bell"))
+			return false;
+
+		std::thread producer([&]() { produce(producerArena, producerBell); });
+#else
+		const std::string channel = (std::filesystem::temp_directory_path() / ("blendexpl_selftest_" + std::to_string(getpid()))).string();
+		if(!producerArena.Create(capacity, "blendexpl_selftest"))
+			return false;
+
+		std::thread producer([&]()
 		{
-			return memcmp(bytes, id, sizeof(uint8_t) * n) == 0;
-		}
+			if(producerBell.Accept(channel, producerArena.Descriptor()))
+				produce(producerArena, producerBell);
+		});
 
-		/*DEBUG*/
-		std::string_view GetBlockNameByID(const blender::FileBlock& block, bool offsetBy2)
+		// the producer may not listen yet
+		int fd = -1;
+		for(int attempt=0; attempt<1000 && fd < 0; ++attempt)
 		{
-			const std::string_view nameView(PeekTypePtr<char>(block.data, GetFieldOffset("ID", "name[66]")));
-			return (offsetBy2 ? nameView.substr(2) : nameView);
+			fd = consumerBell.Connect(channel);
+			if(fd < 0)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
 		}
 
-		/*DEBUG*/
-		std::string_view GetStructNameBySDNA(const size_t sdnaIndex)
+		if(fd < 0 || !consumerArena.Open(fd))
 		{
-			assert(sdnaIndex < m_structArray.size());
-			const auto typeIndex = m_structArray.at(sdnaIndex).typeIndex;
-			return m_typeArray.at(typeIndex).type.AsString();
+			producer.detach(); // blocked in Accept for good
+			return false;
 		}
+#endif
 
-		/*DEBUG*/
-		void PrintBlockSDNA(const blender::FileBlock& block)
-		{
-			const blender::FileBlockDesc64& desc = block.desc;
-			std::cout << "block code: '" << std::string_view(reinterpret_cast<const char*>(desc.code), 4) << 
-						 "', sdna: " << desc.sdnaIndex << 
-						 ", count: " << desc.count << 
-						 ", size: " << block.data.Size() << 
-						 ", offset: 0x" << std::hex << block.fileOffset << '\n';
-		}
+		consume(consumerArena, consumerBell);
+		producer.join();
+		return true;
+	}
 
-		/*DEBUG*/
-		void PrintStructBySDNA(const size_t sdnaIndex, bool fields = true)
-		{
-			assert(sdnaIndex < m_structArray.size());
-			PrintStruct(m_structArray.at(sdnaIndex), fields);
-		}
+	// A consumer which falls behind by more than the descriptor table and the ring: the producer has to wait, every entry arrives once, in order.
+	inline bool SharedBackPressure()
+	{
+		constexpr uint32_t numEntries = shm::MaxEntries * 3 + 7;
+		bool published = false;
+		uint32_t received = 0;
+		bool inOrder = true;
 
-		/*DEBUG*/
-		void PrintStructByName(const std::string_view name, bool fields = true)
+		const bool connected = RunHandoff(sizeof(shm::ArenaHeader) + size_t(numEntries + 1) * shm::DataAlignment, [&](shm::sharedArena& arena, shm::doorbell& bell)
 		{
-			for(const auto& structDesc: m_structArray)
+			published = true;
+			for(uint32_t i=0; i<numEntries && published; ++i)
 			{
-				const TypeInfo& structTypeInfo = m_typeArray.at(structDesc.typeIndex);
-
-				if(name == structTypeInfo.type.AsString())
+				uint64_t offset = 0;
+				uint32_t* value = arena.Allocate<uint32_t>(1, offset);
+				published = (value != nullptr);
+				if(published)
 				{
-					PrintStruct(structDesc, fields);
-					return;
+					*value = i;
+					published = shm::PublishEntry(arena, bell, "entry", shm::EntryKind::Indices, 1, offset, sizeof(uint32_t));
 				}
 			}
-		}
 
-		/*DEBUG*/
-		void PrintStruct(const StructDesc& structDesc, bool fields = true)
+			arena.Header()->closed.store(1, std::memory_order_release);
+			bell.Ring();
+		},
+		[&](shm::sharedArena& arena, shm::doorbell& bell)
 		{
-			const TypeInfo& structTypeInfo = m_typeArray.at(structDesc.typeIndex);
-
-			std::cout << "struct " << structTypeInfo.type.Data() << " (length: " << structTypeInfo.length << ")\n";
-			size_t offset = 0;
+			std::this_thread::sleep_for(std::chrono::milliseconds(50)); // let the producer run into the full table
+			shm::Consume(arena, bell, [&](const shm::Entry& entry, const void* data)
+			{
+				uint32_t value = 0;
+				memcpy(&value, data, sizeof(value));
+				inOrder = inOrder && entry.kind == shm::EntryKind::Indices && entry.count == 1 && value == received;
+				received++;
+			});
+		});
+
+		return Report("shared memory back-pressure", connected && published && inOrder && received == numEntries);
+	}
 
-			if(!fields)
-				return;
+	// Meshes published from 'file' read back on the consumer side match the extracted arrays.
+	inline bool SharedMeshes(const std::string& file)
+	{
+		blendExpl blend;
+		if(!blend.ParseFile(file))
+			return Report("shared memory meshes", false);
 
-			std::cout << "{\n";
+		size_t published = 0;
+		std::map<std::string, std::vector<blender::Float3>> positions;
+		std::map<std::string, std::vector<uint32_t>> indices;
 
-			for(const auto& field: structDesc.fields)
+		const bool connected = RunHandoff(size_t(64) << 20, [&](shm::sharedArena& arena, shm::doorbell& bell)
+		{
+			published = blend.PublishMeshes(arena, bell);
+		},
+		[&](shm::sharedArena& arena, shm::doorbell& bell)
+		{
+			shm::Consume(arena, bell, [&](const shm::Entry& entry, const void* data)
 			{
-				const std::string_view fieldName = m_nameArray.at(field.nameIndex).AsString();
-				std::cout << '\t' << m_typeArray.at(field.typeIndex).type.AsString() << ' ' << fieldName << ";\t\t// " << std::dec << offset << '\n';
-
-				offset += GetFieldSizeByName(fieldName, m_typeArray.at(field.typeIndex).length);
+				if(entry.kind == shm::EntryKind::Positions)
+					positions[entry.name].assign(static_cast<const blender::Float3*>(data), static_cast<const blender::Float3*>(data) + entry.count);
+				else if(entry.kind == shm::EntryKind::Indices)
+					indices[entry.name].assign(static_cast<const uint32_t*>(data), static_cast<const uint32_t*>(data) + entry.count);
+			});
+		});
+
+		bool match = connected && published > 0 && positions.size() == published && indices.size() == published;
+		for(const auto& [name, meshPositions]: positions)
+		{
+			const auto meshBlockId = blend.FindMeshByName(name);
+			if(!meshBlockId.has_value() || !indices.contains(name))
+			{
+				match = false;
+				continue;
 			}
-			std::cout << "};\n";
+
+			blendMesh expected;
+			blend.ExtractMeshData(meshBlockId.value(), expected);
+			expected.Validate(MeshRepair::Drop);
+			match = match && expected.Positions().size() == meshPositions.size() && expected.Triangulate() == indices.at(name) &&
+					memcmp(expected.Positions().data(), meshPositions.data(), meshPositions.size() * sizeof(blender::Float3)) == 0;
 		}
 
-		void Cleanup()
-		{
-			m_blockArray.clear();
-			m_nameArray.clear();
-			m_typeArray.clear();
-			m_structArray.clear();
+		return Report("shared memory meshes", match);
+	}
 
-			if(!m_fileSpan.Empty())
-				delete[] m_fileSpan.begin;
+	// Reads through a field the SDNA doesn't have give T{} or nothing, in both access modes.
+	inline bool MissingFields(const std::string& file)
+	{
+		bool ok = true;
+		for(const AccessMode mode: { AccessMode::Trusted, AccessMode::Untrusted })
+		{
+			blendExpl blend;
+			if(!blend.ParseFile(file, mode))
+				return Report("missing fields", false);
+
+			const auto obBlockId = blend.FindBlockByCode(blender::BlockOB, 0);
+			if(!obBlockId.has_value())
+				return Report("missing fields", false);
+
+			const blender::FileBlock& block = blend.m_blockArray.at(obBlockId.value());
+			const size_t offset = blend.GetFieldOffset("Object", "no_such_field");
+
+			ok = ok && offset == blendExpl::MissingField && !blend.FindFieldOffset("Object", "no_such_field").has_value();
+			ok = ok && blend.PeekField<int32_t>(block, offset) == 0 && blend.PeekField<blender::PtrType>(block, offset) == 0;
+			ok = ok && blend.PeekField<blender::Float4x4>(block, offset).m[3][3] == 0.0f;
+			ok = ok && blend.GetFieldView<blender::Float3>(block, "Object", "no_such_field").Empty();
+			ok = ok && MakeStridedView<int32_t>(block.data, block.desc.count, blend.GetStructSizeByName("Object"), offset).Empty();
+			ok = ok && blendExpl::ReadName(block, offset).empty();
+
+			// a present field still reads
+			ok = ok && !blend.GetFieldView<float>(block, "Object", "loc[3]").Empty();
 		}
 
-		MemorySpan m_fileSpan;
-
-		std::vector<blender::FileBlock> m_blockArray;
+		return Report("missing fields", ok);
+	}
 
-		struct TypeInfo
+	/*
+	* Copy Rotation of a bone turned 0.4 about Z from a target turned 0.7 about X, both unparented with identity rests,
+	* against the posed matrices Blender gives for each mix_mode: Rx, Rz products written out by hand.
+	*/
+	inline bool CopyRotation()
+	{
+		const auto rotationX = [](float a)
 		{
-			MemorySpan type;
-			uint16_t length;
+			blender::Float4x4 m = blender::Identity();
+			m.m[1][1] = std::cos(a); m.m[1][2] = std::sin(a);
+			m.m[2][1] = -std::sin(a); m.m[2][2] = std::cos(a);
+			return m;
+		};
+		const auto rotationZ = [](float a)
+		{
+			blender::Float4x4 m = blender::Identity();
+			m.m[0][0] = std::cos(a); m.m[0][1] = std::sin(a);
+			m.m[1][0] = -std::sin(a); m.m[1][1] = std::cos(a);
+			return m;
 		};
 
-		std::vector<MemorySpan> m_nameArray;
-		std::vector<TypeInfo> m_typeArray;
+		const blender::Float4x4 owner = rotationZ(0.4f);
+		const blender::Float4x4 target = rotationX(0.7f);
 
-		struct FieldDesc
+		struct Case
 		{
-			uint16_t typeIndex;
-			uint16_t nameIndex;
+			int8_t mixMode;
+			uint8_t axes;
+			uint8_t invert;
+			blender::Float4x4 expected;
 		};
 
-		struct StructDesc
+		const Case cases[] =
 		{
-			uint16_t typeIndex;
-			std::vector<FieldDesc> fields;
+			{ blender::ROTLIKE_MIX_REPLACE, 7, 0, target },
+			{ blender::ROTLIKE_MIX_REPLACE, 1, 0, blender::Multiply(owner, target) },	// euler (0.7, 0, 0.4)
+			{ blender::ROTLIKE_MIX_REPLACE, 7, 1, rotationX(-0.7f) },
+			{ blender::ROTLIKE_MIX_OFFSET, 7, 0, blender::Multiply(target, owner) },	// Z turned by the owner's 0.4
+			{ blender::ROTLIKE_MIX_ADD, 7, 0, blender::Multiply(owner, target) },
+			{ blender::ROTLIKE_MIX_BEFORE, 7, 0, blender::Multiply(target, owner) },
+			{ blender::ROTLIKE_MIX_AFTER, 7, 0, blender::Multiply(owner, target) },
 		};
 
-		std::vector<StructDesc> m_structArray;
-};
+		anim::Skeleton skeleton;
+		skeleton.bones.resize(2);
+		for(anim::Bone& bone: skeleton.bones)
+			bone.rest = bone.restInverse = bone.restRelative = blender::Identity();
+
+		std::vector<anim::BoneTransform> locals(2);
+		locals[0].rotation = anim::QuatFromMatrix(owner);
+		locals[1].rotation = anim::QuatFromMatrix(target);
+
+		bool ok = !anim::RotationMixFromDna(5).has_value();
+		for(const Case& test: cases)
+		{
+			const auto mix = anim::RotationMixFromDna(test.mixMode);
+			if(!mix.has_value())
+				return Report("copy rotation", false);
+
+			anim::Constraint constraint{};
+			constraint.type = anim::ConstraintType::CopyRotation;
+			constraint.target = 1;
+			constraint.axes = test.axes;
+			constraint.invert = test.invert;
+			constraint.mix = mix.value();
+			skeleton.bones[0].constraints = { constraint };
+
+			blender::Float4x4 pose[2];
+			skeleton.PoseMatrices(locals.data(), pose);
+
+			float error = 0.0f;
+			for(int col=0; col<4; ++col)
+			{
+				for(int row=0; row<4; ++row)
+					error = std::max(error, std::abs(pose[0].m[col][row] - test.expected.m[col][row]));
+			}
+
+			if(error > 1e-5f)
+			{
+				std::cout << "  mix_mode " << int(test.mixMode) << " axes " << int(test.axes) << " off by " << error << '\n';
+				ok = false;
+			}
+		}
+
+		return Report("copy rotation", ok);
+	}
 
-int main()
+	/*
+	* A cube round trips through the codec, its short tail block packs no more than its rows and the container keeps
+	* every array raw the codec doesn't make smaller.
+	*/
+	inline bool TinyMesh()
+	{
+		container::MeshData cube;
+		cube.name = "Cube";
+		for(int corner=0; corner<8; ++corner)
+			cube.positions.emplace_back(blender::Float3{ (corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f, (corner & 4) ? 1.0f : -1.0f });
+
+		const uint32_t faces[6][4] = { { 0, 1, 3, 2 }, { 4, 6, 7, 5 }, { 0, 4, 5, 1 }, { 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 5, 7, 3 } };
+		for(const auto& face: faces)
+		{
+			cube.indices.insert(cube.indices.end(), { face[0], face[1], face[2], face[0], face[2], face[3] });
+			for(const uint32_t corner: { face[0], face[1], face[2], face[0], face[2], face[3] })
+				cube.lightmapUvs.emplace_back(blender::Float2{ float(corner & 1), float((corner >> 1) & 1) });
+		}
+
+		const auto positions = codec::EncodeAttributes(cube.positions.data(), cube.positions.size(), 3);
+		const auto indices = codec::EncodeIndices(cube.indices.data(), cube.indices.size());
+		const auto uvs = codec::EncodeAttributes(cube.lightmapUvs.data(), cube.lightmapUvs.size(), 2);
+
+		std::vector<blender::Float3> decodedPositions(cube.positions.size());
+		std::vector<uint32_t> decodedIndices(cube.indices.size());
+		std::vector<blender::Float2> decodedUvs(cube.lightmapUvs.size());
+		bool ok = codec::DecodeAttributes(positions.data(), positions.size(), decodedPositions.data(), decodedPositions.size(), 3);
+		ok = ok && codec::DecodeIndices(indices.data(), indices.size(), decodedIndices.data(), decodedIndices.size());
+		ok = ok && codec::DecodeAttributes(uvs.data(), uvs.size(), decodedUvs.data(), decodedUvs.size(), 2);
+		ok = ok && memcmp(decodedPositions.data(), cube.positions.data(), cube.positions.size() * sizeof(blender::Float3)) == 0;
+		ok = ok && decodedIndices == cube.indices;
+		ok = ok && memcmp(decodedUvs.data(), cube.lightmapUvs.data(), cube.lightmapUvs.size() * sizeof(blender::Float2)) == 0;
+
+		// header, one chunk size, then per component a width byte and at most 32 bits per value of the rows of the single short block
+		const auto maxSize = [](size_t count, size_t numComponents) { return 12 + numComponents * (1 + (count + codec::Lanes - 1) / codec::Lanes * codec::Lanes * 4); };
+		ok = ok && positions.size() <= maxSize(cube.positions.size(), 3) && uvs.size() <= maxSize(cube.lightmapUvs.size(), 2);
+
+		const std::filesystem::path directory = std::filesystem::temp_directory_path();
+		const std::filesystem::path rawPath = directory / "blendexpl_selftest_raw.bxc";
+		const std::filesystem::path encodedPath = directory / "blendexpl_selftest_encoded.bxc";
+		ok = ok && container::Write(rawPath, container::MagicShared, 0, 0, {}, { &cube }, false);
+		ok = ok && container::Write(encodedPath, container::MagicShared, 0, 0, {}, { &cube }, true);
+
+		std::error_code error;
+		ok = ok && std::filesystem::file_size(encodedPath, error) <= std::filesystem::file_size(rawPath, error) && !error;
+		std::filesystem::remove(rawPath, error);
+		std::filesystem::remove(encodedPath, error);
+
+		return Report("tiny mesh codec", ok);
+	}
+
+	inline bool Run(const std::string& file)
+	{
+		bool ok = SharedBackPressure();
+		ok = SharedMeshes(file) && ok;
+		ok = MissingFields(file) && ok;
+		ok = CopyRotation() && ok;
+		ok = TinyMesh() && ok;
+		return ok;
+	}
+}
+
+int main(int argc, char* argv[])
 {
+	// blendexpl --batch <output dir> <files...>
+	if(argc > 3 && std::string_view(argv[1]) == "--batch")
+	{
+		batch::BatchOptions options;
+		options.outputDir = argv[2];
+		const std::vector<std::string> files(argv + 3, argv + argc);
+		const auto results = batch::Run(files, options);
+		const bool allDone = results.size() == files.size() && std::all_of(results.begin(), results.end(), [](const batch::FileResult& result){ return result.state == batch::FileState::Done; });
+		return allDone ? 0 : 1;
+	}
+
+	// blendexpl --info <files...>
+	if(argc > 2 && std::string_view(argv[1]) == "--info")
+	{
+		for(int i=2; i<argc; ++i)
+		{
+			std::cout << argv[i] << ": ";
+			const auto info = blendExpl::QueryFileInfo(argv[i]);
+			if(info.has_value())
+				info->Print();
+			else
+				std::cout << "not a supported .blend file\n";
+		}
+
+		return 0;
+	}
+
+	// blendexpl --frames <files...>
+	if(argc > 2 && std::string_view(argv[1]) == "--frames")
+	{
+		for(int i=2; i<argc; ++i)
+		{
+			const auto scenes = blendExpl::QueryRenderInfo(argv[i]);
+			if(!scenes.has_value())
+				std::cout << argv[i] << ": not a supported .blend file\n";
+			else
+			{
+				for(const SceneFrameRange& scene: scenes.value())
+					std::cout << argv[i] << ": " << scene.name << ' ' << scene.frameStart << '-' << scene.frameEnd << '\n';
+			}
+		}
+
+		return 0;
+	}
+
+	// blendexpl --selftest <file>
+	if(argc == 3 && std::string_view(argv[1]) == "--selftest")
+		return selftest::Run(argv[2]) ? 0 : 1;
+
+#if defined(_WIN32)
+	if(argc == 4 && std::string_view(argv[1]) == batch::WorkerSwitch)
+		return batch::RunWorkerProcess(argv[2], uint32_t(std::stoul(argv[3])));
+#endif
+
 	blendExpl blend;
 	blend.Explore();
 